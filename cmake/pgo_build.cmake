@@ -0,0 +1,33 @@
+# Two-stage profile-guided build in one build directory:
+#   cmake -DBUILD_DIR=<dir> [-DGENERATOR=<generator>] -P cmake/pgo_build.cmake
+# Builds with SORTING_PROFILE=pgo-generate, runs the pgo_train workload, then reconfigures the same
+# directory with SORTING_PROFILE=pgo-use and rebuilds. GCC finds profiles by object path, so both
+# stages have to share the directory.
+if (NOT BUILD_DIR)
+    message(FATAL_ERROR "Pass -DBUILD_DIR=<dir>")
+endif ()
+
+set(GENERATOR_ARGS "")
+
+if (GENERATOR)
+    set(GENERATOR_ARGS -G ${GENERATOR})
+endif ()
+
+get_filename_component(SOURCE_DIR ${CMAKE_CURRENT_LIST_DIR} ABSOLUTE)
+get_filename_component(BUILD_DIR ${BUILD_DIR} ABSOLUTE)
+
+file(REMOVE_RECURSE ${BUILD_DIR}/pgo)
+
+foreach (stage pgo-generate pgo-use)
+    message(STATUS "---- ${stage} ----")
+    execute_process(COMMAND ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BUILD_DIR} ${GENERATOR_ARGS}
+            -DCMAKE_BUILD_TYPE=Release -DSORTING_PROFILE=${stage}
+            COMMAND_ERROR_IS_FATAL ANY)
+    execute_process(COMMAND ${CMAKE_COMMAND} --build ${BUILD_DIR} --parallel
+            COMMAND_ERROR_IS_FATAL ANY)
+
+    if (stage STREQUAL "pgo-generate")
+        execute_process(COMMAND ${CMAKE_COMMAND} --build ${BUILD_DIR} --target pgo_train
+                COMMAND_ERROR_IS_FATAL ANY)
+    endif ()
+endforeach ()
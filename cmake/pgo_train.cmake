@@ -0,0 +1,39 @@
+# Training workload for profile-guided builds, run by the pgo_train target:
+#   cmake -DBENCHMARK=<sorting_benchmark> -DPGO_DIR=<dir> -DCOMPILER_ID=<id> [-DLLVM_PROFDATA=<path>] -P pgo_train.cmake
+# Every engine sees every distribution at a cache-resident and a DRAM-sized input, so the profile
+# covers both the small-subarray and the large-merge paths.
+set(DISTRIBUTIONS uniform unique sorted reversed nearly-sorted few-unique)
+# Bubble sort is left out of the large runs, it is quadratic.
+set(LARGE_ALGORITHMS merge quick simd-quick radix sample)
+
+function(run_benchmark)
+    execute_process(COMMAND ${BENCHMARK} ${ARGN} --repetitions 2 --verify
+            OUTPUT_QUIET
+            RESULT_VARIABLE result)
+
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "Training run '${ARGN}' failed: ${result}")
+    endif ()
+endfunction()
+
+foreach (distribution ${DISTRIBUTIONS})
+    message(STATUS "Training on ${distribution}")
+    run_benchmark(--algorithm all --size 4096 --distribution ${distribution})
+    run_benchmark(--algorithm all --size 4096 --distribution ${distribution} --mode argsort)
+    foreach (algorithm ${LARGE_ALGORITHMS})
+        run_benchmark(--algorithm ${algorithm} --size 2000000 --distribution ${distribution})
+    endforeach ()
+endforeach ()
+
+message(STATUS "Training on segments")
+run_benchmark(--segments all --algorithm simd-quick --size 2000000)
+
+if (COMPILER_ID MATCHES "Clang")
+    if (NOT LLVM_PROFDATA)
+        message(FATAL_ERROR "llvm-profdata is needed to merge Clang profiles")
+    endif ()
+
+    file(GLOB RAW_PROFILES ${PGO_DIR}/*.profraw)
+    execute_process(COMMAND ${LLVM_PROFDATA} merge -output=${PGO_DIR}/default.profdata ${RAW_PROFILES}
+            COMMAND_ERROR_IS_FATAL ANY)
+endif ()
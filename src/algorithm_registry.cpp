@@ -0,0 +1,189 @@
+#include "algorithm_registry.h"
+
+#include "numa.h"
+#include "parallel.h"
+#include "sample_sort.h"
+#include "selection_algorithms.h"
+#include "simd_quicksort.h"
+#include "simd_select.h"
+#include "sorting_algorithms.h"
+
+#include <cstring>
+#include <type_traits>
+
+template<typename T, typename Counters>
+static void bubble_sort(T *arr, uint32_t size, const cancel_token &token, Counters &counters) {
+    if (size > 1) bubble_sort_algorithm(arr, size, token, counters);
+}
+
+template<typename T, typename Counters>
+static void merge_sort(T *arr, uint32_t size, const cancel_token &token, Counters &counters) {
+    if (size > 1) merge_sort_algorithm(arr, 0, size - 1, token, counters);
+}
+
+template<typename T, typename Counters>
+static void quick_sort(T *arr, uint32_t size, const cancel_token &token, Counters &counters) {
+    if (size > 1) quick_sort_algorithm(arr, size, quick_sort_depth_limit(size), token, counters);
+}
+
+template<typename T, typename Counters>
+static void radix_sort(T *arr, uint32_t size, const cancel_token &token, Counters &counters) {
+    radix_sort_algorithm(arr, size, token, counters);
+}
+
+// Counted runs stay on one thread; operation_counters has a single writer.
+template<typename T, typename Counters>
+static void sample_sort(T *arr, uint32_t size, const cancel_token &token, Counters &counters) {
+    if (!std::is_same_v<Counters, no_counters>) {
+        sample_sort_algorithm(arr, size, 1, token, counters);
+    } else if (numa_aware()) {
+        numa_sort(arr, size, (uint32_t) numa_nodes().size(), active_threads(), token,
+                  [&](T *slice, uint32_t length, uint32_t threads) {
+                      sample_sort_algorithm(slice, length, threads, token, counters);
+                  });
+    } else {
+        sample_sort_algorithm(arr, size, active_threads(), token, counters);
+    }
+}
+
+template<typename T, void (*SORT)(T *, uint32_t, const cancel_token &, no_counters &)>
+static void uncounted(T *arr, uint32_t size, const cancel_token &token) {
+    no_counters counters;
+    SORT(arr, size, token, counters);
+}
+
+const sorting_algorithm SORTING_ALGORITHMS[] = {
+        {
+                "bubble",
+                "Bubble Sort",
+                true,
+                false,
+                uncounted<uint32_t, bubble_sort<uint32_t, no_counters>>,
+                bubble_sort<uint32_t, operation_counters>,
+                uncounted<tagged_key, bubble_sort<tagged_key, no_counters>>,
+                uncounted<uint64_t, bubble_sort<uint64_t, no_counters>>,
+                bubble_sort_visual
+        },
+        {
+                "merge",
+                "Merge Sort",
+                true,
+                false,
+                uncounted<uint32_t, merge_sort<uint32_t, no_counters>>,
+                merge_sort<uint32_t, operation_counters>,
+                uncounted<tagged_key, merge_sort<tagged_key, no_counters>>,
+                uncounted<uint64_t, merge_sort<uint64_t, no_counters>>,
+                merge_sort_visual
+        },
+        {
+                "quick",
+                "Quick Sort",
+                false,
+                false,
+                uncounted<uint32_t, quick_sort<uint32_t, no_counters>>,
+                quick_sort<uint32_t, operation_counters>,
+                uncounted<tagged_key, quick_sort<tagged_key, no_counters>>,
+                uncounted<uint64_t, quick_sort<uint64_t, no_counters>>,
+                quick_sort_visual
+        },
+        {
+                "simd-quick",
+                "SIMD Quick Sort",
+                false,
+                false,
+                simd_quick_sort,
+                quick_sort<uint32_t, operation_counters>,
+                uncounted<tagged_key, quick_sort<tagged_key, no_counters>>,
+                uncounted<uint64_t, quick_sort<uint64_t, no_counters>>,
+                quick_sort_visual
+        },
+        {
+                "radix",
+                "LSD Radix Sort",
+                true,
+                false,
+                uncounted<uint32_t, radix_sort<uint32_t, no_counters>>,
+                radix_sort<uint32_t, operation_counters>,
+                uncounted<tagged_key, radix_sort<tagged_key, no_counters>>,
+                uncounted<uint64_t, radix_sort<uint64_t, no_counters>>,
+                radix_sort_visual
+        },
+        {
+                "sample",
+                "Parallel Sample Sort",
+                false,
+                true,
+                uncounted<uint32_t, sample_sort<uint32_t, no_counters>>,
+                sample_sort<uint32_t, operation_counters>,
+                uncounted<tagged_key, sample_sort<tagged_key, no_counters>>,
+                uncounted<uint64_t, sample_sort<uint64_t, no_counters>>,
+                sample_sort_visual
+        },
+};
+
+const uint32_t SORTING_ALGORITHMS_COUNT = sizeof(SORTING_ALGORITHMS) / sizeof(SORTING_ALGORITHMS[0]);
+
+const sorting_algorithm *find_sorting_algorithm(const char *id) {
+    for (uint32_t a = 0; a < SORTING_ALGORITHMS_COUNT; ++a) {
+        if (strcmp(SORTING_ALGORITHMS[a].id, id) == 0) return &SORTING_ALGORITHMS[a];
+    }
+    return nullptr;
+}
+
+template<void (*SELECT)(uint32_t *, uint32_t, uint32_t, const cancel_token &, no_counters &)>
+static void uncounted_select(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token) {
+    no_counters counters;
+    SELECT(arr, size, k, token, counters);
+}
+
+const selection_algorithm SELECTION_ALGORITHMS[] = {
+        {
+                "introselect",
+                "Introselect",
+                SELECTION::NTH_ELEMENT,
+                uncounted_select<introselect_algorithm<uint32_t, no_counters>>,
+                introselect_algorithm<uint32_t, operation_counters>,
+                introselect_visual
+        },
+        {
+                "floyd-rivest",
+                "Floyd-Rivest Select",
+                SELECTION::NTH_ELEMENT,
+                uncounted_select<floyd_rivest_algorithm<uint32_t, no_counters>>,
+                floyd_rivest_algorithm<uint32_t, operation_counters>,
+                floyd_rivest_visual
+        },
+        {
+                "heap-top-k",
+                "Heap Top-k",
+                SELECTION::TOP_K,
+                uncounted_select<heap_top_k_algorithm<uint32_t, no_counters>>,
+                heap_top_k_algorithm<uint32_t, operation_counters>,
+                heap_top_k_visual
+        },
+        {
+                "radix-top-k",
+                "Radix Select Top-k",
+                SELECTION::TOP_K,
+                uncounted_select<radix_select_algorithm<uint32_t, no_counters>>,
+                radix_select_algorithm<uint32_t, operation_counters>,
+                radix_select_visual
+        },
+        {
+                "simd-top-k",
+                "SIMD Top-k",
+                SELECTION::TOP_K,
+                simd_top_k,
+                heap_top_k_algorithm<uint32_t, operation_counters>,
+                heap_top_k_visual
+        },
+};
+
+const uint32_t SELECTION_ALGORITHMS_COUNT = sizeof(SELECTION_ALGORITHMS) / sizeof(SELECTION_ALGORITHMS[0]);
+
+const selection_algorithm *find_selection_algorithm(const char *id) {
+    for (uint32_t a = 0; a < SELECTION_ALGORITHMS_COUNT; ++a) {
+        if (strcmp(SELECTION_ALGORITHMS[a].id, id) == 0) return &SELECTION_ALGORITHMS[a];
+    }
+    return nullptr;
+}
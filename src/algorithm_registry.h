@@ -0,0 +1,56 @@
+#ifndef SORTING_ALGORITHMS_ALGORITHM_REGISTRY_H
+#define SORTING_ALGORITHMS_ALGORITHM_REGISTRY_H
+
+#include "cancel_token.h"
+#include "operation_counters.h"
+#include "sort_verifier.h"
+#include "visual_algorithms.h"
+
+#include <cstdint>
+
+// Every engine the GUI and the benchmark tool can run. sort and sort_counted are
+// the same kernel instantiated with no_counters and operation_counters; sort_tagged
+// sorts tagged keys by key only, so tests can check the stable flag. sort_packed
+// sorts key << 32 | payload records: comparison engines compare the whole word, the
+// radix engine only the key half, and both leave equal keys in payload order. Vectorized
+// engines only vectorize sort; the other entries run the scalar algorithm they are
+// built on, since lane-parallel compares have no per-operation counts to show.
+// Parallel engines run sort, sort_tagged and sort_packed on active_threads() threads,
+// through numa_sort when numa_aware() is set.
+struct sorting_algorithm {
+    const char *id;
+    const char *name;
+    bool stable;
+    bool parallel;
+    void (*sort)(uint32_t *arr, uint32_t size, const cancel_token &token);
+    void (*sort_counted)(uint32_t *arr, uint32_t size, const cancel_token &token, operation_counters &counters);
+    void (*sort_tagged)(tagged_key *arr, uint32_t size, const cancel_token &token);
+    void (*sort_packed)(uint64_t *arr, uint32_t size, const cancel_token &token);
+    sort_generator (*visual)(uint32_t *arr, uint32_t size, const cancel_token &token);
+};
+
+extern const sorting_algorithm SORTING_ALGORITHMS[];
+extern const uint32_t SORTING_ALGORITHMS_COUNT;
+
+// Returns nullptr if no algorithm has the given id.
+const sorting_algorithm *find_sorting_algorithm(const char *id);
+
+// Partial sorts, in the same layout as sorting_algorithm. What select(arr, size, k)
+// guarantees depends on the kind; see verify_selection. The visual generators show the
+// same algorithm with the same k.
+struct selection_algorithm {
+    const char *id;
+    const char *name;
+    SELECTION kind;
+    void (*select)(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token);
+    void (*select_counted)(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token, operation_counters &counters);
+    sort_generator (*visual)(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token);
+};
+
+extern const selection_algorithm SELECTION_ALGORITHMS[];
+extern const uint32_t SELECTION_ALGORITHMS_COUNT;
+
+// Returns nullptr if no selection algorithm has the given id.
+const selection_algorithm *find_selection_algorithm(const char *id);
+
+#endif //SORTING_ALGORITHMS_ALGORITHM_REGISTRY_H
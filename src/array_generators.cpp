@@ -0,0 +1,56 @@
+#include "array_generators.h"
+
+#include <cstring>
+#include <utility>
+
+const char *DISTRIBUTION_NAMES[] = {"Uniform", "Unique", "Sorted", "Reversed", "Nearly Sorted", "Few Unique"};
+const char *DISTRIBUTION_IDS[] = {"uniform", "unique", "sorted", "reversed", "nearly-sorted", "few-unique"};
+const uint32_t DISTRIBUTION_COUNT = 6;
+
+void generate_array(uint32_t *arr, uint32_t size, DISTRIBUTION distribution, std::mt19937 &rng) {
+    if (size == 0) return;
+
+    switch (distribution) {
+        case UNIFORM: {
+            std::uniform_int_distribution<uint32_t> values(1, size);
+            for (uint32_t i = 0; i < size; ++i) arr[i] = values(rng);
+            break;
+        }
+        case UNIQUE:
+            for (uint32_t i = 0; i < size; ++i) arr[i] = i;
+
+            for (uint32_t i = size - 1; i > 0; --i) {
+                std::uniform_int_distribution<uint32_t> index(0, i);
+                std::swap(arr[i], arr[index(rng)]);
+            }
+            break;
+        case SORTED:
+            for (uint32_t i = 0; i < size; ++i) arr[i] = i;
+            break;
+        case REVERSED:
+            for (uint32_t i = 0; i < size; ++i) arr[i] = size - i;
+            break;
+        case NEARLY_SORTED: {
+            for (uint32_t i = 0; i < size; ++i) arr[i] = i;
+
+            std::uniform_int_distribution<uint32_t> index(0, size - 1);
+            for (uint32_t s = 0; s < size / 100; ++s) std::swap(arr[index(rng)], arr[index(rng)]);
+            break;
+        }
+        case FEW_UNIQUE: {
+            std::uniform_int_distribution<uint32_t> values(1, 16);
+            for (uint32_t i = 0; i < size; ++i) arr[i] = values(rng);
+            break;
+        }
+    }
+}
+
+bool parse_distribution(const char *id, DISTRIBUTION &distribution) {
+    for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) {
+        if (strcmp(id, DISTRIBUTION_IDS[d]) == 0) {
+            distribution = (DISTRIBUTION) d;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,30 @@
+#ifndef SORTING_ALGORITHMS_ARRAY_GENERATORS_H
+#define SORTING_ALGORITHMS_ARRAY_GENERATORS_H
+
+#include <cstdint>
+#include <random>
+
+enum DISTRIBUTION {
+    UNIFORM,
+    UNIQUE,
+    SORTED,
+    REVERSED,
+    NEARLY_SORTED,
+    FEW_UNIQUE
+};
+
+extern const char *DISTRIBUTION_NAMES[];
+extern const char *DISTRIBUTION_IDS[];
+extern const uint32_t DISTRIBUTION_COUNT;
+
+// UNIFORM draws values from [1, size]; UNIQUE is a random permutation of [0, size).
+// NEARLY_SORTED is ascending with 1% of the elements swapped at random and
+// FEW_UNIQUE draws from only 16 distinct values. Runs on the calling thread: the random
+// distributions draw from rng in index order, so a seed always names the same array, which
+// the tests and saved baselines rely on and splitting the draws across threads would break.
+void generate_array(uint32_t *arr, uint32_t size, DISTRIBUTION distribution, std::mt19937 &rng);
+
+// Returns false if the id is unknown.
+bool parse_distribution(const char *id, DISTRIBUTION &distribution);
+
+#endif //SORTING_ALGORITHMS_ARRAY_GENERATORS_H
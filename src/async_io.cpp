@@ -0,0 +1,446 @@
+#include "async_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define SORTING_HAVE_IO_URING
+#endif
+
+// Larger requests are split, since io_uring lengths are 32-bit and a single
+// Linux read or write moves at most about 2 GiB anyway.
+static constexpr size_t MAX_PIECE_BYTES = 1u << 30;
+static constexpr unsigned RING_ENTRIES = 64;
+static constexpr uint32_t FALLBACK_THREADS = 2;
+
+aligned_buffer::aligned_buffer(size_t bytes) : bytes(align_up(bytes)) {
+    if (this->bytes) block = operator new(this->bytes, std::align_val_t(IO_ALIGNMENT));
+}
+
+aligned_buffer::~aligned_buffer() {
+    if (block) operator delete(block, std::align_val_t(IO_ALIGNMENT));
+}
+
+aligned_buffer::aligned_buffer(aligned_buffer &&other) noexcept : block(other.block), bytes(other.bytes) {
+    other.block = nullptr;
+    other.bytes = 0;
+}
+
+aligned_buffer &aligned_buffer::operator=(aligned_buffer &&other) noexcept {
+    std::swap(block, other.block);
+    std::swap(bytes, other.bytes);
+    return *this;
+}
+
+io_file::~io_file() {
+    close();
+}
+
+#if defined(_WIN32)
+
+bool io_file::open(const char *path, bool write, bool direct) {
+    close();
+
+    DWORD access = write ? GENERIC_WRITE : GENERIC_READ;
+    DWORD disposition = write ? CREATE_ALWAYS : OPEN_EXISTING;
+
+    HANDLE file = INVALID_HANDLE_VALUE;
+    if (direct) {
+        file = CreateFileA(path, access, FILE_SHARE_READ, nullptr, disposition, FILE_FLAG_NO_BUFFERING, nullptr);
+    }
+    direct_io = file != INVALID_HANDLE_VALUE;
+    if (!direct_io) {
+        file = CreateFileA(path, access, FILE_SHARE_READ, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+
+    handle = file == INVALID_HANDLE_VALUE ? nullptr : file;
+    return handle != nullptr;
+}
+
+void io_file::close() {
+    if (handle) CloseHandle((HANDLE) handle);
+    handle = nullptr;
+}
+
+bool io_file::is_open() const {
+    return handle != nullptr;
+}
+
+int64_t io_file::transfer(bool write, void *buffer, size_t bytes, uint64_t offset) {
+    size_t done = 0;
+    while (done < bytes) {
+        OVERLAPPED position = {};
+        position.Offset = (DWORD) (offset + done);
+        position.OffsetHigh = (DWORD) ((offset + done) >> 32);
+
+        DWORD request = (DWORD) std::min<size_t>(bytes - done, MAX_PIECE_BYTES), moved = 0;
+        BOOL ok = write
+                  ? WriteFile((HANDLE) handle, (char *) buffer + done, request, &moved, &position)
+                  : ReadFile((HANDLE) handle, (char *) buffer + done, request, &moved, &position);
+
+        if (!ok && GetLastError() != ERROR_HANDLE_EOF) return -1;
+        if (moved == 0) break;
+        done += moved;
+    }
+    return (int64_t) done;
+}
+
+bool io_file::truncate(uint64_t size) {
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG) size;
+    return SetFilePointerEx((HANDLE) handle, position, nullptr, FILE_BEGIN) && SetEndOfFile((HANDLE) handle);
+}
+
+#else
+
+bool io_file::open(const char *path, bool write, bool direct) {
+    close();
+
+    int flags = write ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+    direct_io = false;
+
+#ifdef O_DIRECT
+    if (direct) {
+        descriptor = ::open(path, flags | O_DIRECT, 0644);
+        direct_io = descriptor >= 0;
+    }
+#else
+    (void) direct;
+#endif
+
+    if (!direct_io) descriptor = ::open(path, flags, 0644);
+    return descriptor >= 0;
+}
+
+void io_file::close() {
+    if (descriptor >= 0) ::close(descriptor);
+    descriptor = -1;
+}
+
+bool io_file::is_open() const {
+    return descriptor >= 0;
+}
+
+int64_t io_file::transfer(bool write, void *buffer, size_t bytes, uint64_t offset) {
+    size_t done = 0;
+    while (done < bytes) {
+        ssize_t moved = write
+                        ? pwrite(descriptor, (char *) buffer + done, bytes - done, (off_t) (offset + done))
+                        : pread(descriptor, (char *) buffer + done, bytes - done, (off_t) (offset + done));
+
+        if (moved < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (moved == 0) break;
+        done += (size_t) moved;
+    }
+    return (int64_t) done;
+}
+
+bool io_file::truncate(uint64_t size) {
+    return ftruncate(descriptor, (off_t) size) == 0;
+}
+
+#endif
+
+io_queue::io_queue() {
+    // SORTING_IO_BACKEND=threads skips io_uring, e.g. to compare the two.
+    const char *backend = getenv("SORTING_IO_BACKEND");
+    if (!(backend && strcmp(backend, "threads") == 0) && ring_setup()) return;
+
+    for (uint32_t t = 0; t < FALLBACK_THREADS; ++t) workers.emplace_back(&io_queue::worker_loop, this);
+}
+
+io_queue::~io_queue() {
+    // Nothing may still be writing into caller buffers once the queue is gone.
+    drain();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    submitted.notify_all();
+    for (std::thread &worker: workers) worker.join();
+
+    ring_teardown();
+}
+
+void io_queue::drain() {
+    std::vector<uint64_t> outstanding;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &request: requests) outstanding.push_back(request.first);
+    }
+    for (uint64_t request: outstanding) wait(request);
+}
+
+const char *io_queue::backend() const {
+    return ring_fd >= 0 ? "io_uring" : "threads";
+}
+
+uint64_t io_queue::read(io_file &file, void *buffer, size_t bytes, uint64_t offset) {
+    return submit(file, false, buffer, bytes, offset);
+}
+
+uint64_t io_queue::write(io_file &file, const void *buffer, size_t bytes, uint64_t offset) {
+    return submit(file, true, (void *) buffer, bytes, offset);
+}
+
+uint64_t io_queue::submit(io_file &file, bool write, void *buffer, size_t bytes, uint64_t offset) {
+    uint64_t request = next_request++;
+
+    std::vector<piece> pieces;
+    for (size_t done = 0; done < bytes || pieces.empty(); done += MAX_PIECE_BYTES) {
+        pieces.push_back({&file, write, (char *) buffer + done, std::min(bytes - done, MAX_PIECE_BYTES), offset + done});
+    }
+
+    std::vector<piece> *stored;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stored = &(requests[request] = std::move(pieces));
+
+        if (ring_fd < 0) {
+            for (uint32_t index = 0; index < stored->size(); ++index) pending.emplace_back(request, index);
+        }
+    }
+
+    if (ring_fd < 0) {
+        submitted.notify_all();
+        return request;
+    }
+
+    for (uint32_t index = 0; index < stored->size(); ++index) {
+        // A ring that cannot take the request (or a kernel without the opcode) is
+        // served synchronously instead.
+        if (!ring_push(request, index, (*stored)[index])) {
+            piece &p = (*stored)[index];
+            complete(request, index, p.file->transfer(p.write, p.buffer, p.bytes, p.offset));
+        }
+    }
+    return request;
+}
+
+void io_queue::complete(uint64_t request, uint32_t index, int64_t result) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        piece &p = requests[request][index];
+        p.result = result;
+        p.done = true;
+    }
+    completed.notify_all();
+}
+
+void io_queue::worker_loop() {
+    while (true) {
+        uint64_t request;
+        uint32_t index;
+        piece *p;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            submitted.wait(lock, [this]() { return stopping || !pending.empty(); });
+            if (pending.empty()) return;
+
+            request = pending.front().first;
+            index = pending.front().second;
+            pending.pop_front();
+            p = &requests[request][index];
+        }
+
+        complete(request, index, p->file->transfer(p->write, p->buffer, p->bytes, p->offset));
+    }
+}
+
+int64_t io_queue::wait(uint64_t request) {
+    auto all_done = [this, request]() {
+        for (const piece &p: requests[request]) {
+            if (!p.done) return false;
+        }
+        return true;
+    };
+
+    if (ring_fd >= 0) {
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (all_done()) break;
+            }
+            ring_reap(true);
+        }
+    } else {
+        std::unique_lock<std::mutex> lock(mutex);
+        completed.wait(lock, all_done);
+    }
+
+    std::vector<piece> pieces;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pieces = std::move(requests[request]);
+        requests.erase(request);
+    }
+
+    int64_t total = 0;
+    bool failed = false;
+    for (piece &p: pieces) {
+        int64_t moved = p.result;
+        if (moved < 0) {
+            failed = true;
+            continue;
+        }
+
+        // Short transfers before the end of the file are rare but legal; finish them here.
+        if ((size_t) moved < p.bytes) {
+            int64_t rest = p.file->transfer(p.write, p.buffer + moved, p.bytes - (size_t) moved, p.offset + moved);
+            if (rest < 0) {
+                failed = true;
+                continue;
+            }
+            moved += rest;
+        }
+        total += moved;
+    }
+
+    return failed ? -1 : total;
+}
+
+#ifdef SORTING_HAVE_IO_URING
+
+bool io_queue::ring_setup() {
+    io_uring_params params = {};
+    int fd = (int) syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (fd < 0) return false;
+
+    sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) sq_ring_bytes = cq_ring_bytes = std::max(sq_ring_bytes, cq_ring_bytes);
+
+    sq_ring = mmap(nullptr, sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    cq_ring = single_mmap
+              ? sq_ring
+              : mmap(nullptr, cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    sqes = mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    ring_fd = fd;
+    if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+        ring_teardown();
+        return false;
+    }
+
+    sq_head = (unsigned *) ((char *) sq_ring + params.sq_off.head);
+    sq_tail = (unsigned *) ((char *) sq_ring + params.sq_off.tail);
+    sq_mask = (unsigned *) ((char *) sq_ring + params.sq_off.ring_mask);
+    sq_array = (unsigned *) ((char *) sq_ring + params.sq_off.array);
+    cq_head = (unsigned *) ((char *) cq_ring + params.cq_off.head);
+    cq_tail = (unsigned *) ((char *) cq_ring + params.cq_off.tail);
+    cq_mask = (unsigned *) ((char *) cq_ring + params.cq_off.ring_mask);
+    cqes = (char *) cq_ring + params.cq_off.cqes;
+    sq_entries = params.sq_entries;
+    return true;
+}
+
+void io_queue::ring_teardown() {
+    if (ring_fd < 0) return;
+
+    if (sqes && sqes != MAP_FAILED) munmap(sqes, sqes_bytes);
+    if (cq_ring && cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_bytes);
+    if (sq_ring && sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_bytes);
+    close(ring_fd);
+
+    ring_fd = -1;
+    sq_ring = cq_ring = sqes = nullptr;
+}
+
+bool io_queue::ring_push(uint64_t request, uint32_t index, piece &p) {
+    // The completion ring holds twice the submission entries, so capping what is in
+    // flight at sq_entries means completions can never be dropped.
+    while (in_flight >= sq_entries) ring_reap(true);
+
+    unsigned tail = *sq_tail;
+    unsigned slot = tail & *sq_mask;
+
+    io_uring_sqe *sqe = (io_uring_sqe *) sqes + slot;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = p.write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = p.file->descriptor;
+    sqe->addr = (uint64_t) (uintptr_t) p.buffer;
+    sqe->len = (uint32_t) p.bytes;
+    sqe->off = p.offset;
+    sqe->user_data = request << 16 | index;
+
+    sq_array[slot] = slot;
+    std::atomic_ref<unsigned>(*sq_tail).store(tail + 1, std::memory_order_release);
+
+    while (syscall(__NR_io_uring_enter, ring_fd, 1, 0, 0, nullptr, 0) < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+            ring_reap(false);
+            continue;
+        }
+        // The entry is still queued; take it back so it is not executed later.
+        std::atomic_ref<unsigned>(*sq_tail).store(tail, std::memory_order_release);
+        return false;
+    }
+
+    ++in_flight;
+    return true;
+}
+
+void io_queue::ring_reap(bool block) {
+    if (block && in_flight) {
+        syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+
+    unsigned head = *cq_head;
+    unsigned tail = std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire);
+
+    for (; head != tail; ++head) {
+        io_uring_cqe cqe = ((io_uring_cqe *) cqes)[head & *cq_mask];
+        uint64_t request = cqe.user_data >> 16;
+        uint32_t index = (uint32_t) (cqe.user_data & 0xffff);
+        --in_flight;
+
+        int64_t result = cqe.res;
+        if (result == -EINVAL || result == -EOPNOTSUPP) {
+            // Kernels before 5.6 set up rings but lack IORING_OP_READ/WRITE.
+            piece &p = requests[request][index];
+            result = p.file->transfer(p.write, p.buffer, p.bytes, p.offset);
+        } else if (result < 0) {
+            result = -1;
+        }
+        complete(request, index, result);
+    }
+
+    std::atomic_ref<unsigned>(*cq_head).store(head, std::memory_order_release);
+}
+
+#else
+
+bool io_queue::ring_setup() {
+    return false;
+}
+
+void io_queue::ring_teardown() {}
+
+bool io_queue::ring_push(uint64_t, uint32_t, piece &) {
+    return false;
+}
+
+void io_queue::ring_reap(bool) {}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef SORTING_ALGORITHMS_ASYNC_IO_H
+#define SORTING_ALGORITHMS_ASYNC_IO_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Offsets, sizes and addresses of direct (cache-bypassing) transfers must be
+// multiples of the device block size; 4 KiB covers every common device.
+static constexpr size_t IO_ALIGNMENT = 4096;
+
+inline size_t align_down(size_t bytes) {
+    return bytes / IO_ALIGNMENT * IO_ALIGNMENT;
+}
+
+inline size_t align_up(size_t bytes) {
+    return (bytes + IO_ALIGNMENT - 1) / IO_ALIGNMENT * IO_ALIGNMENT;
+}
+
+// Heap block aligned to IO_ALIGNMENT, usable as a direct I/O buffer.
+class aligned_buffer {
+public:
+    aligned_buffer() = default;
+    explicit aligned_buffer(size_t bytes);
+    ~aligned_buffer();
+
+    aligned_buffer(aligned_buffer &&other) noexcept;
+    aligned_buffer &operator=(aligned_buffer &&other) noexcept;
+    aligned_buffer(const aligned_buffer &) = delete;
+    aligned_buffer &operator=(const aligned_buffer &) = delete;
+
+    void *data() const { return block; }
+    size_t size() const { return bytes; }
+
+    template<typename T>
+    T *as() const { return (T *) block; }
+
+private:
+    void *block = nullptr;
+    size_t bytes = 0;
+};
+
+// File opened for positional I/O. With `direct`, the page cache is bypassed
+// (O_DIRECT, FILE_FLAG_NO_BUFFERING) where the file system allows it; direct()
+// reports whether that worked, since tmpfs and others refuse it.
+class io_file {
+public:
+    io_file() = default;
+    ~io_file();
+
+    io_file(const io_file &) = delete;
+    io_file &operator=(const io_file &) = delete;
+
+    bool open(const char *path, bool write, bool direct);
+    void close();
+
+    bool is_open() const;
+    bool direct() const { return direct_io; }
+
+    // Blocking; loops over partial transfers. Returns the bytes moved, which is
+    // short only at the end of the file, or -1 on error.
+    int64_t transfer(bool write, void *buffer, size_t bytes, uint64_t offset);
+
+    // Direct writes are whole blocks, so the padding after the data is cut off here.
+    bool truncate(uint64_t size);
+
+private:
+    friend class io_queue;
+
+#if defined(_WIN32)
+    void *handle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+    bool direct_io = false;
+};
+
+// Queue of asynchronous positional reads and writes. Requests go to io_uring when
+// the kernel provides it and otherwise to a pair of threads issuing blocking calls,
+// so a read and a write can be in flight next to the caller's computation.
+// Setting SORTING_IO_BACKEND=threads forces the fallback.
+// One thread submits and waits; completions may arrive in any order.
+class io_queue {
+public:
+    io_queue();
+    ~io_queue();
+
+    io_queue(const io_queue &) = delete;
+    io_queue &operator=(const io_queue &) = delete;
+
+    uint64_t read(io_file &file, void *buffer, size_t bytes, uint64_t offset);
+    uint64_t write(io_file &file, const void *buffer, size_t bytes, uint64_t offset);
+
+    // Blocks until the request is done. Returns the bytes transferred (short only at
+    // the end of the file) or -1 on error.
+    int64_t wait(uint64_t request);
+
+    // Waits for everything still in flight, e.g. before the buffers go away.
+    void drain();
+
+    const char *backend() const;
+
+private:
+    struct piece {
+        io_file *file;
+        bool write;
+        char *buffer;
+        size_t bytes;
+        uint64_t offset;
+        int64_t result = 0;
+        bool done = false;
+    };
+
+    uint64_t submit(io_file &file, bool write, void *buffer, size_t bytes, uint64_t offset);
+    void complete(uint64_t request, uint32_t index, int64_t result);
+    void worker_loop();
+
+    bool ring_setup();
+    void ring_teardown();
+    bool ring_push(uint64_t request, uint32_t index, piece &p);
+    void ring_reap(bool block);
+
+    uint64_t next_request = 1;
+    std::unordered_map<uint64_t, std::vector<piece>> requests;
+
+    // io_uring state, when ring_fd >= 0.
+    int ring_fd = -1;
+    void *sq_ring = nullptr, *cq_ring = nullptr, *sqes = nullptr;
+    size_t sq_ring_bytes = 0, cq_ring_bytes = 0, sqes_bytes = 0;
+    unsigned *sq_head = nullptr, *sq_tail = nullptr, *sq_mask = nullptr, *sq_array = nullptr;
+    unsigned *cq_head = nullptr, *cq_tail = nullptr, *cq_mask = nullptr;
+    void *cqes = nullptr;
+    unsigned sq_entries = 0;
+    uint32_t in_flight = 0;
+
+    // Thread fallback.
+    std::mutex mutex;
+    std::condition_variable submitted, completed;
+    std::deque<std::pair<uint64_t, uint32_t>> pending;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+};
+
+#endif //SORTING_ALGORITHMS_ASYNC_IO_H
@@ -0,0 +1,1004 @@
+#include "algorithm_registry.h"
+#include "array_generators.h"
+#include "benchmark_baseline.h"
+#include "cancel_token.h"
+#include "cpu_dispatch.h"
+#include "dataset_io.h"
+#include "external_sort.h"
+#include "key_value_sort.h"
+#include "numa.h"
+#include "operation_counters.h"
+#include "parallel.h"
+#include "perf_counters.h"
+#include "segmented_sort.h"
+#include "sort_verifier.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+struct benchmark_options {
+    const char *algorithm = "all";
+    uint32_t size = 100000;
+    uint32_t repetitions = 5;
+    DISTRIBUTION distribution = DISTRIBUTION::UNIFORM;
+    SORT_MODE mode = SORT_MODE::KEYS;
+    uint32_t k = 100;
+    bool k_median = false;
+    // Thread counts for parallel engines; empty runs them once on active_threads().
+    std::vector<uint32_t> threads;
+    // Input placements for parallel engines; empty copies the input on the main thread.
+    std::vector<MEMORY_PLACEMENT> placements;
+    // Segment length distributions for the segmented sort benchmark; empty runs whole arrays.
+    std::vector<SEGMENT_DISTRIBUTION> segments;
+    uint32_t seed = 42;
+    bool counters = false;
+    bool perf = false;
+    bool verify = false;
+    const char *save_path = nullptr;
+    const char *compare_path = nullptr;
+    double alpha = 0.01;
+    double tolerance = 0.02;
+    const char *external_path = nullptr;
+    const char *output_path = nullptr;
+    const char *input_path = nullptr;
+    const char *write_input_path = nullptr;
+    const char *temp_dir = nullptr;
+    ELEMENT_TYPE element_type = ELEMENT_TYPE::UINT32;
+    bool buffered_io = false;
+    uint64_t memory_mib = 1024;
+};
+
+// Exit code when --compare finds a significant slowdown, distinct from usage errors.
+const int EXIT_REGRESSION = 2;
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --algorithm <id|all>      Algorithm or partial sort to run (default: all)\n");
+    printf("  --size <n>                Number of elements (default: 100000)\n");
+    printf("  --repetitions <r>         Timed runs per algorithm (default: 5)\n");
+    printf("  --distribution <id>       Input distribution (default: uniform)\n");
+    printf("  --seed <s>                Random seed (default: 42)\n");
+    printf("  --mode <id>               keys, argsort (index permutation), pairs (key and value arrays)\n");
+    printf("                            or packed (key << 32 | index records) (default: keys)\n");
+    printf("  --k <n|median>            Rank for nth_element engines, count for top-k engines\n");
+    printf("                            (default: 100)\n");
+    printf("  --threads <n[,n...]|scaling>\n");
+    printf("                            Thread counts for parallel engines; scaling doubles from 1 up to\n");
+    printf("                            the %u hardware threads (default: %u; also SORTING_THREADS)\n",
+           hardware_threads(), active_threads());
+    printf("  --placement <id[,id...]|all>\n");
+    printf("                            Run parallel engines on keys first-touched by the NUMA nodes:\n");
+    printf("                            single (one node), local (each node its slice, sorted NUMA-aware:\n");
+    printf("                            per-node sorts, then a merge) or interleaved (pages round-robin);\n");
+    printf("                            %u node(s) here\n", (uint32_t) numa_nodes().size());
+    printf("  --affinity <id>           Pinning of the thread pool's workers: none, compact (one CPU each,\n");
+    printf("                            node by node) or spread (round-robin over NUMA nodes)\n");
+    printf("                            (default: %s; also SORTING_AFFINITY)\n", THREAD_AFFINITY_IDS[thread_affinity()]);
+    printf("  --segments <id[,id...]|all>\n");
+    printf("                            Cut the keys into segments of tiny (2-16), small (8-1000), mixed\n");
+    printf("                            (1-1000, mostly short) or skewed (mostly 1-32, a few up to 100000)\n");
+    printf("                            length and time the batched segmented sort against a loop calling\n");
+    printf("                            --algorithm on every segment (default: merge)\n");
+    printf("  --input <file>            Sort a dataset instead of a generated array (binary uint32,\n");
+    printf("                            or .csv/.txt/.tsv text); overrides --size and --distribution\n");
+    printf("  --output <file>           Save the sorted array of the last algorithm run (same formats)\n");
+    printf("  --counters                Also run the instrumented kernel and print operation counts\n");
+    printf("  --perf                    Read hardware counters (Linux perf_event_open) around each run\n");
+    printf("                            (n/a for engines on more than one thread)\n");
+    printf("  --verify                  Check that the output is sorted and a permutation of the input\n");
+    printf("                            (one extra untimed run; the check's own cost is printed)\n");
+    printf("  --save <file>             Write the timed runs to a JSON baseline\n");
+    printf("  --compare <file>          Re-run every case in a baseline and test for regressions;\n");
+    printf("                            exits with %d if any case got significantly slower\n", EXIT_REGRESSION);
+    printf("  --alpha <p>               Significance level for --compare (default: 0.01)\n");
+    printf("  --tolerance <fraction>    Ignore median slowdowns below this (default: 0.02)\n");
+    printf("  --isa <id>                Highest instruction set the kernels may use: generic, avx2 or\n");
+    printf("                            avx512 (default: best supported, %s here; also SORTING_ISA)\n",
+           CPU_ISA_IDS[detect_isa()]);
+    printf("\nExternal sort (files of native-endian keys, no header):\n");
+    printf("  --external <file>         Sort a file out-of-core into --output and report the phases\n");
+    printf("  --output <file>           Destination of --external\n");
+    printf("  --element-bits <32|64>    Key width of the file (default: 32)\n");
+    printf("  --memory <MiB>            Memory budget for runs and merge buffers (default: 1024)\n");
+    printf("  --temp-dir <dir>          Where run files go (default: next to --output)\n");
+    printf("  --buffered-io             Go through the page cache instead of O_DIRECT\n");
+    printf("  --write-input <file>      Write --size keys of --distribution to a file and exit\n");
+    printf("                            (32-bit keys to a .csv/.txt/.tsv name are written as text)\n");
+    printf("\nAlgorithms:");
+    for (uint32_t a = 0; a < SORTING_ALGORITHMS_COUNT; ++a) printf(" %s", SORTING_ALGORITHMS[a].id);
+    printf("\nPartial sorts:");
+    for (uint32_t a = 0; a < SELECTION_ALGORITHMS_COUNT; ++a) printf(" %s", SELECTION_ALGORITHMS[a].id);
+    printf("\nDistributions:");
+    for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) printf(" %s", DISTRIBUTION_IDS[d]);
+    printf("\n");
+}
+
+// "scaling" doubles from 1 to the hardware thread count and ends on it.
+static bool parse_thread_counts(const char *value, std::vector<uint32_t> &counts) {
+    counts.clear();
+    if (strcmp(value, "scaling") == 0) {
+        for (uint32_t threads = 1; threads < hardware_threads(); threads *= 2) counts.push_back(threads);
+        counts.push_back(hardware_threads());
+        return true;
+    }
+
+    std::string list(value);
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = std::min(list.find(',', begin), list.size());
+        uint32_t threads;
+        if (!parse_threads(list.substr(begin, end - begin).c_str(), threads)) return false;
+        counts.push_back(threads);
+        begin = end + 1;
+    }
+    return true;
+}
+
+static bool parse_segment_distributions(const char *value, std::vector<SEGMENT_DISTRIBUTION> &distributions) {
+    distributions.clear();
+    if (strcmp(value, "all") == 0) {
+        for (uint32_t d = 0; d < SEGMENT_DISTRIBUTION_COUNT; ++d) distributions.push_back((SEGMENT_DISTRIBUTION) d);
+        return true;
+    }
+
+    std::string list(value);
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = std::min(list.find(',', begin), list.size());
+        SEGMENT_DISTRIBUTION distribution;
+        if (!parse_segment_distribution(list.substr(begin, end - begin).c_str(), distribution)) return false;
+        distributions.push_back(distribution);
+        begin = end + 1;
+    }
+    return true;
+}
+
+static bool parse_placements(const char *value, std::vector<MEMORY_PLACEMENT> &placements) {
+    placements.clear();
+    if (strcmp(value, "all") == 0) {
+        for (uint32_t p = 0; p < MEMORY_PLACEMENT_COUNT; ++p) placements.push_back((MEMORY_PLACEMENT) p);
+        return true;
+    }
+
+    std::string list(value);
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = std::min(list.find(',', begin), list.size());
+        MEMORY_PLACEMENT placement;
+        if (!parse_memory_placement(list.substr(begin, end - begin).c_str(), placement)) return false;
+        placements.push_back(placement);
+        begin = end + 1;
+    }
+    return true;
+}
+
+static bool parse_arguments(int argc, char **argv, benchmark_options &options) {
+    for (int i = 1; i < argc; ++i) {
+        const char *argument = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(argument, "--counters") == 0) {
+            options.counters = true;
+            continue;
+        }
+
+        if (strcmp(argument, "--perf") == 0) {
+            options.perf = true;
+            continue;
+        }
+
+        if (strcmp(argument, "--verify") == 0) {
+            options.verify = true;
+            continue;
+        }
+
+        if (strcmp(argument, "--buffered-io") == 0) {
+            options.buffered_io = true;
+            continue;
+        }
+
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", argument);
+            return false;
+        }
+
+        if (strcmp(argument, "--algorithm") == 0) {
+            options.algorithm = value;
+        } else if (strcmp(argument, "--size") == 0) {
+            options.size = (uint32_t) strtoul(value, nullptr, 10);
+        } else if (strcmp(argument, "--repetitions") == 0) {
+            options.repetitions = (uint32_t) strtoul(value, nullptr, 10);
+        } else if (strcmp(argument, "--distribution") == 0) {
+            if (!parse_distribution(value, options.distribution)) {
+                fprintf(stderr, "Unknown distribution: %s\n", value);
+                return false;
+            }
+        } else if (strcmp(argument, "--mode") == 0) {
+            if (!parse_sort_mode(value, options.mode)) {
+                fprintf(stderr, "Unknown mode: %s\n", value);
+                return false;
+            }
+        } else if (strcmp(argument, "--k") == 0) {
+            options.k_median = strcmp(value, "median") == 0;
+            options.k = (uint32_t) strtoul(value, nullptr, 10);
+        } else if (strcmp(argument, "--seed") == 0) {
+            options.seed = (uint32_t) strtoul(value, nullptr, 10);
+        } else if (strcmp(argument, "--save") == 0) {
+            options.save_path = value;
+        } else if (strcmp(argument, "--compare") == 0) {
+            options.compare_path = value;
+        } else if (strcmp(argument, "--threads") == 0) {
+            if (!parse_thread_counts(value, options.threads)) {
+                fprintf(stderr, "Invalid thread counts: %s\n", value);
+                return false;
+            }
+        } else if (strcmp(argument, "--placement") == 0) {
+            if (!parse_placements(value, options.placements)) {
+                fprintf(stderr, "Unknown placement: %s\n", value);
+                return false;
+            }
+        } else if (strcmp(argument, "--segments") == 0) {
+            if (!parse_segment_distributions(value, options.segments)) {
+                fprintf(stderr, "Unknown segment distribution: %s\n", value);
+                return false;
+            }
+        } else if (strcmp(argument, "--affinity") == 0) {
+            THREAD_AFFINITY affinity;
+            if (!parse_thread_affinity(value, affinity)) {
+                fprintf(stderr, "Unknown affinity: %s\n", value);
+                return false;
+            }
+            set_thread_affinity(affinity);
+        } else if (strcmp(argument, "--alpha") == 0) {
+            options.alpha = strtod(value, nullptr);
+        } else if (strcmp(argument, "--tolerance") == 0) {
+            options.tolerance = strtod(value, nullptr);
+        } else if (strcmp(argument, "--isa") == 0) {
+            CPU_ISA isa;
+            if (!parse_isa(value, isa)) {
+                fprintf(stderr, "Unknown instruction set: %s\n", value);
+                return false;
+            }
+            if (!set_isa(isa)) {
+                fprintf(stderr, "This CPU does not support %s\n", value);
+                return false;
+            }
+        } else if (strcmp(argument, "--external") == 0) {
+            options.external_path = value;
+        } else if (strcmp(argument, "--output") == 0) {
+            options.output_path = value;
+        } else if (strcmp(argument, "--input") == 0) {
+            options.input_path = value;
+        } else if (strcmp(argument, "--write-input") == 0) {
+            options.write_input_path = value;
+        } else if (strcmp(argument, "--temp-dir") == 0) {
+            options.temp_dir = value;
+        } else if (strcmp(argument, "--memory") == 0) {
+            options.memory_mib = strtoull(value, nullptr, 10);
+        } else if (strcmp(argument, "--element-bits") == 0) {
+            uint32_t bits = (uint32_t) strtoul(value, nullptr, 10);
+            if (bits != 32 && bits != 64) {
+                fprintf(stderr, "Element bits must be 32 or 64\n");
+                return false;
+            }
+            options.element_type = bits == 64 ? ELEMENT_TYPE::UINT64 : ELEMENT_TYPE::UINT32;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argument);
+            return false;
+        }
+
+        ++i;
+    }
+
+    if (options.repetitions == 0) options.repetitions = 1;
+
+    // The instrumented kernels only exist for plain keys.
+    if (options.counters && options.mode != SORT_MODE::KEYS) {
+        fprintf(stderr, "--counters only works with --mode keys\n");
+        return false;
+    }
+    if (!options.placements.empty() && options.mode != SORT_MODE::KEYS) {
+        fprintf(stderr, "--placement only works with --mode keys\n");
+        return false;
+    }
+    return true;
+}
+
+static void print_metric(double value, int width) {
+    if (value < 0) {
+        printf(" %*s", width, "n/a");
+    } else {
+        printf(" %*.3f", width, value);
+    }
+}
+
+// What one run sorts. Refilled from the input before every run, outside the timer:
+// argsort reads keys and writes values, pairs sorts keys and values (0, 1, 2, ...),
+// packed sorts records. Keys with a placement go to `placed` instead, allocated on the
+// first run so that its copy is what first touches the pages.
+struct mode_buffers {
+    uint32_t size = 0;
+    std::vector<uint32_t> keys;
+    std::unique_ptr<uint32_t[]> placed;
+    std::vector<uint32_t> values;
+    std::vector<uint64_t> records;
+
+    uint32_t *key_data() {
+        return placed ? placed.get() : keys.data();
+    }
+};
+
+static void prepare_run(SORT_MODE mode, MEMORY_PLACEMENT placement, const std::vector<uint32_t> &input,
+                        mode_buffers &buffers) {
+    buffers.size = (uint32_t) input.size();
+
+    switch (mode) {
+        case KEYS:
+            if (placement == MEMORY_PLACEMENT_COUNT) {
+                buffers.keys = input;
+                break;
+            }
+            if (!buffers.placed) buffers.placed.reset(new uint32_t[input.size()]);
+            place_copy(buffers.placed.get(), input.data(), buffers.size, placement);
+            break;
+        case ARGSORT:
+            buffers.keys = input;
+            buffers.values.resize(input.size());
+            break;
+        case PAIRS:
+            buffers.keys = input;
+            buffers.values.resize(input.size());
+            std::iota(buffers.values.begin(), buffers.values.end(), 0u);
+            break;
+        case PACKED:
+            buffers.records.resize(input.size());
+            for (uint32_t i = 0; i < (uint32_t) input.size(); ++i) buffers.records[i] = pack_pair(input[i], i);
+            break;
+        default:
+            break;
+    }
+}
+
+// One benchmarked engine: a full sort in some mode, or a partial sort of keys with its k.
+// Parallel engines also carry their thread count and may carry an input placement,
+// which apply_engine_settings and prepare_run apply; NODE_LOCAL placement also sorts NUMA-aware.
+struct benchmark_engine {
+    const sorting_algorithm *sort = nullptr;
+    const selection_algorithm *selection = nullptr;
+    SORT_MODE mode = SORT_MODE::KEYS;
+    uint32_t k = 0;
+    uint32_t threads = 0;
+    MEMORY_PLACEMENT placement = MEMORY_PLACEMENT_COUNT;
+
+    const char *id() const {
+        return sort ? sort->id : selection->id;
+    }
+
+    // The id, with "/<threads>t" for parallel engines and "/<placement>" if placed.
+    std::string label() const {
+        std::string label = id();
+        if (threads) label += "/" + std::to_string(threads) + "t";
+        if (placement != MEMORY_PLACEMENT_COUNT) label += std::string("/") + MEMORY_PLACEMENT_IDS[placement];
+        return label;
+    }
+};
+
+static benchmark_engine sort_engine(const sorting_algorithm &algorithm, SORT_MODE mode, uint32_t threads,
+                                    MEMORY_PLACEMENT placement) {
+    benchmark_engine engine;
+    engine.sort = &algorithm;
+    engine.mode = mode;
+    if (algorithm.parallel) {
+        engine.threads = threads ? threads : active_threads();
+        engine.placement = placement;
+    }
+    return engine;
+}
+
+// k is clamped so that every engine does real work: below size for nth_element.
+static benchmark_engine selection_engine(const selection_algorithm &algorithm, uint32_t k, uint32_t size) {
+    benchmark_engine engine;
+    engine.selection = &algorithm;
+    engine.k = std::min(k, algorithm.kind == SELECTION::NTH_ELEMENT && size ? size - 1 : size);
+    return engine;
+}
+
+// Sets a parallel engine's thread count and NUMA mode and starts the shared pool for
+// them, so that no thread start-up lands inside a timed run.
+static void apply_engine_settings(const benchmark_engine &engine) {
+    if (!engine.sort || !engine.sort->parallel) return;
+
+    set_active_threads(engine.threads);
+    set_numa_aware(engine.placement == NODE_LOCAL);
+    shared_thread_pool();
+}
+
+static void run_sort(const benchmark_engine &engine, mode_buffers &buffers, const cancel_token &token) {
+    uint32_t size = buffers.size;
+
+    if (engine.selection) {
+        engine.selection->select(buffers.keys.data(), size, engine.k, token);
+        return;
+    }
+
+    const sorting_algorithm &algorithm = *engine.sort;
+
+    switch (engine.mode) {
+        case KEYS:
+            algorithm.sort(buffers.key_data(), size, token);
+            break;
+        case ARGSORT:
+            argsort(algorithm, buffers.keys.data(), buffers.values.data(), size, token);
+            break;
+        case PAIRS:
+            sort_pairs(algorithm, buffers.keys.data(), buffers.values.data(), size, token);
+            break;
+        case PACKED:
+            algorithm.sort_packed(buffers.records.data(), size, token);
+            break;
+        default:
+            break;
+    }
+}
+
+// Reads the keys of a finished run back in output order. For the modes that produce
+// indices, also returns false unless the indices are a permutation and each one points
+// at the key stored next to it.
+static bool collect_sorted_keys(SORT_MODE mode, const std::vector<uint32_t> &input, mode_buffers &buffers,
+                                std::vector<uint32_t> &keys) {
+    uint32_t size = (uint32_t) input.size();
+    if (mode == SORT_MODE::KEYS) {
+        keys.assign(buffers.key_data(), buffers.key_data() + size);
+        return true;
+    }
+
+    keys.resize(size);
+    std::vector<bool> seen(size);
+    bool indices_ok = true;
+
+    for (uint32_t i = 0; i < size; ++i) {
+        uint32_t index = mode == SORT_MODE::PACKED ? packed_value(buffers.records[i]) : buffers.values[i];
+        if (index >= size || seen[index]) return false;
+        seen[index] = true;
+
+        if (mode == SORT_MODE::ARGSORT) {
+            keys[i] = input[index];
+        } else {
+            keys[i] = mode == SORT_MODE::PACKED ? packed_key(buffers.records[i]) : buffers.keys[i];
+            if (keys[i] != input[index]) indices_ok = false;
+        }
+    }
+    return indices_ok;
+}
+
+// Times `repetitions` runs on fresh copies of `input`. With `perf`, the counters of
+// the fastest run are stored in `best_perf`.
+static std::vector<double> measure(
+        const benchmark_engine &engine,
+        const std::vector<uint32_t> &input,
+        uint32_t repetitions,
+        perf_counters *perf,
+        perf_results *best_perf
+) {
+    mode_buffers buffers;
+    std::vector<double> samples_ms;
+    cancel_token token;
+    apply_engine_settings(engine);
+
+    for (uint32_t r = 0; r < repetitions; ++r) {
+        prepare_run(engine.mode, engine.placement, input, buffers);
+
+        if (perf) perf->start();
+        auto start_time = std::chrono::high_resolution_clock::now();
+        run_sort(engine, buffers, token);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        if (perf) perf->stop();
+
+        double ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+        if (perf && (samples_ms.empty() || ms < *std::min_element(samples_ms.begin(), samples_ms.end()))) {
+            *best_perf = perf->results();
+        }
+        samples_ms.push_back(ms);
+    }
+
+    return samples_ms;
+}
+
+// Clears `verified` if --verify is given and the output is wrong.
+static std::vector<double> run_benchmark(
+        const benchmark_engine &engine,
+        const benchmark_options &options,
+        const std::vector<uint32_t> &input,
+        const char *input_label,
+        bool &verified
+) {
+    std::vector<uint32_t> arr;
+
+    cancel_token token;
+    perf_counters perf;
+    perf_results best_perf;
+
+    std::vector<double> samples_ms = measure(
+            engine,
+            input,
+            options.repetitions,
+            options.perf ? &perf : nullptr,
+            &best_perf
+    );
+
+    double best_ms = *std::min_element(samples_ms.begin(), samples_ms.end()), total_ms = 0;
+    for (double ms: samples_ms) total_ms += ms;
+
+    printf(
+            "%-12s %-13s %12u %12.3f %12.3f %10.3f",
+            engine.label().c_str(),
+            input_label,
+            options.size,
+            best_ms,
+            total_ms / options.repetitions,
+            options.size ? best_ms * 1e6 / options.size : 0.0
+    );
+
+    if (options.perf) {
+        // The counters follow the calling thread only, so they would miss the workers' share.
+        bool single_thread = engine.threads <= 1;
+        print_metric(single_thread ? best_perf.ipc() : -1, 6);
+        for (uint32_t e = BRANCH_MISSES; e < PERF_EVENT_COUNT; ++e) {
+            print_metric(single_thread ? best_perf.per_element((PERF_EVENT) e, options.size) : -1, 16);
+        }
+    }
+
+    if (options.counters) {
+        operation_counters counters;
+        arr = input;
+        if (engine.selection) {
+            engine.selection->select_counted(arr.data(), options.size, engine.k, token, counters);
+        } else {
+            engine.sort->sort_counted(arr.data(), options.size, token, counters);
+        }
+
+        operation_counts counts = counters.counts();
+        printf(
+                " %14llu %14llu %14llu %14llu %14llu %6u",
+                (unsigned long long) counts.comparisons,
+                (unsigned long long) counts.swaps,
+                (unsigned long long) counts.reads,
+                (unsigned long long) counts.writes,
+                (unsigned long long) counts.aux_bytes_peak,
+                counts.max_depth
+        );
+    }
+
+    if (options.verify) {
+        mode_buffers buffers;
+        apply_engine_settings(engine);
+        prepare_run(engine.mode, engine.placement, input, buffers);
+
+        // Timed the way a production run would pay for it: checksum before, both checks after.
+        auto start_time = std::chrono::high_resolution_clock::now();
+        uint64_t input_checksum = multiset_checksum(input.data(), options.size);
+        double verify_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start_time).count();
+
+        run_sort(engine, buffers, token);
+
+        start_time = std::chrono::high_resolution_clock::now();
+        std::vector<uint32_t> keys;
+        bool indices_ok = collect_sorted_keys(engine.mode, input, buffers, keys);
+        verify_result result = engine.selection
+                                ? verify_selection(input_checksum, keys.data(), options.size, engine.k, engine.selection->kind)
+                                : verify_sort(input_checksum, keys.data(), options.size);
+        verify_ms += std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start_time).count();
+
+        if (!indices_ok) {
+            result.permutation = false;
+            printf("  WRONG INDICES");
+        } else if (!result.sorted) {
+            printf("  UNSORTED at %u", result.first_unsorted);
+        } else if (!result.permutation) {
+            printf("  NOT A PERMUTATION");
+        } else {
+            printf("  verified in %.3f ms", verify_ms);
+        }
+        if (!result.ok()) verified = false;
+    }
+
+    printf("\n");
+    return samples_ms;
+}
+
+static int write_input_file(const benchmark_options &options) {
+    std::vector<uint32_t> keys(options.size);
+    std::mt19937 rng(options.seed);
+    generate_array(keys.data(), options.size, options.distribution, rng);
+
+    // 32-bit keys go through the dataset writer, so a .csv name gives a text dataset.
+    if (options.element_type == ELEMENT_TYPE::UINT32) {
+        std::string error;
+        if (!save_dataset(options.write_input_path, keys.data(), options.size, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        printf("Wrote %u keys to %s\n", options.size, options.write_input_path);
+        return 0;
+    }
+
+    FILE *file = fopen(options.write_input_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot create %s\n", options.write_input_path);
+        return 1;
+    }
+
+    // The distribution decides the order of the high halves; the low halves are noise.
+    std::vector<uint64_t> wide(options.size);
+    for (uint32_t i = 0; i < options.size; ++i) wide[i] = (uint64_t) keys[i] << 32 | rng();
+    bool written = fwrite(wide.data(), sizeof(uint64_t), wide.size(), file) == wide.size();
+
+    if (fclose(file) != 0 || !written) {
+        fprintf(stderr, "Cannot write %s\n", options.write_input_path);
+        return 1;
+    }
+    printf("Wrote %u keys to %s\n", options.size, options.write_input_path);
+    return 0;
+}
+
+static int run_external_sort(const benchmark_options &options, const sorting_algorithm *algorithm) {
+    if (!options.output_path) {
+        fprintf(stderr, "--external needs --output\n");
+        return 1;
+    }
+
+    external_sort_settings settings;
+    settings.type = options.element_type;
+    settings.memory_bytes = options.memory_mib << 20;
+    settings.temp_dir = options.temp_dir;
+    settings.direct_io = !options.buffered_io;
+    settings.algorithm = algorithm;
+
+    cancel_token token;
+    external_sort_stats stats;
+    if (!external_sort(options.external_path, options.output_path, settings, stats, token)) return 1;
+
+    double seconds = stats.run_seconds + stats.merge_seconds;
+    double megabytes = (double) stats.elements * (options.element_type == ELEMENT_TYPE::UINT64 ? 8 : 4) / 1e6;
+    printf("elements        %llu\n", (unsigned long long) stats.elements);
+    printf("runs            %u\n", stats.runs);
+    printf("merge passes    %u\n", stats.merge_passes);
+    printf("run formation   %.3f s\n", stats.run_seconds);
+    printf("merging         %.3f s\n", stats.merge_seconds);
+    printf("waiting on I/O  %.3f s (%s)\n", stats.io_stall_seconds, stats.io_backend);
+    printf("throughput      %.1f MB/s\n", seconds > 0 ? megabytes / seconds : 0.0);
+
+    if (options.verify) {
+        uint64_t elements;
+        bool sorted = verify_sorted_file(options.output_path, options.element_type, elements);
+        if (!sorted || elements != stats.elements) {
+            printf("output          NOT SORTED or truncated (%llu keys)\n", (unsigned long long) elements);
+            return 1;
+        }
+        printf("output          verified\n");
+    }
+    return 0;
+}
+
+// Sorts --size keys cut into segments of each distribution, with segmented_sort and
+// with a loop calling `algorithm` on every segment, both from the same input.
+static int run_segmented_benchmark(const benchmark_options &options, const sorting_algorithm &algorithm) {
+    std::mt19937 rng(options.seed);
+    std::vector<uint32_t> input(options.size);
+    generate_array(input.data(), options.size, options.distribution, rng);
+    // Started here so that no timed run includes thread start-up.
+    shared_thread_pool();
+
+    printf("input: %s\n", DISTRIBUTION_IDS[options.distribution]);
+    printf("%-12s %-13s %12s %12s %12s %10s %10s\n", "algorithm", "segments", "n", "best_ms", "mean_ms", "ns/elem",
+           "count");
+
+    bool verified = true;
+    for (SEGMENT_DISTRIBUTION distribution: options.segments) {
+        std::vector<uint32_t> offsets = generate_segment_offsets(options.size, distribution, rng);
+        uint32_t segments = (uint32_t) offsets.size() - 1;
+
+        std::vector<uint32_t> expected;
+        if (options.verify) {
+            expected = input;
+            for (uint32_t s = 0; s < segments; ++s) {
+                std::sort(expected.begin() + offsets[s], expected.begin() + offsets[s + 1]);
+            }
+        }
+
+        std::string loop_label = std::string(algorithm.id) + "/loop";
+        for (bool batched: {true, false}) {
+            std::vector<uint32_t> arr;
+            std::vector<double> samples_ms;
+            cancel_token token;
+
+            for (uint32_t r = 0; r < options.repetitions; ++r) {
+                arr = input;
+
+                auto start_time = std::chrono::high_resolution_clock::now();
+                if (batched) {
+                    segmented_sort(arr.data(), offsets.data(), segments, token);
+                } else {
+                    for (uint32_t s = 0; s < segments; ++s) {
+                        algorithm.sort(arr.data() + offsets[s], offsets[s + 1] - offsets[s], token);
+                    }
+                }
+                samples_ms.push_back(std::chrono::duration<double, std::milli>(
+                        std::chrono::high_resolution_clock::now() - start_time).count());
+            }
+
+            double best_ms = *std::min_element(samples_ms.begin(), samples_ms.end()), total_ms = 0;
+            for (double ms: samples_ms) total_ms += ms;
+
+            printf(
+                    "%-12s %-13s %12u %12.3f %12.3f %10.3f %10u",
+                    batched ? "segmented" : loop_label.c_str(),
+                    SEGMENT_DISTRIBUTION_IDS[distribution],
+                    options.size,
+                    best_ms,
+                    total_ms / options.repetitions,
+                    options.size ? best_ms * 1e6 / options.size : 0.0,
+                    segments
+            );
+            if (options.verify) {
+                bool ok = arr == expected;
+                printf(ok ? "  verified" : "  NOT SORTED");
+                if (!ok) verified = false;
+            }
+            printf("\n");
+        }
+    }
+    return verified ? 0 : 1;
+}
+
+static int compare_with_baseline(const benchmark_options &options) {
+    benchmark_baseline baseline, current;
+    if (!load_baseline(options.compare_path, baseline)) return 1;
+    describe_environment(current);
+
+    printf("baseline: %s (%s)\n", options.compare_path, baseline.created.c_str());
+    if (baseline.cpu != current.cpu) {
+        fprintf(stderr, "warning: baseline CPU \"%s\" differs from \"%s\"\n", baseline.cpu.c_str(), current.cpu.c_str());
+    }
+    if (baseline.compiler != current.compiler || baseline.flags != current.flags) {
+        fprintf(stderr, "warning: baseline was built with %s [%s]\n", baseline.compiler.c_str(), baseline.flags.c_str());
+    }
+
+    printf(
+            "%-12s %-13s %-8s %12s %12s %12s %9s %10s  %s\n",
+            "algorithm", "input", "mode", "n", "base_ms", "current_ms", "change", "p", "verdict"
+    );
+
+    uint32_t regressions = 0;
+    for (const baseline_entry &entry: baseline.entries) {
+        const sorting_algorithm *algorithm = find_sorting_algorithm(entry.algorithm.c_str());
+        const selection_algorithm *selection = algorithm ? nullptr : find_selection_algorithm(entry.algorithm.c_str());
+        DISTRIBUTION distribution;
+        SORT_MODE mode;
+        MEMORY_PLACEMENT placement = MEMORY_PLACEMENT_COUNT;
+        if ((!algorithm && !selection) || !parse_distribution(entry.distribution.c_str(), distribution) ||
+            !parse_sort_mode(entry.mode.c_str(), mode) ||
+            (!entry.placement.empty() && !parse_memory_placement(entry.placement.c_str(), placement))) {
+            fprintf(stderr, "Skipping %s/%s/%s: not known to this build\n", entry.algorithm.c_str(),
+                    entry.distribution.c_str(), entry.mode.c_str());
+            continue;
+        }
+
+        std::vector<uint32_t> input(entry.size);
+        std::mt19937 rng(baseline.seed);
+        generate_array(input.data(), entry.size, distribution, rng);
+
+        benchmark_engine engine = algorithm ? sort_engine(*algorithm, mode, entry.threads, placement)
+                                            : selection_engine(*selection, entry.k, entry.size);
+        std::vector<double> samples_ms = measure(engine, input, options.repetitions, nullptr, nullptr);
+
+        // Partial sorts show their k where full sorts show their mode.
+        char variant[16];
+        if (engine.selection) {
+            snprintf(variant, sizeof(variant), "k=%u", engine.k);
+        } else {
+            snprintf(variant, sizeof(variant), "%s", SORT_MODE_IDS[mode]);
+        }
+
+        double base_median = median(entry.samples_ms), current_median = median(samples_ms);
+        double change = base_median > 0 ? current_median / base_median - 1 : 0;
+        double p = mann_whitney_p(entry.samples_ms, samples_ms);
+
+        bool regressed = p < options.alpha && change > options.tolerance;
+        if (regressed) ++regressions;
+
+        printf(
+                "%-12s %-13s %-8s %12u %12.3f %12.3f %+8.1f%% %10.4f  %s\n",
+                engine.label().c_str(),
+                DISTRIBUTION_IDS[distribution],
+                variant,
+                entry.size,
+                base_median,
+                current_median,
+                change * 100,
+                p,
+                regressed ? "REGRESSION" : "ok"
+        );
+    }
+
+    if (regressions) {
+        printf("%u regression(s) at alpha %.3g\n", regressions, options.alpha);
+        return EXIT_REGRESSION;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    benchmark_options options;
+
+    if (argc > 1 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)) {
+        print_usage(argv[0]);
+        return 0;
+    }
+
+    if (!parse_arguments(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (options.perf && !perf_counters().available()) {
+        fprintf(stderr, "Hardware counters are unavailable (not Linux, perf_event_paranoid or container policy).\n");
+    }
+
+    if (options.compare_path) return compare_with_baseline(options);
+    if (options.write_input_path) return write_input_file(options);
+
+    const sorting_algorithm *selected = nullptr;
+    const selection_algorithm *selected_partial = nullptr;
+    if (strcmp(options.algorithm, "all") != 0) {
+        selected = find_sorting_algorithm(options.algorithm);
+        selected_partial = find_selection_algorithm(options.algorithm);
+        if (!selected && !selected_partial) {
+            fprintf(stderr, "Unknown algorithm: %s\n", options.algorithm);
+            return 1;
+        }
+        if (selected_partial && (options.external_path || options.mode != SORT_MODE::KEYS)) {
+            fprintf(stderr, "%s is a partial sort and only runs in memory with --mode keys\n", options.algorithm);
+            return 1;
+        }
+    }
+
+    if (options.external_path) return run_external_sort(options, selected);
+    if (!options.segments.empty()) {
+        if (selected_partial) {
+            fprintf(stderr, "--segments compares against a full sort, not %s\n", options.algorithm);
+            return 1;
+        }
+        return run_segmented_benchmark(options, selected ? *selected : *find_sorting_algorithm("merge"));
+    }
+
+    std::vector<uint32_t> input;
+    const char *input_label = DISTRIBUTION_IDS[options.distribution];
+
+    if (options.input_path) {
+        std::string error;
+        if (!load_dataset(options.input_path, input, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        options.size = (uint32_t) input.size();
+
+        const char *slash = strrchr(options.input_path, '/');
+        input_label = slash ? slash + 1 : options.input_path;
+    } else {
+        input.resize(options.size);
+        std::mt19937 rng(options.seed);
+        generate_array(input.data(), options.size, options.distribution, rng);
+    }
+
+    std::vector<benchmark_engine> engines;
+    for (uint32_t a = 0; a < SORTING_ALGORITHMS_COUNT; ++a) {
+        const sorting_algorithm &algorithm = SORTING_ALGORITHMS[a];
+        if (selected_partial || (selected && selected != &algorithm)) continue;
+
+        if (!algorithm.parallel) {
+            engines.push_back(sort_engine(algorithm, options.mode, 0, MEMORY_PLACEMENT_COUNT));
+            continue;
+        }
+
+        std::vector<uint32_t> thread_counts = options.threads;
+        if (thread_counts.empty()) thread_counts.push_back(0);
+        std::vector<MEMORY_PLACEMENT> placements = options.placements;
+        if (placements.empty()) placements.push_back(MEMORY_PLACEMENT_COUNT);
+
+        for (uint32_t threads: thread_counts) {
+            for (MEMORY_PLACEMENT placement: placements) {
+                engines.push_back(sort_engine(algorithm, options.mode, threads, placement));
+            }
+        }
+    }
+
+    // Partial sorts have no key-value modes, so `all` only includes them for plain keys.
+    uint32_t k = options.k_median ? options.size / 2 : options.k;
+    for (uint32_t a = 0; a < SELECTION_ALGORITHMS_COUNT && options.mode == SORT_MODE::KEYS; ++a) {
+        if (selected || (selected_partial && selected_partial != &SELECTION_ALGORITHMS[a])) continue;
+        engines.push_back(selection_engine(SELECTION_ALGORITHMS[a], k, options.size));
+    }
+
+    if (options.mode != SORT_MODE::KEYS) printf("mode: %s\n", SORT_MODE_IDS[options.mode]);
+    if (!options.placements.empty()) printf("numa nodes: %u\n", (uint32_t) numa_nodes().size());
+    if (thread_affinity() != AFFINITY_NONE) printf("affinity: %s\n", THREAD_AFFINITY_IDS[thread_affinity()]);
+    if (!selected) printf("k: %u (partial sorts)\n", k);
+    if (options.perf && std::any_of(engines.begin(), engines.end(), [](const benchmark_engine &engine) {
+        return engine.threads > 1;
+    })) {
+        printf("perf: n/a for engines on more than one thread (counters cover the calling thread only)\n");
+    }
+    printf("%-12s %-13s %12s %12s %12s %10s", "algorithm", "input", "n", "best_ms", "mean_ms", "ns/elem");
+    if (options.perf) {
+        printf(" %6s", "ipc");
+        for (uint32_t e = BRANCH_MISSES; e < PERF_EVENT_COUNT; ++e) {
+            char header[32];
+            snprintf(header, sizeof(header), "%s/el", PERF_EVENT_NAMES[e]);
+            printf(" %16s", header);
+        }
+    }
+    if (options.counters) {
+        printf(
+                " %14s %14s %14s %14s %14s %6s",
+                "comparisons", "swaps", "reads", "writes", "aux_peak_B", "depth"
+        );
+    }
+    printf("\n");
+
+    bool verified = true;
+    benchmark_baseline baseline;
+    describe_environment(baseline);
+    baseline.seed = options.seed;
+
+    for (const benchmark_engine &engine: engines) {
+        // Datasets cannot be regenerated from a seed, so --compare skips their entries.
+        baseline_entry entry;
+        entry.algorithm = engine.id();
+        entry.distribution = input_label;
+        entry.mode = SORT_MODE_IDS[engine.mode];
+        entry.k = engine.k;
+        entry.threads = engine.threads;
+        if (engine.placement != MEMORY_PLACEMENT_COUNT) entry.placement = MEMORY_PLACEMENT_IDS[engine.placement];
+        entry.size = options.size;
+        entry.samples_ms = run_benchmark(engine, options, input, input_label, verified);
+        baseline.entries.push_back(entry);
+    }
+
+    if (options.output_path && !engines.empty()) {
+        const benchmark_engine &last_run = engines.back();
+        cancel_token token;
+        if (last_run.selection) {
+            last_run.selection->select(input.data(), options.size, last_run.k, token);
+        } else {
+            last_run.sort->sort(input.data(), options.size, token);
+        }
+
+        std::string error;
+        if (!save_dataset(options.output_path, input.data(), options.size, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        printf("Saved %s output to %s\n", last_run.id(), options.output_path);
+    }
+
+    if (options.save_path) {
+        if (!save_baseline(options.save_path, baseline)) {
+            fprintf(stderr, "Cannot write baseline %s\n", options.save_path);
+            return 1;
+        }
+        printf("Saved baseline to %s\n", options.save_path);
+    }
+
+    return verified ? 0 : 1;
+}
@@ -0,0 +1,397 @@
+#include "benchmark_baseline.h"
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+
+#ifndef SORTING_BUILD_FLAGS
+#define SORTING_BUILD_FLAGS "unknown"
+#endif
+
+static std::string cpu_model() {
+#if defined(__linux__)
+    FILE *file = fopen("/proc/cpuinfo", "r");
+    if (file) {
+        char line[512];
+        while (fgets(line, sizeof(line), file)) {
+            if (strncmp(line, "model name", 10) != 0) continue;
+
+            const char *value = strchr(line, ':');
+            if (!value) continue;
+            value += 1 + strspn(value + 1, " \t");
+
+            std::string model(value);
+            while (!model.empty() && (model.back() == '\n' || model.back() == ' ')) model.pop_back();
+            fclose(file);
+            return model;
+        }
+        fclose(file);
+    }
+#endif
+    return "unknown";
+}
+
+static std::string compiler_version() {
+#if defined(__clang__)
+    return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    return std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+    return "unknown";
+#endif
+}
+
+void describe_environment(benchmark_baseline &baseline) {
+    baseline.cpu = cpu_model();
+    baseline.compiler = compiler_version();
+    baseline.flags = std::string(SORTING_BUILD_FLAGS) + " isa=" + CPU_ISA_IDS[active_isa()];
+
+    char created[32];
+    time_t now = time(nullptr);
+    strftime(created, sizeof(created), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    baseline.created = created;
+}
+
+static void write_string(FILE *file, const std::string &value) {
+    fputc('"', file);
+    for (char c: value) {
+        if (c == '"' || c == '\\') {
+            fprintf(file, "\\%c", c);
+        } else if ((unsigned char) c < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned) c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool save_baseline(const char *path, const benchmark_baseline &baseline) {
+    FILE *file = fopen(path, "w");
+    if (!file) return false;
+
+    fprintf(file, "{\n  \"version\": %u,\n  \"cpu\": ", baseline.version);
+    write_string(file, baseline.cpu);
+    fprintf(file, ",\n  \"compiler\": ");
+    write_string(file, baseline.compiler);
+    fprintf(file, ",\n  \"flags\": ");
+    write_string(file, baseline.flags);
+    fprintf(file, ",\n  \"created\": ");
+    write_string(file, baseline.created);
+    fprintf(file, ",\n  \"seed\": %u,\n  \"entries\": [", baseline.seed);
+
+    for (size_t e = 0; e < baseline.entries.size(); ++e) {
+        const baseline_entry &entry = baseline.entries[e];
+
+        fprintf(file, "%s\n    {\"algorithm\": ", e ? "," : "");
+        write_string(file, entry.algorithm);
+        fprintf(file, ", \"distribution\": ");
+        write_string(file, entry.distribution);
+        fprintf(file, ", \"mode\": ");
+        write_string(file, entry.mode);
+        fprintf(file, ", \"placement\": ");
+        write_string(file, entry.placement);
+        fprintf(file, ", \"k\": %u, \"threads\": %u, \"size\": %u, \"samples_ms\": [", entry.k, entry.threads, entry.size);
+        for (size_t s = 0; s < entry.samples_ms.size(); ++s) {
+            fprintf(file, "%s%.6f", s ? ", " : "", entry.samples_ms[s]);
+        }
+        fprintf(file, "]}");
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+// Just enough JSON to read back what save_baseline writes, plus whatever a person
+// might reasonably add by hand (unknown keys, whitespace, escapes).
+struct json_value {
+    enum TYPE {NIL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT} type = NIL;
+    double number = 0;
+    std::string string;
+    std::vector<json_value> array;
+    std::map<std::string, json_value> object;
+
+    const json_value *find(const char *key) const {
+        auto it = object.find(key);
+        return it == object.end() ? nullptr : &it->second;
+    }
+};
+
+struct json_parser {
+    const char *p;
+
+    void skip_whitespace() {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') ++p;
+    }
+
+    bool parse_string(std::string &out) {
+        if (*p != '"') return false;
+        ++p;
+
+        while (*p && *p != '"') {
+            if (*p != '\\') {
+                out += *p++;
+                continue;
+            }
+
+            ++p;
+            switch (*p) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    char hex[5] = {};
+                    for (int i = 0; i < 4; ++i) {
+                        if (!p[1 + i]) return false;
+                        hex[i] = p[1 + i];
+                    }
+                    unsigned code = (unsigned) strtoul(hex, nullptr, 16);
+                    out += code < 0x80 ? (char) code : '?';
+                    p += 4;
+                    break;
+                }
+                case 0: return false;
+                default: out += *p; break;
+            }
+            ++p;
+        }
+
+        if (*p != '"') return false;
+        ++p;
+        return true;
+    }
+
+    bool parse(json_value &value, uint32_t depth = 0) {
+        if (depth > 64) return false;
+        skip_whitespace();
+
+        if (*p == '{') {
+            value.type = json_value::OBJECT;
+            ++p;
+            skip_whitespace();
+            if (*p == '}') return ++p, true;
+
+            while (true) {
+                std::string key;
+                skip_whitespace();
+                if (!parse_string(key)) return false;
+                skip_whitespace();
+                if (*p++ != ':') return false;
+                if (!parse(value.object[key], depth + 1)) return false;
+                skip_whitespace();
+                if (*p == ',') { ++p; continue; }
+                if (*p == '}') return ++p, true;
+                return false;
+            }
+        }
+
+        if (*p == '[') {
+            value.type = json_value::ARRAY;
+            ++p;
+            skip_whitespace();
+            if (*p == ']') return ++p, true;
+
+            while (true) {
+                value.array.emplace_back();
+                if (!parse(value.array.back(), depth + 1)) return false;
+                skip_whitespace();
+                if (*p == ',') { ++p; continue; }
+                if (*p == ']') return ++p, true;
+                return false;
+            }
+        }
+
+        if (*p == '"') {
+            value.type = json_value::STRING;
+            return parse_string(value.string);
+        }
+
+        if (strncmp(p, "true", 4) == 0 || strncmp(p, "false", 5) == 0) {
+            value.type = json_value::BOOLEAN;
+            value.number = *p == 't';
+            p += *p == 't' ? 4 : 5;
+            return true;
+        }
+
+        if (strncmp(p, "null", 4) == 0) {
+            p += 4;
+            return true;
+        }
+
+        char *end;
+        value.number = strtod(p, &end);
+        if (end == p) return false;
+        value.type = json_value::NUMBER;
+        p = end;
+        return true;
+    }
+};
+
+static std::string string_or_empty(const json_value &object, const char *key) {
+    const json_value *value = object.find(key);
+    return value && value->type == json_value::STRING ? value->string : std::string();
+}
+
+bool load_baseline(const char *path, benchmark_baseline &baseline) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open baseline %s\n", path);
+        return false;
+    }
+
+    std::string text;
+    char chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) text.append(chunk, read);
+    fclose(file);
+
+    json_value root;
+    json_parser parser{text.c_str()};
+    if (!parser.parse(root) || root.type != json_value::OBJECT) {
+        fprintf(stderr, "Baseline %s is not valid JSON\n", path);
+        return false;
+    }
+
+    const json_value *version = root.find("version");
+    if (!version || version->type != json_value::NUMBER || (uint32_t) version->number != BASELINE_FORMAT_VERSION) {
+        fprintf(stderr, "Baseline %s has an unsupported format version\n", path);
+        return false;
+    }
+
+    baseline = benchmark_baseline();
+    baseline.cpu = string_or_empty(root, "cpu");
+    baseline.compiler = string_or_empty(root, "compiler");
+    baseline.flags = string_or_empty(root, "flags");
+    baseline.created = string_or_empty(root, "created");
+
+    const json_value *seed = root.find("seed");
+    if (seed && seed->type == json_value::NUMBER) baseline.seed = (uint32_t) seed->number;
+
+    const json_value *entries = root.find("entries");
+    if (!entries || entries->type != json_value::ARRAY) {
+        fprintf(stderr, "Baseline %s has no entries\n", path);
+        return false;
+    }
+
+    for (const json_value &item: entries->array) {
+        if (item.type != json_value::OBJECT) continue;
+
+        baseline_entry entry;
+        entry.algorithm = string_or_empty(item, "algorithm");
+        entry.distribution = string_or_empty(item, "distribution");
+        if (item.find("mode")) entry.mode = string_or_empty(item, "mode");
+        entry.placement = string_or_empty(item, "placement");
+
+        const json_value *k = item.find("k");
+        if (k && k->type == json_value::NUMBER) entry.k = (uint32_t) k->number;
+
+        const json_value *threads = item.find("threads");
+        if (threads && threads->type == json_value::NUMBER) entry.threads = (uint32_t) threads->number;
+
+        const json_value *size = item.find("size");
+        if (size && size->type == json_value::NUMBER) entry.size = (uint32_t) size->number;
+
+        const json_value *samples = item.find("samples_ms");
+        if (samples && samples->type == json_value::ARRAY) {
+            for (const json_value &sample: samples->array) {
+                if (sample.type == json_value::NUMBER) entry.samples_ms.push_back(sample.number);
+            }
+        }
+
+        if (entry.algorithm.empty() || entry.samples_ms.empty()) {
+            fprintf(stderr, "Skipping malformed baseline entry\n");
+            continue;
+        }
+        baseline.entries.push_back(entry);
+    }
+
+    return true;
+}
+
+double median(std::vector<double> samples) {
+    if (samples.empty()) return 0;
+
+    size_t middle = samples.size() / 2;
+    std::nth_element(samples.begin(), samples.begin() + middle, samples.end());
+    if (samples.size() % 2) return samples[middle];
+
+    double upper = samples[middle];
+    double lower = *std::max_element(samples.begin(), samples.begin() + middle);
+    return (lower + upper) / 2;
+}
+
+// Number of orderings of m + n tie-free samples whose U statistic is exactly u, for all u.
+// f(m, n, u) = f(m - 1, n, u - n) + f(m, n - 1, u): the largest sample belongs to one group or the other.
+static std::vector<double> u_frequencies(uint32_t m, uint32_t n) {
+    uint32_t max_u = m * n;
+    std::vector<std::vector<double>> previous(n + 1), current(n + 1);
+
+    for (uint32_t j = 0; j <= n; ++j) previous[j].assign(max_u + 1, 0), previous[j][0] = 1;
+
+    for (uint32_t i = 1; i <= m; ++i) {
+        for (uint32_t j = 0; j <= n; ++j) {
+            current[j].assign(max_u + 1, 0);
+            for (uint32_t u = 0; u <= max_u; ++u) {
+                if (u >= j) current[j][u] += previous[j][u - j];
+                if (j > 0) current[j][u] += current[j - 1][u];
+            }
+        }
+        std::swap(previous, current);
+    }
+
+    return previous[n];
+}
+
+double mann_whitney_p(const std::vector<double> &baseline, const std::vector<double> &current) {
+    uint32_t m = (uint32_t) current.size(), n = (uint32_t) baseline.size();
+    if (!m || !n) return 1;
+
+    double u = 0;
+    bool ties = false;
+    for (double c: current) {
+        for (double b: baseline) {
+            if (c > b) u += 1;
+            if (c == b) u += 0.5, ties = true;
+        }
+    }
+
+    if (!ties && m <= 20 && n <= 20) {
+        std::vector<double> frequencies = u_frequencies(m, n);
+
+        double total = 0, tail = 0;
+        for (uint32_t k = 0; k < frequencies.size(); ++k) {
+            total += frequencies[k];
+            if (k >= (uint32_t) u) tail += frequencies[k];
+        }
+        return tail / total;
+    }
+
+    std::vector<double> pooled(baseline);
+    pooled.insert(pooled.end(), current.begin(), current.end());
+    std::sort(pooled.begin(), pooled.end());
+
+    double tie_sum = 0;
+    for (size_t i = 0; i < pooled.size();) {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j] == pooled[i]) ++j;
+        double t = (double) (j - i);
+        tie_sum += t * t * t - t;
+        i = j;
+    }
+
+    double total = (double) (m + n);
+    double variance = (double) m * n / 12.0 * ((total + 1) - tie_sum / (total * (total - 1)));
+    if (variance <= 0) return 1;
+
+    double z = (u - (double) m * n / 2 - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
@@ -0,0 +1,49 @@
+#ifndef SORTING_ALGORITHMS_BENCHMARK_BASELINE_H
+#define SORTING_ALGORITHMS_BENCHMARK_BASELINE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bumped whenever the JSON layout changes; older files are rejected on load.
+const uint32_t BASELINE_FORMAT_VERSION = 1;
+
+struct baseline_entry {
+    std::string algorithm;
+    std::string distribution;
+    // A SORT_MODE id; entries from before modes existed load as "keys".
+    std::string mode = "keys";
+    // k of a partial sort; 0 for full sorts.
+    uint32_t k = 0;
+    // Threads a parallel engine ran on; 0 for the others.
+    uint32_t threads = 0;
+    // MEMORY_PLACEMENT id of the input; empty if it was not placed.
+    std::string placement;
+    uint32_t size = 0;
+    std::vector<double> samples_ms;
+};
+
+struct benchmark_baseline {
+    uint32_t version = BASELINE_FORMAT_VERSION;
+    std::string cpu;
+    std::string compiler;
+    std::string flags;
+    std::string created;
+    uint32_t seed = 0;
+    std::vector<baseline_entry> entries;
+};
+
+// Fills cpu, compiler, flags and created for the running binary.
+void describe_environment(benchmark_baseline &baseline);
+
+bool save_baseline(const char *path, const benchmark_baseline &baseline);
+bool load_baseline(const char *path, benchmark_baseline &baseline);
+
+// One-sided Mann-Whitney U test: probability of seeing samples at least this much
+// slower in `current` than in `baseline` if both came from the same distribution.
+// Exact for small tie-free samples, normal approximation with tie correction otherwise.
+double mann_whitney_p(const std::vector<double> &baseline, const std::vector<double> &current);
+
+double median(std::vector<double> samples);
+
+#endif //SORTING_ALGORITHMS_BENCHMARK_BASELINE_H
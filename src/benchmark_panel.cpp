@@ -0,0 +1,225 @@
+#include "benchmark_panel.h"
+
+#include "imgui.h"
+
+#include "algorithm_registry.h"
+#include "cache_info.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static const ImU32 SERIES_COLORS[] = {
+        IM_COL32(230, 80, 80, 255),
+        IM_COL32(80, 200, 120, 255),
+        IM_COL32(90, 140, 240, 255),
+        IM_COL32(240, 200, 60, 255),
+        IM_COL32(200, 100, 220, 255),
+        IM_COL32(60, 210, 220, 255),
+        IM_COL32(250, 150, 60, 255),
+        IM_COL32(180, 180, 180, 255)
+};
+
+static ImU32 series_color(uint32_t algorithm, DISTRIBUTION distribution) {
+    uint32_t index = algorithm * DISTRIBUTION_COUNT + distribution;
+    return SERIES_COLORS[index % (sizeof(SERIES_COLORS) / sizeof(SERIES_COLORS[0]))];
+}
+
+static void draw_scaling_plot(const std::vector<sweep_point> &points, const cache_sizes &caches) {
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 size = ImGui::GetContentRegionAvail();
+    if (size.x < 100) size.x = 100;
+    if (size.y < 200) size.y = 200;
+
+    ImGui::InvisibleButton("plot", size);
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    draw_list->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(20, 20, 20, 255));
+
+    if (points.empty()) {
+        draw_list->AddText(ImVec2(origin.x + 10, origin.y + 10), IM_COL32(160, 160, 160, 255), "No results yet.");
+        return;
+    }
+
+    double min_x = 64, max_x = 0, min_y = 1e300, max_y = -1e300;
+    for (const sweep_point &point: points) {
+        double x = std::log2((double) point.size), y = std::log10(std::max(point.ns_per_element, 1e-3));
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+    }
+    min_y = std::floor(min_y);
+    max_y = std::ceil(max_y);
+    if (max_x - min_x < 1) max_x = min_x + 1;
+    if (max_y - min_y < 1) max_y = min_y + 1;
+
+    const float MARGIN_LEFT = 60, MARGIN_BOTTOM = 24, MARGIN = 10;
+    float left = origin.x + MARGIN_LEFT, right = origin.x + size.x - MARGIN;
+    float top = origin.y + MARGIN, bottom = origin.y + size.y - MARGIN_BOTTOM;
+
+    auto to_screen = [&](double x, double y) {
+        return ImVec2(
+                left + (float) ((x - min_x) / (max_x - min_x)) * (right - left),
+                bottom - (float) ((y - min_y) / (max_y - min_y)) * (bottom - top)
+        );
+    };
+
+    char label[32];
+
+    for (int x = (int) std::ceil(min_x); x <= (int) max_x; ++x) {
+        ImVec2 p = to_screen(x, min_y);
+        draw_list->AddLine(ImVec2(p.x, top), ImVec2(p.x, bottom), IM_COL32(50, 50, 50, 255));
+        if ((x - (int) std::ceil(min_x)) % 2 == 0) {
+            snprintf(label, sizeof(label), "2^%d", x);
+            draw_list->AddText(ImVec2(p.x - 10, bottom + 4), IM_COL32(160, 160, 160, 255), label);
+        }
+    }
+
+    for (int y = (int) min_y; y <= (int) max_y; ++y) {
+        ImVec2 p = to_screen(min_x, y);
+        draw_list->AddLine(ImVec2(left, p.y), ImVec2(right, p.y), IM_COL32(50, 50, 50, 255));
+        snprintf(label, sizeof(label), "%g ns", std::pow(10.0, y));
+        draw_list->AddText(ImVec2(origin.x + 4, p.y - 7), IM_COL32(160, 160, 160, 255), label);
+    }
+
+    // Knees: the n at which a uint32_t array stops fitting in each cache level.
+    const uint64_t CACHE_BYTES[] = {caches.l1d, caches.l2, caches.l3};
+    const char *CACHE_NAMES[] = {"L1", "L2", "L3"};
+    float last_knee = -1;
+    for (uint32_t level = 0; level < 3; ++level) {
+        if (!CACHE_BYTES[level]) continue;
+
+        double x = std::log2((double) CACHE_BYTES[level] / sizeof(uint32_t));
+        if (x < min_x || x > max_x) continue;
+
+        ImVec2 p = to_screen(x, min_y);
+        draw_list->AddLine(ImVec2(p.x, top), ImVec2(p.x, bottom), IM_COL32(200, 200, 80, 160), 1.5f);
+        draw_list->AddText(ImVec2(p.x - 16, top), IM_COL32(200, 200, 80, 255), CACHE_NAMES[level]);
+        last_knee = p.x;
+    }
+    if (last_knee >= 0 && caches.l3 && last_knee + 50 < right) {
+        draw_list->AddText(ImVec2(last_knee + 4, top), IM_COL32(200, 200, 80, 255), "DRAM");
+    }
+
+    ImVec2 mouse = ImGui::GetIO().MousePos;
+    const sweep_point *hovered = nullptr;
+    float hovered_distance = 64;
+
+    for (uint32_t algorithm = 0; algorithm < SORTING_ALGORITHMS_COUNT; ++algorithm) {
+        for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) {
+            ImU32 color = series_color(algorithm, (DISTRIBUTION) d);
+            ImVec2 previous;
+            bool has_previous = false;
+
+            for (const sweep_point &point: points) {
+                if (point.algorithm != algorithm || point.distribution != d) continue;
+
+                ImVec2 p = to_screen(
+                        std::log2((double) point.size),
+                        std::log10(std::max(point.ns_per_element, 1e-3))
+                );
+                if (has_previous) draw_list->AddLine(previous, p, color, 2.0f);
+                draw_list->AddCircleFilled(p, 3.0f, color);
+                previous = p;
+                has_previous = true;
+
+                float distance = (p.x - mouse.x) * (p.x - mouse.x) + (p.y - mouse.y) * (p.y - mouse.y);
+                if (distance < hovered_distance) {
+                    hovered_distance = distance;
+                    hovered = &point;
+                }
+            }
+        }
+    }
+
+    if (hovered && ImGui::IsItemHovered()) {
+        ImGui::SetTooltip(
+                "%s / %s\nn = %llu\n%.3f ns per element",
+                SORTING_ALGORITHMS[hovered->algorithm].name,
+                DISTRIBUTION_NAMES[hovered->distribution],
+                (unsigned long long) hovered->size,
+                hovered->ns_per_element
+        );
+    }
+}
+
+void draw_benchmark_panel(bool *open, benchmark_sweep &sweep) {
+    static bool selected_algorithms[64] = {true, true};
+    static bool selected_distributions[64] = {true};
+    static int min_exponent = 10, max_exponent = 22, repetitions = 3;
+    static float time_limit = 2.0f;
+    static cache_sizes caches = detect_cache_sizes();
+
+    ImGui::SetNextWindowSize(ImVec2(720, 520), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Benchmark", open)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("Algorithms:");
+    for (uint32_t a = 0; a < SORTING_ALGORITHMS_COUNT && a < 64; ++a) {
+        ImGui::SameLine();
+        ImGui::Checkbox(SORTING_ALGORITHMS[a].name, &selected_algorithms[a]);
+    }
+
+    ImGui::Text("Inputs:");
+    for (uint32_t d = 0; d < DISTRIBUTION_COUNT && d < 64; ++d) {
+        ImGui::SameLine();
+        ImGui::Checkbox(DISTRIBUTION_NAMES[d], &selected_distributions[d]);
+    }
+
+    ImGui::SliderInt("Min Size (2^n)", &min_exponent, 1, 28);
+    ImGui::SliderInt("Max Size (2^n)", &max_exponent, 1, 28);
+    if (max_exponent < min_exponent) max_exponent = min_exponent;
+    ImGui::SliderInt("Repetitions", &repetitions, 1, 20);
+    ImGui::SliderFloat("Time Limit Per Run (s)", &time_limit, 0.1f, 60.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Larger sizes of a series are skipped once one run takes longer than this.");
+
+    if (sweep.running()) {
+        if (ImGui::Button("Stop")) sweep.stop();
+        ImGui::SameLine();
+        ImGui::ProgressBar(sweep.progress(), ImVec2(-1, 0));
+    } else if (ImGui::Button("Run Sweep")) {
+        sweep_settings settings;
+        for (uint32_t a = 0; a < SORTING_ALGORITHMS_COUNT && a < 64; ++a) {
+            if (selected_algorithms[a]) settings.algorithms.push_back(a);
+        }
+        for (uint32_t d = 0; d < DISTRIBUTION_COUNT && d < 64; ++d) {
+            if (selected_distributions[d]) settings.distributions.push_back((DISTRIBUTION) d);
+        }
+        settings.min_exponent = min_exponent;
+        settings.max_exponent = max_exponent;
+        settings.repetitions = repetitions;
+        settings.time_limit_seconds = time_limit;
+        sweep.start(settings);
+    }
+
+    std::vector<sweep_point> points = sweep.points();
+
+    for (uint32_t a = 0; a < SORTING_ALGORITHMS_COUNT; ++a) {
+        for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) {
+            bool present = std::any_of(points.begin(), points.end(), [&](const sweep_point &point) {
+                return point.algorithm == a && point.distribution == d;
+            });
+            if (!present) continue;
+
+            ImGui::PushID((int) (a * DISTRIBUTION_COUNT + d));
+            ImGui::ColorButton(
+                    "##legend",
+                    ImGui::ColorConvertU32ToFloat4(series_color(a, (DISTRIBUTION) d)),
+                    ImGuiColorEditFlags_NoTooltip,
+                    ImVec2(10, 10)
+            );
+            ImGui::PopID();
+            ImGui::SameLine();
+            ImGui::Text("%s / %s", SORTING_ALGORITHMS[a].name, DISTRIBUTION_NAMES[d]);
+            ImGui::SameLine();
+        }
+    }
+    ImGui::NewLine();
+
+    draw_scaling_plot(points, caches);
+
+    ImGui::End();
+}
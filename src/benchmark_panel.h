@@ -0,0 +1,10 @@
+#ifndef SORTING_ALGORITHMS_BENCHMARK_PANEL_H
+#define SORTING_ALGORITHMS_BENCHMARK_PANEL_H
+
+#include "benchmark_sweep.h"
+
+// ImGui window that configures a benchmark_sweep and plots time per element
+// against n on log-log axes, with the data cache sizes marked as knees.
+void draw_benchmark_panel(bool *open, benchmark_sweep &sweep);
+
+#endif //SORTING_ALGORITHMS_BENCHMARK_PANEL_H
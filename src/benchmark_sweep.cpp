@@ -0,0 +1,104 @@
+#include "benchmark_sweep.h"
+
+#include "algorithm_registry.h"
+
+#include <chrono>
+#include <random>
+
+benchmark_sweep::~benchmark_sweep() {
+    stop();
+    join();
+}
+
+bool benchmark_sweep::start(const sweep_settings &settings) {
+    if (active.load()) return false;
+    join();
+
+    {
+        std::lock_guard<std::mutex> lock(points_mutex);
+        results.clear();
+    }
+
+    cancel.reset();
+    completed.store(0);
+    total.store(
+            (uint32_t) (settings.algorithms.size() * settings.distributions.size()) *
+            (settings.max_exponent >= settings.min_exponent ? settings.max_exponent - settings.min_exponent + 1 : 0)
+    );
+    active.store(true);
+
+    worker = std::thread(&benchmark_sweep::run, this, settings);
+    return true;
+}
+
+void benchmark_sweep::stop() {
+    cancel.request();
+}
+
+bool benchmark_sweep::running() const {
+    return active.load();
+}
+
+float benchmark_sweep::progress() const {
+    uint32_t all = total.load();
+    return all ? (float) completed.load() / (float) all : 0.0f;
+}
+
+std::vector<sweep_point> benchmark_sweep::points() const {
+    std::lock_guard<std::mutex> lock(points_mutex);
+    return results;
+}
+
+void benchmark_sweep::join() {
+    if (worker.joinable()) worker.join();
+}
+
+void benchmark_sweep::run(sweep_settings settings) {
+    uint32_t points_per_series = settings.max_exponent - settings.min_exponent + 1;
+
+    for (uint32_t algorithm: settings.algorithms) {
+        for (DISTRIBUTION distribution: settings.distributions) {
+            uint32_t done = 0;
+
+            for (uint32_t e = settings.min_exponent; e <= settings.max_exponent && !cancel.requested(); ++e) {
+                uint32_t size = 1u << e;
+                std::vector<uint32_t> input(size), arr(size);
+                std::mt19937 rng(settings.seed + e);
+                generate_array(input.data(), size, distribution, rng);
+
+                double best_seconds = 0;
+                for (uint32_t r = 0; r < settings.repetitions && !cancel.requested(); ++r) {
+                    arr = input;
+
+                    auto start_time = std::chrono::high_resolution_clock::now();
+                    SORTING_ALGORITHMS[algorithm].sort(arr.data(), size, cancel);
+                    auto end_time = std::chrono::high_resolution_clock::now();
+
+                    double seconds = std::chrono::duration<double>(end_time - start_time).count();
+                    if (r == 0 || seconds < best_seconds) best_seconds = seconds;
+
+                    // One run past the limit is enough to place the point.
+                    if (seconds > settings.time_limit_seconds) break;
+                }
+
+                if (cancel.requested()) break;
+
+                {
+                    std::lock_guard<std::mutex> lock(points_mutex);
+                    results.push_back({algorithm, distribution, size, best_seconds * 1e9 / size});
+                }
+
+                ++done;
+                completed.fetch_add(1);
+
+                if (best_seconds > settings.time_limit_seconds) break;
+            }
+
+            // Sizes skipped because of the time limit still count towards progress.
+            completed.fetch_add(points_per_series - done);
+            if (cancel.requested()) break;
+        }
+    }
+
+    active.store(false);
+}
@@ -0,0 +1,62 @@
+#ifndef SORTING_ALGORITHMS_BENCHMARK_SWEEP_H
+#define SORTING_ALGORITHMS_BENCHMARK_SWEEP_H
+
+#include "array_generators.h"
+#include "cancel_token.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct sweep_settings {
+    std::vector<uint32_t> algorithms;
+    std::vector<DISTRIBUTION> distributions;
+    uint32_t min_exponent = 10;
+    uint32_t max_exponent = 22;
+    uint32_t repetitions = 3;
+    // Once a single run of a series takes longer than this, larger sizes are skipped.
+    double time_limit_seconds = 2.0;
+    uint32_t seed = 42;
+};
+
+struct sweep_point {
+    uint32_t algorithm;
+    DISTRIBUTION distribution;
+    uint64_t size;
+    double ns_per_element;
+};
+
+// Times the registered algorithms over geometrically growing sizes (2^min..2^max)
+// on a worker thread of its own; results can be read while the sweep runs.
+class benchmark_sweep {
+public:
+    benchmark_sweep() = default;
+    ~benchmark_sweep();
+
+    benchmark_sweep(const benchmark_sweep &) = delete;
+    benchmark_sweep &operator=(const benchmark_sweep &) = delete;
+
+    // Returns false if a sweep is already running.
+    bool start(const sweep_settings &settings);
+    void stop();
+
+    bool running() const;
+    float progress() const;
+    std::vector<sweep_point> points() const;
+
+private:
+    void join();
+    void run(sweep_settings settings);
+
+    std::thread worker;
+    cancel_token cancel;
+    std::atomic<bool> active{false};
+    std::atomic<uint32_t> completed{0}, total{0};
+
+    mutable std::mutex points_mutex;
+    std::vector<sweep_point> results;
+};
+
+#endif //SORTING_ALGORITHMS_BENCHMARK_SWEEP_H
@@ -0,0 +1,94 @@
+#include "cache_info.h"
+
+#if defined(__linux__)
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
+// Reads /sys/devices/system/cpu/cpu0/cache/index*/, used when sysconf reports nothing.
+static void read_sysfs_cache_sizes(cache_sizes &sizes) {
+    for (int index = 0; index < 8; ++index) {
+        char path[128], type[32] = {}, size[32] = {};
+        int level = 0;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+        FILE *file = fopen(path, "r");
+        if (!file) break;
+        if (fscanf(file, "%d", &level) != 1) level = 0;
+        fclose(file);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+        if ((file = fopen(path, "r"))) {
+            if (fscanf(file, "%31s", type) != 1) type[0] = 0;
+            fclose(file);
+        }
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+        if ((file = fopen(path, "r"))) {
+            if (fscanf(file, "%31s", size) != 1) size[0] = 0;
+            fclose(file);
+        }
+
+        uint64_t bytes = 0;
+        char unit = 0;
+        if (sscanf(size, "%" SCNu64 "%c", &bytes, &unit) >= 1) {
+            if (unit == 'K') bytes *= 1024;
+            if (unit == 'M') bytes *= 1024 * 1024;
+        }
+
+        if (level == 1 && strcmp(type, "Instruction") != 0 && !sizes.l1d) sizes.l1d = bytes;
+        if (level == 2 && !sizes.l2) sizes.l2 = bytes;
+        if (level == 3 && !sizes.l3) sizes.l3 = bytes;
+    }
+}
+
+cache_sizes detect_cache_sizes() {
+    cache_sizes sizes;
+
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    long l1d = sysconf(_SC_LEVEL1_DCACHE_SIZE), l2 = sysconf(_SC_LEVEL2_CACHE_SIZE), l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    sizes.l1d = l1d > 0 ? (uint64_t) l1d : 0;
+    sizes.l2 = l2 > 0 ? (uint64_t) l2 : 0;
+    sizes.l3 = l3 > 0 ? (uint64_t) l3 : 0;
+#endif
+
+    if (!sizes.l1d || !sizes.l2) read_sysfs_cache_sizes(sizes);
+    return sizes;
+}
+
+#elif defined(_WIN32)
+
+#include <vector>
+
+#include <windows.h>
+
+cache_sizes detect_cache_sizes() {
+    cache_sizes sizes;
+
+    DWORD length = 0;
+    GetLogicalProcessorInformation(nullptr, &length);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (info.empty() || !GetLogicalProcessorInformation(info.data(), &length)) return sizes;
+
+    for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION &entry: info) {
+        if (entry.Relationship != RelationCache) continue;
+
+        const CACHE_DESCRIPTOR &cache = entry.Cache;
+        if (cache.Level == 1 && cache.Type != CacheInstruction && !sizes.l1d) sizes.l1d = cache.Size;
+        if (cache.Level == 2 && !sizes.l2) sizes.l2 = cache.Size;
+        if (cache.Level == 3 && !sizes.l3) sizes.l3 = cache.Size;
+    }
+
+    return sizes;
+}
+
+#else
+
+cache_sizes detect_cache_sizes() {
+    return {};
+}
+
+#endif
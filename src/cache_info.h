@@ -0,0 +1,15 @@
+#ifndef SORTING_ALGORITHMS_CACHE_INFO_H
+#define SORTING_ALGORITHMS_CACHE_INFO_H
+
+#include <cstdint>
+
+// Data cache sizes in bytes; 0 where the level does not exist or is unknown.
+struct cache_sizes {
+    uint64_t l1d = 0;
+    uint64_t l2 = 0;
+    uint64_t l3 = 0;
+};
+
+cache_sizes detect_cache_sizes();
+
+#endif //SORTING_ALGORITHMS_CACHE_INFO_H
@@ -0,0 +1,47 @@
+#ifndef SORTING_ALGORITHMS_CANCEL_TOKEN_H
+#define SORTING_ALGORITHMS_CANCEL_TOKEN_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Cooperative cancellation shared by every kernel. Hot loops poll requested()
+// (a relaxed load) every CANCEL_POLL_INTERVAL elements, recursive kernels poll it
+// on entry, and anything that waits does so through wait_for() so a request wakes
+// it immediately instead of after the current sleep.
+class cancel_token {
+public:
+    static constexpr uint32_t CANCEL_POLL_INTERVAL = 4096;
+
+    bool requested() const {
+        return flag.load(std::memory_order_relaxed);
+    }
+
+    void request() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            flag.store(true, std::memory_order_relaxed);
+        }
+        condition.notify_all();
+    }
+
+    void reset() {
+        flag.store(false, std::memory_order_relaxed);
+    }
+
+    // Returns true if cancellation was requested before the timeout elapsed.
+    template<typename Rep, typename Period>
+    bool wait_for(std::chrono::duration<Rep, Period> timeout) const {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, timeout, [this]() { return requested(); });
+    }
+
+private:
+    std::atomic<bool> flag{false};
+    mutable std::mutex mutex;
+    mutable std::condition_variable condition;
+};
+
+#endif //SORTING_ALGORITHMS_CANCEL_TOKEN_H
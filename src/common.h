@@ -0,0 +1,28 @@
+#ifndef SORTING_ALGORITHMS_COMMON_H
+#define SORTING_ALGORITHMS_COMMON_H
+
+#include <cstdint>
+
+struct rgb {
+    uint8_t r, g, b;
+
+    rgb() {
+        this->r = 255;
+        this->g = 255;
+        this->b = 255;
+    }
+
+    rgb(uint8_t r, uint8_t g, uint8_t b) {
+        this->r = r;
+        this->g = g;
+        this->b = b;
+    }
+};
+
+enum PROCESS {
+    NONE,
+    SHUFFLING,
+    SORTING
+};
+
+#endif //SORTING_ALGORITHMS_COMMON_H
@@ -0,0 +1,73 @@
+#include "cpu_dispatch.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const char *CPU_ISA_IDS[] = {"generic", "avx2", "avx512"};
+
+// -1 until the first active_isa() call reads SORTING_ISA.
+static std::atomic<int> selected_isa(-1);
+
+CPU_ISA detect_isa() {
+#ifdef SORTING_X86_DISPATCH
+    // __builtin_cpu_supports also checks that the OS saves the wider registers (XGETBV).
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("bmi2")) {
+        return CPU_ISA::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt")) {
+        return CPU_ISA::AVX2;
+    }
+#endif
+    return CPU_ISA::GENERIC;
+}
+
+static CPU_ISA initial_isa() {
+    CPU_ISA detected = detect_isa();
+
+    const char *id = getenv("SORTING_ISA");
+    if (!id || !*id) return detected;
+
+    CPU_ISA requested;
+    if (!parse_isa(id, requested)) {
+        fprintf(stderr, "Ignoring unknown SORTING_ISA=%s\n", id);
+        return detected;
+    }
+    if (requested > detected) {
+        fprintf(stderr, "Ignoring SORTING_ISA=%s, this CPU supports up to %s\n", id, CPU_ISA_IDS[detected]);
+        return detected;
+    }
+    return requested;
+}
+
+CPU_ISA active_isa() {
+    int isa = selected_isa.load(std::memory_order_relaxed);
+    if (isa >= 0) return (CPU_ISA) isa;
+
+    // Racing first calls compute the same value, so whichever store wins is fine.
+    isa = initial_isa();
+    selected_isa.store(isa, std::memory_order_relaxed);
+    return (CPU_ISA) isa;
+}
+
+bool set_isa(CPU_ISA isa) {
+    if (isa > detect_isa()) return false;
+
+    selected_isa.store(isa, std::memory_order_relaxed);
+    return true;
+}
+
+bool parse_isa(const char *id, CPU_ISA &isa) {
+    for (uint32_t i = 0; i < CPU_ISA_COUNT; ++i) {
+        if (strcmp(id, CPU_ISA_IDS[i]) == 0) {
+            isa = (CPU_ISA) i;
+            return true;
+        }
+    }
+    return false;
+}
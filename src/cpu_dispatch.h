@@ -0,0 +1,47 @@
+#ifndef SORTING_ALGORITHMS_CPU_DISPATCH_H
+#define SORTING_ALGORITHMS_CPU_DISPATCH_H
+
+#include <cstdint>
+
+// Kernels for higher levels are compiled per function with target attributes, so one binary
+// built for the baseline architecture can still use them where the CPU has them.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SORTING_X86_DISPATCH
+#define SORTING_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#define SORTING_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq,avx2,bmi,bmi2,popcnt")))
+#endif
+
+// Instruction set levels, each including the previous one. AVX512 is the Skylake-X set (F, BW, VL, DQ).
+enum CPU_ISA {
+    GENERIC,
+    AVX2,
+    AVX512,
+    CPU_ISA_COUNT
+};
+
+extern const char *CPU_ISA_IDS[];
+
+// Highest level the CPU and the OS support.
+CPU_ISA detect_isa();
+
+// Level the kernels dispatch on: detect_isa(), unless lowered by the SORTING_ISA environment
+// variable (generic, avx2, avx512) or set_isa().
+CPU_ISA active_isa();
+
+// Returns false and keeps the current level if the CPU does not support `isa`.
+bool set_isa(CPU_ISA isa);
+
+// Returns false if the id is unknown.
+bool parse_isa(const char *id, CPU_ISA &isa);
+
+// Picks the implementation for the active level from a table indexed by CPU_ISA, falling back to
+// lower levels where an entry is nullptr. The generic entry must always be set.
+template<typename KERNEL>
+KERNEL dispatch(KERNEL const (&kernels)[CPU_ISA_COUNT]) {
+    for (int isa = active_isa(); isa > GENERIC; --isa) {
+        if (kernels[isa]) return kernels[isa];
+    }
+    return kernels[GENERIC];
+}
+
+#endif //SORTING_ALGORITHMS_CPU_DISPATCH_H
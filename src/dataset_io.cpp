@@ -0,0 +1,291 @@
+#include "dataset_io.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Text below this many bytes per thread is not worth splitting.
+static constexpr size_t PARSE_BYTES_PER_THREAD = 1 << 20;
+static constexpr size_t SAVE_BUFFER_BYTES = 1 << 20;
+
+DATASET_FORMAT dataset_format_for(const char *path) {
+    const char *extension = strrchr(path, '.');
+    if (!extension) return DATASET_FORMAT::BINARY;
+
+    const char *TEXT_EXTENSIONS[] = {".csv", ".txt", ".tsv"};
+    for (const char *text: TEXT_EXTENSIONS) {
+#if defined(_WIN32)
+        if (_stricmp(extension, text) == 0) return DATASET_FORMAT::TEXT;
+#else
+        if (strcasecmp(extension, text) == 0) return DATASET_FORMAT::TEXT;
+#endif
+    }
+    return DATASET_FORMAT::BINARY;
+}
+
+mapped_file::~mapped_file() {
+    close();
+}
+
+#if defined(_WIN32)
+
+bool mapped_file::open(const char *path) {
+    close();
+
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    file = handle;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        close();
+        return false;
+    }
+    bytes = (size_t) size.QuadPart;
+    if (bytes == 0) return true;
+
+    mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return false;
+    }
+
+    view = (const char *) MapViewOfFile((HANDLE) mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void mapped_file::close() {
+    if (view) UnmapViewOfFile(view);
+    if (mapping) CloseHandle((HANDLE) mapping);
+    if (file) CloseHandle((HANDLE) file);
+
+    view = nullptr;
+    mapping = file = nullptr;
+    bytes = 0;
+}
+
+#else
+
+bool mapped_file::open(const char *path) {
+    close();
+
+    int descriptor = ::open(path, O_RDONLY);
+    if (descriptor < 0) return false;
+
+    struct stat status = {};
+    if (fstat(descriptor, &status) != 0) {
+        ::close(descriptor);
+        return false;
+    }
+
+    bytes = (size_t) status.st_size;
+    if (bytes) {
+        void *mapped = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped == MAP_FAILED) {
+            bytes = 0;
+            ::close(descriptor);
+            return false;
+        }
+        // The whole file is read front to back right away.
+        madvise(mapped, bytes, MADV_SEQUENTIAL);
+        madvise(mapped, bytes, MADV_WILLNEED);
+        view = (const char *) mapped;
+    }
+
+    // The mapping keeps the file alive on its own.
+    ::close(descriptor);
+    return true;
+}
+
+void mapped_file::close() {
+    if (view) munmap((void *) view, bytes);
+    view = nullptr;
+    bytes = 0;
+}
+
+#endif
+
+static bool is_separator(char c) {
+    return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+struct parse_slice {
+    std::vector<uint32_t> values;
+    // Offset of the first bad byte, or SIZE_MAX if the slice parsed cleanly.
+    size_t error_offset = SIZE_MAX;
+    bool overflow = false;
+};
+
+static void parse_range(const char *text, size_t begin, size_t end, parse_slice &slice) {
+    slice.values.reserve((end - begin) / 4);
+
+    size_t i = begin;
+    while (i < end) {
+        if (is_separator(text[i])) {
+            ++i;
+            continue;
+        }
+
+        uint32_t value;
+        std::from_chars_result parsed = std::from_chars(text + i, text + end, value);
+        if (parsed.ec != std::errc() || (parsed.ptr < text + end && !is_separator(*parsed.ptr))) {
+            slice.overflow = parsed.ec == std::errc::result_out_of_range;
+            slice.error_offset = i;
+            return;
+        }
+
+        slice.values.push_back(value);
+        i = (size_t) (parsed.ptr - text);
+    }
+}
+
+static bool parse_text(const char *text, size_t size, std::vector<uint32_t> &values, std::string &error) {
+    size_t start = 0;
+    while (start < size && is_separator(text[start])) ++start;
+
+    // Header line.
+    if (start < size && (text[start] < '0' || text[start] > '9')) {
+        while (start < size && text[start] != '\n') ++start;
+    }
+
+    size_t threads = std::max<size_t>(1, std::min<size_t>(
+            active_threads(),
+            (size - start) / PARSE_BYTES_PER_THREAD
+    ));
+
+    // Slice boundaries move forward to the next separator so no number is split.
+    std::vector<size_t> bounds(threads + 1, size);
+    bounds[0] = start;
+    for (size_t t = 1; t < threads; ++t) {
+        size_t bound = std::max(bounds[t - 1], start + (size - start) / threads * t);
+        while (bound < size && !is_separator(text[bound])) ++bound;
+        bounds[t] = bound;
+    }
+
+    std::vector<parse_slice> slices(threads);
+    run_parallel((uint32_t) threads, [&](uint32_t t) {
+        parse_range(text, bounds[t], bounds[t + 1], slices[t]);
+    });
+
+    size_t total = 0;
+    for (const parse_slice &slice: slices) {
+        if (slice.error_offset != SIZE_MAX) {
+            size_t line = 1 + (size_t) std::count(text, text + slice.error_offset, '\n');
+            error = std::string(slice.overflow ? "Value does not fit in 32 bits" : "Unexpected character") +
+                    " on line " + std::to_string(line);
+            return false;
+        }
+        total += slice.values.size();
+    }
+
+    if (total > UINT32_MAX) {
+        error = "More than 2^32 - 1 values";
+        return false;
+    }
+
+    values.resize(total);
+    size_t offset = 0;
+    for (const parse_slice &slice: slices) {
+        std::copy(slice.values.begin(), slice.values.end(), values.begin() + (long) offset);
+        offset += slice.values.size();
+    }
+    return true;
+}
+
+bool load_dataset(const char *path, std::vector<uint32_t> &values, std::string &error) {
+    mapped_file file;
+    if (!file.open(path)) {
+        error = std::string("Cannot open ") + path;
+        return false;
+    }
+
+    if (dataset_format_for(path) == DATASET_FORMAT::TEXT) {
+        return parse_text(file.data(), file.size(), values, error);
+    }
+
+    if (file.size() % sizeof(uint32_t) != 0) {
+        error = "Binary file size is not a multiple of 4 bytes";
+        return false;
+    }
+    if (file.size() / sizeof(uint32_t) > UINT32_MAX) {
+        error = "More than 2^32 - 1 values";
+        return false;
+    }
+
+    // One copy straight from the page cache into the sort buffer, which must be
+    // writable and private anyway.
+    values.resize(file.size() / sizeof(uint32_t));
+    if (!values.empty()) memcpy(values.data(), file.data(), file.size());
+
+    if constexpr (std::endian::native == std::endian::big) {
+        for (uint32_t &value: values) {
+            value = (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+        }
+    }
+    return true;
+}
+
+static bool save_text(FILE *file, const uint32_t *values, uint32_t size) {
+    std::vector<char> buffer(SAVE_BUFFER_BYTES);
+    size_t used = 0;
+
+    for (uint32_t i = 0; i < size; ++i) {
+        // A uint32_t is at most 10 digits plus the newline.
+        if (used + 11 > buffer.size()) {
+            if (fwrite(buffer.data(), 1, used, file) != used) return false;
+            used = 0;
+        }
+
+        // The last byte stays reserved for the newline.
+        char *end = std::to_chars(buffer.data() + used, buffer.data() + buffer.size() - 1, values[i]).ptr;
+        *end++ = '\n';
+        used = (size_t) (end - buffer.data());
+    }
+
+    return fwrite(buffer.data(), 1, used, file) == used;
+}
+
+bool save_dataset(const char *path, const uint32_t *values, uint32_t size, std::string &error) {
+    bool text = dataset_format_for(path) == DATASET_FORMAT::TEXT;
+
+    FILE *file = fopen(path, text ? "w" : "wb");
+    if (!file) {
+        error = std::string("Cannot create ") + path;
+        return false;
+    }
+
+    bool written;
+    if (text) {
+        written = save_text(file, values, size);
+    } else if constexpr (std::endian::native == std::endian::little) {
+        written = fwrite(values, sizeof(uint32_t), size, file) == size;
+    } else {
+        std::vector<uint32_t> swapped(values, values + size);
+        for (uint32_t &value: swapped) {
+            value = (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+        }
+        written = fwrite(swapped.data(), sizeof(uint32_t), size, file) == size;
+    }
+
+    if (fclose(file) != 0 || !written) {
+        error = std::string("Cannot write ") + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef SORTING_ALGORITHMS_DATASET_IO_H
+#define SORTING_ALGORITHMS_DATASET_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum DATASET_FORMAT {
+    BINARY,
+    TEXT
+};
+
+// .csv, .txt and .tsv files are text; anything else is raw little-endian uint32_t.
+DATASET_FORMAT dataset_format_for(const char *path);
+
+// Read-only memory mapping of a whole file; empty files map to nullptr with size 0.
+class mapped_file {
+public:
+    mapped_file() = default;
+    ~mapped_file();
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    bool open(const char *path);
+    void close();
+
+    const char *data() const { return view; }
+    size_t size() const { return bytes; }
+
+private:
+    const char *view = nullptr;
+    size_t bytes = 0;
+#if defined(_WIN32)
+    void *file = nullptr;
+    void *mapping = nullptr;
+#endif
+};
+
+// Text datasets hold unsigned decimal keys separated by commas, semicolons or
+// whitespace; a first line that does not start with a digit is taken as a header.
+// Large files are parsed by all hardware threads at once.
+bool load_dataset(const char *path, std::vector<uint32_t> &values, std::string &error);
+
+// Writes in the format dataset_format_for picks (text: one key per line).
+bool save_dataset(const char *path, const uint32_t *values, uint32_t size, std::string &error);
+
+#endif //SORTING_ALGORITHMS_DATASET_IO_H
@@ -0,0 +1,524 @@
+#include "external_sort.h"
+
+#include "async_io.h"
+#include "sorting_algorithms.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+// Smallest merge buffer per run; below this the merge turns into a seek storm.
+static constexpr uint64_t MIN_MERGE_BUFFER_BYTES = 64 * 1024;
+
+// The shared queue plus the time spent blocked on it, i.e. I/O that did not overlap.
+struct io_pipeline {
+    io_queue queue;
+    double stalled_seconds = 0;
+
+    int64_t wait(uint64_t request) {
+        auto start_time = std::chrono::steady_clock::now();
+        int64_t bytes = queue.wait(request);
+        stalled_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        return bytes;
+    }
+};
+
+// Drains the queue on scope exit; declared after the buffers it protects.
+struct drain_on_exit {
+    io_queue &queue;
+
+    ~drain_on_exit() {
+        queue.drain();
+    }
+};
+
+// Double-buffered sequential reader: while the merge consumes one buffer, the
+// next block of the run is already being read into the other.
+template<typename T>
+struct run_reader {
+    io_file file;
+    aligned_buffer buffers[2];
+    const T *keys = nullptr;
+    size_t position = 0;
+    size_t count = 0;
+    uint32_t filling = 0;
+    uint64_t offset = 0;
+    uint64_t pending = 0;
+    bool failed = false;
+
+    bool open(const std::string &path, size_t buffer_bytes, bool direct, io_pipeline &io) {
+        if (!file.open(path.c_str(), false, direct)) return false;
+
+        buffers[0] = aligned_buffer(buffer_bytes);
+        buffers[1] = aligned_buffer(buffer_bytes);
+        pending = io.queue.read(file, buffers[0].data(), buffers[0].size(), 0);
+        offset = buffers[0].size();
+        return true;
+    }
+
+    // Returns false once the run is exhausted (or unreadable, see failed).
+    bool refill(io_pipeline &io) {
+        if (!pending) return false;
+
+        int64_t bytes = io.wait(pending);
+        pending = 0;
+        if (bytes < 0) failed = true;
+        if (bytes <= 0) return false;
+
+        keys = buffers[filling].as<T>();
+        count = (size_t) bytes / sizeof(T);
+        position = 0;
+
+        // A short read means the end of the run; otherwise start on the next block.
+        filling ^= 1;
+        if ((size_t) bytes == buffers[filling].size()) {
+            pending = io.queue.read(file, buffers[filling].data(), buffers[filling].size(), offset);
+            offset += buffers[filling].size();
+        }
+        return count > 0;
+    }
+};
+
+// Double-buffered sequential writer: one buffer is written behind while the merge
+// fills the other.
+template<typename T>
+struct run_writer {
+    io_file file;
+    aligned_buffer buffers[2];
+    size_t count = 0;
+    size_t capacity = 0;
+    uint32_t filling = 0;
+    uint64_t offset = 0;
+    uint64_t pending = 0;
+    bool failed = false;
+
+    bool open(const std::string &path, size_t buffer_bytes, bool direct) {
+        if (!file.open(path.c_str(), true, direct)) return false;
+
+        buffers[0] = aligned_buffer(buffer_bytes);
+        buffers[1] = aligned_buffer(buffer_bytes);
+        capacity = buffers[0].size() / sizeof(T);
+        return true;
+    }
+
+    void push(T value, io_pipeline &io) {
+        buffers[filling].as<T>()[count++] = value;
+        if (count == capacity) flush(io);
+    }
+
+    // Only the last flush may be partial: direct writes round it up to whole blocks
+    // and close() cuts the file back to its real length.
+    void flush(io_pipeline &io) {
+        if (!count) return;
+        if (pending && io.wait(pending) < 0) failed = true;
+
+        size_t bytes = count * sizeof(T);
+        pending = io.queue.write(file, buffers[filling].data(), file.direct() ? align_up(bytes) : bytes, offset);
+        offset += bytes;
+        filling ^= 1;
+        count = 0;
+    }
+
+    bool close(io_pipeline &io) {
+        flush(io);
+        if (pending && io.wait(pending) < 0) failed = true;
+        pending = 0;
+
+        if (file.direct() && !file.truncate(offset)) failed = true;
+        file.close();
+        return !failed;
+    }
+};
+
+// Tournament tree over k runs: every internal node keeps the loser of the match
+// played there, so replacing the winner's key costs one path of log2(k) comparisons
+// against losers instead of the two-children comparisons a heap needs per level.
+template<typename T>
+class loser_tree {
+public:
+    explicit loser_tree(uint32_t runs) : k(runs), keys(runs), active(runs, false), nodes(runs, 0) {}
+
+    void set(uint32_t run, T key) {
+        keys[run] = key;
+        active[run] = true;
+    }
+
+    // Plays every match once; call after the first key of each run has been set.
+    void build() {
+        std::vector<uint32_t> winners(k, 0);
+
+        for (uint32_t node = k - 1; node >= 1; --node) {
+            uint32_t left = child_winner(2 * node, winners), right = child_winner(2 * node + 1, winners);
+            bool left_wins = beats(left, right);
+            winners[node] = left_wins ? left : right;
+            nodes[node] = left_wins ? right : left;
+        }
+        nodes[0] = k > 1 ? winners[1] : 0;
+    }
+
+    bool empty() const {
+        return !active[nodes[0]];
+    }
+
+    uint32_t winner() const {
+        return nodes[0];
+    }
+
+    T winner_key() const {
+        return keys[nodes[0]];
+    }
+
+    // Gives the winning run its next key, or marks it exhausted, and replays its path.
+    void replace_winner(T key) {
+        keys[nodes[0]] = key;
+        replay();
+    }
+
+    void exhaust_winner() {
+        active[nodes[0]] = false;
+        replay();
+    }
+
+private:
+    uint32_t child_winner(uint32_t child, const std::vector<uint32_t> &winners) const {
+        return child >= k ? child - k : winners[child];
+    }
+
+    // Exhausted runs lose to everything; ties go to the lower run index.
+    bool beats(uint32_t a, uint32_t b) const {
+        if (!active[a]) return false;
+        if (!active[b]) return true;
+        return keys[a] < keys[b] || (!(keys[b] < keys[a]) && a < b);
+    }
+
+    void replay() {
+        uint32_t current = nodes[0];
+        for (uint32_t node = (current + k) / 2; node >= 1; node /= 2) {
+            if (beats(nodes[node], current)) std::swap(nodes[node], current);
+        }
+        nodes[0] = current;
+    }
+
+    uint32_t k;
+    std::vector<T> keys;
+    std::vector<bool> active;
+    std::vector<uint32_t> nodes;
+};
+
+static std::string temp_directory(const external_sort_settings &settings, const char *output_path) {
+    if (settings.temp_dir) return settings.temp_dir;
+
+    std::string output(output_path);
+    size_t slash = output.find_last_of("/\\");
+    return slash == std::string::npos ? "." : output.substr(0, slash);
+}
+
+static void remove_files(const std::vector<std::string> &paths) {
+    for (const std::string &path: paths) remove(path.c_str());
+}
+
+template<typename T>
+static void sort_chunk(T *chunk, uint64_t size, const external_sort_settings &settings, const cancel_token &token) {
+    if (size < 2) return;
+
+    if constexpr (sizeof(T) == sizeof(uint32_t)) {
+        if (settings.algorithm && size <= UINT32_MAX) {
+            settings.algorithm->sort(chunk, (uint32_t) size, token);
+            return;
+        }
+    }
+
+    no_counters counters;
+    merge_sort_algorithm(chunk, (uint32_t) 0, (uint32_t) (size - 1), token, counters);
+}
+
+template<typename T>
+static bool merge_runs(
+        const std::vector<std::string> &inputs,
+        const std::string &output,
+        const external_sort_settings &settings,
+        io_pipeline &io,
+        const cancel_token &token
+) {
+    uint32_t k = (uint32_t) inputs.size();
+
+    // Every run and the output hold two buffers each.
+    uint64_t buffer_bytes = std::min(settings.io_buffer_bytes, settings.memory_bytes / (2 * (k + 1)));
+    buffer_bytes = align_down((size_t) std::max(buffer_bytes, MIN_MERGE_BUFFER_BYTES));
+
+    std::vector<run_reader<T>> readers(k);
+    run_writer<T> writer;
+    drain_on_exit drain{io.queue};
+    loser_tree<T> tree(k);
+
+    for (uint32_t r = 0; r < k; ++r) {
+        if (!readers[r].open(inputs[r], buffer_bytes, settings.direct_io, io)) {
+            fprintf(stderr, "Cannot open run %s\n", inputs[r].c_str());
+            return false;
+        }
+    }
+    for (uint32_t r = 0; r < k; ++r) {
+        if (readers[r].refill(io)) tree.set(r, readers[r].keys[0]);
+    }
+    tree.build();
+
+    if (!writer.open(output, buffer_bytes, settings.direct_io)) {
+        fprintf(stderr, "Cannot create %s\n", output.c_str());
+        return false;
+    }
+
+    while (!tree.empty()) {
+        writer.push(tree.winner_key(), io);
+
+        run_reader<T> &reader = readers[tree.winner()];
+        if (++reader.position < reader.count) {
+            tree.replace_winner(reader.keys[reader.position]);
+            continue;
+        }
+
+        if (token.requested()) return false;
+
+        if (reader.refill(io)) {
+            tree.replace_winner(reader.keys[0]);
+        } else {
+            tree.exhaust_winner();
+        }
+    }
+
+    bool failed = std::any_of(readers.begin(), readers.end(), [](const run_reader<T> &reader) {
+        return reader.failed;
+    });
+    if (failed || !writer.close(io)) {
+        fprintf(stderr, "I/O error while merging into %s\n", output.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Run formation as a three-stage pipeline over three chunk buffers: while chunk i is
+// sorted, chunk i + 1 is read ahead and chunk i - 1 is written behind.
+template<typename T>
+static bool form_runs(
+        const char *input_path,
+        const char *output_path,
+        const std::string &prefix,
+        uint32_t &serial,
+        const external_sort_settings &settings,
+        io_pipeline &io,
+        std::vector<std::string> &runs,
+        external_sort_stats &stats,
+        const cancel_token &token
+) {
+    io_file input;
+    if (!input.open(input_path, false, settings.direct_io)) {
+        fprintf(stderr, "Cannot open %s\n", input_path);
+        return false;
+    }
+
+    // A quarter of the budget per chunk: three in the pipeline plus the scratch
+    // space the merge-based engines need while sorting one.
+    uint64_t chunk_bytes = std::min<uint64_t>(settings.memory_bytes / 4, (uint64_t) UINT32_MAX * sizeof(T));
+    chunk_bytes = align_down((size_t) std::max<uint64_t>(chunk_bytes, IO_ALIGNMENT));
+
+    aligned_buffer chunks[3];
+    io_file run_files[3];
+    uint64_t reads[3] = {}, writes[3] = {}, run_bytes[3] = {};
+    drain_on_exit drain{io.queue};
+
+    // Waits for the write behind a slot and cuts the padding of a direct write.
+    auto finish_run = [&](uint32_t slot) {
+        if (!writes[slot]) return true;
+
+        bool written = io.wait(writes[slot]) >= 0;
+        writes[slot] = 0;
+        if (run_files[slot].direct()) written &= run_files[slot].truncate(run_bytes[slot]);
+        run_files[slot].close();
+        return written;
+    };
+
+    for (aligned_buffer &chunk: chunks) chunk = aligned_buffer(chunk_bytes);
+
+    reads[0] = io.queue.read(input, chunks[0].data(), chunk_bytes, 0);
+    uint64_t read_offset = chunk_bytes;
+
+    for (uint32_t i = 0; reads[i % 3]; ++i) {
+        uint32_t slot = i % 3, next = (i + 1) % 3;
+
+        int64_t bytes = io.wait(reads[slot]);
+        reads[slot] = 0;
+        if (bytes < 0) {
+            fprintf(stderr, "Cannot read %s\n", input_path);
+            return false;
+        }
+        // Chunks are whole blocks, so only the read that hits the end of the file can
+        // end in the middle of a key.
+        if ((uint64_t) bytes % sizeof(T) != 0) {
+            fprintf(stderr, "%s size is not a multiple of %u bytes\n", input_path, (unsigned) sizeof(T));
+            return false;
+        }
+
+        uint64_t elements = (uint64_t) bytes / sizeof(T);
+        if (elements == 0) break;
+
+        // The next slot last held chunk i - 2; its write must land before it is reused.
+        if (!finish_run(next)) {
+            fprintf(stderr, "Cannot write a run file\n");
+            return false;
+        }
+        if ((uint64_t) bytes == chunk_bytes) {
+            reads[next] = io.queue.read(input, chunks[next].data(), chunk_bytes, read_offset);
+            read_offset += chunk_bytes;
+        }
+
+        stats.elements += elements;
+        sort_chunk(chunks[slot].as<T>(), elements, settings, token);
+        if (token.requested()) return false;
+
+        // A file that fits in one chunk needs no merge at all.
+        bool only_run = i == 0 && !reads[next];
+        std::string path = only_run ? std::string(output_path) : prefix + std::to_string(serial++) + ".bin";
+        if (!run_files[slot].open(path.c_str(), true, settings.direct_io)) {
+            fprintf(stderr, "Cannot create %s\n", path.c_str());
+            return false;
+        }
+        if (!only_run) runs.push_back(path);
+
+        run_bytes[slot] = elements * sizeof(T);
+        size_t write_bytes = run_files[slot].direct() ? align_up(run_bytes[slot]) : run_bytes[slot];
+        writes[slot] = io.queue.write(run_files[slot], chunks[slot].data(), write_bytes, 0);
+    }
+
+    for (uint32_t slot = 0; slot < 3; ++slot) {
+        if (!finish_run(slot)) {
+            fprintf(stderr, "Cannot write a run file\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+static bool external_sort_typed(
+        const char *input_path,
+        const char *output_path,
+        const external_sort_settings &settings,
+        external_sort_stats &stats,
+        const cancel_token &token
+) {
+    std::string prefix = temp_directory(settings, output_path) + "/sort_run_" + std::to_string(getpid()) + "_";
+    uint32_t serial = 0;
+    std::vector<std::string> runs;
+
+    io_pipeline io;
+    stats.io_backend = io.queue.backend();
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    if (!form_runs<T>(input_path, output_path, prefix, serial, settings, io, runs, stats, token)) {
+        remove_files(runs);
+        return false;
+    }
+
+    auto merge_time = std::chrono::steady_clock::now();
+    stats.run_seconds = std::chrono::duration<double>(merge_time - start_time).count();
+
+    if (runs.empty()) {
+        // The input fit in one chunk and went straight to the output (or was empty).
+        stats.runs = stats.elements ? 1 : 0;
+        if (!stats.elements) {
+            io_file empty;
+            if (!empty.open(output_path, true, false)) {
+                fprintf(stderr, "Cannot create %s\n", output_path);
+                return false;
+            }
+        }
+        stats.io_stall_seconds = io.stalled_seconds;
+        return true;
+    }
+
+    stats.runs = (uint32_t) runs.size();
+    uint32_t fan_in = std::max<uint32_t>(settings.max_fan_in, 2);
+
+    while (true) {
+        ++stats.merge_passes;
+        bool last_pass = runs.size() <= fan_in;
+        std::vector<std::string> next;
+
+        for (size_t first = 0; first < runs.size(); first += fan_in) {
+            std::vector<std::string> group(runs.begin() + (long) first,
+                                           runs.begin() + (long) std::min(runs.size(), first + fan_in));
+            std::string path = last_pass ? std::string(output_path) : prefix + std::to_string(serial++) + ".bin";
+
+            if (!merge_runs<T>(group, path, settings, io, token)) {
+                remove_files(runs);
+                remove_files(next);
+                remove(path.c_str());
+                return false;
+            }
+            next.push_back(path);
+        }
+
+        remove_files(runs);
+        if (last_pass) break;
+        runs = next;
+    }
+
+    stats.merge_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - merge_time).count();
+    stats.io_stall_seconds = io.stalled_seconds;
+    return true;
+}
+
+bool external_sort(
+        const char *input_path,
+        const char *output_path,
+        const external_sort_settings &settings,
+        external_sort_stats &stats,
+        const cancel_token &token
+) {
+    stats = external_sort_stats();
+
+    bool sorted = settings.type == ELEMENT_TYPE::UINT64
+                  ? external_sort_typed<uint64_t>(input_path, output_path, settings, stats, token)
+                  : external_sort_typed<uint32_t>(input_path, output_path, settings, stats, token);
+
+    if (!sorted && token.requested()) fprintf(stderr, "External sort cancelled\n");
+    return sorted;
+}
+
+template<typename T>
+static bool verify_sorted_file_typed(const char *path, uint64_t &elements) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+
+    std::vector<T> buffer(1 << 20);
+    T previous = 0;
+    bool sorted = true;
+    size_t read;
+
+    while (sorted && (read = fread(buffer.data(), sizeof(T), buffer.size(), file)) > 0) {
+        if (elements && buffer[0] < previous) sorted = false;
+        if (!std::is_sorted(buffer.begin(), buffer.begin() + (long) read)) sorted = false;
+
+        previous = buffer[read - 1];
+        elements += read;
+    }
+
+    bool read_error = ferror(file) != 0;
+    fclose(file);
+    return sorted && !read_error;
+}
+
+bool verify_sorted_file(const char *path, ELEMENT_TYPE type, uint64_t &elements) {
+    elements = 0;
+    if (type == ELEMENT_TYPE::UINT64) return verify_sorted_file_typed<uint64_t>(path, elements);
+    return verify_sorted_file_typed<uint32_t>(path, elements);
+}
@@ -0,0 +1,58 @@
+#ifndef SORTING_ALGORITHMS_EXTERNAL_SORT_H
+#define SORTING_ALGORITHMS_EXTERNAL_SORT_H
+
+#include "algorithm_registry.h"
+#include "cancel_token.h"
+
+#include <cstdint>
+
+enum ELEMENT_TYPE {
+    UINT32,
+    UINT64
+};
+
+struct external_sort_settings {
+    ELEMENT_TYPE type = ELEMENT_TYPE::UINT32;
+    // Upper bound on the memory used for run formation and for merge buffers.
+    uint64_t memory_bytes = 1ull << 30;
+    // Size of each sequential read and write during merging, memory permitting.
+    uint64_t io_buffer_bytes = 8ull << 20;
+    // More runs than this are merged in several passes.
+    uint32_t max_fan_in = 256;
+    // Bypass the page cache (O_DIRECT) where the file system supports it.
+    bool direct_io = true;
+    // Directory for run files; the output's directory if null.
+    const char *temp_dir = nullptr;
+    // Engine for in-memory runs of 32-bit keys; 64-bit runs use the merge sort kernel.
+    const sorting_algorithm *algorithm = nullptr;
+};
+
+struct external_sort_stats {
+    uint64_t elements = 0;
+    uint32_t runs = 0;
+    uint32_t merge_passes = 0;
+    double run_seconds = 0;
+    double merge_seconds = 0;
+    // Time spent waiting for reads and writes that did not overlap with sorting or merging.
+    double io_stall_seconds = 0;
+    const char *io_backend = "";
+};
+
+// Sorts a headerless file of native-endian keys that may be far larger than memory:
+// memory-sized chunks are sorted into run files, which are then merged k at a time
+// through a loser tree. Reads run ahead and writes run behind on an io_queue, so
+// disk transfers overlap the sorting and merging. Prints the reason and returns
+// false on failure or cancellation.
+bool external_sort(
+        const char *input_path,
+        const char *output_path,
+        const external_sort_settings &settings,
+        external_sort_stats &stats,
+        const cancel_token &token
+);
+
+// Streams a key file and checks that it is ascending. Returns false if it is not
+// (or cannot be read); `elements` receives the number of keys read.
+bool verify_sorted_file(const char *path, ELEMENT_TYPE type, uint64_t &elements);
+
+#endif //SORTING_ALGORITHMS_EXTERNAL_SORT_H
@@ -0,0 +1,80 @@
+#ifndef SORTING_ALGORITHMS_GENERATOR_H
+#define SORTING_ALGORITHMS_GENERATOR_H
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+// Minimal move-only generator coroutine. next() resumes the coroutine until its
+// next co_yield and returns false once it has run to completion.
+template<typename T>
+class generator {
+public:
+    struct promise_type {
+        T current;
+
+        generator get_return_object() {
+            return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always yield_value(T value) noexcept {
+            current = value;
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    generator() = default;
+
+    generator(generator &&other) noexcept : coroutine(std::exchange(other.coroutine, nullptr)) {}
+
+    generator &operator=(generator &&other) noexcept {
+        if (this != &other) {
+            if (coroutine) coroutine.destroy();
+            coroutine = std::exchange(other.coroutine, nullptr);
+        }
+        return *this;
+    }
+
+    generator(const generator &) = delete;
+    generator &operator=(const generator &) = delete;
+
+    ~generator() {
+        if (coroutine) coroutine.destroy();
+    }
+
+    bool valid() const {
+        return (bool) coroutine;
+    }
+
+    bool next() {
+        if (!coroutine || coroutine.done()) return false;
+
+        coroutine.resume();
+        return !coroutine.done();
+    }
+
+    const T &value() const {
+        return coroutine.promise().current;
+    }
+
+private:
+    explicit generator(std::coroutine_handle<promise_type> coroutine) : coroutine(coroutine) {}
+
+    std::coroutine_handle<promise_type> coroutine = nullptr;
+};
+
+#endif //SORTING_ALGORITHMS_GENERATOR_H
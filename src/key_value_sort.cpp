@@ -0,0 +1,50 @@
+#include "key_value_sort.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+const char *SORT_MODE_IDS[] = {"keys", "argsort", "pairs", "packed"};
+
+bool parse_sort_mode(const char *id, SORT_MODE &mode) {
+    for (uint32_t m = 0; m < SORT_MODE_COUNT; ++m) {
+        if (strcmp(id, SORT_MODE_IDS[m]) == 0) {
+            mode = (SORT_MODE) m;
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::unique_ptr<uint64_t[]> sorted_records(const sorting_algorithm &algorithm, const uint32_t *keys,
+                                                  uint32_t size, const cancel_token &token) {
+    std::unique_ptr<uint64_t[]> records(new uint64_t[size]);
+    for (uint32_t i = 0; i < size; ++i) records[i] = pack_pair(keys[i], i);
+
+    algorithm.sort_packed(records.get(), size, token);
+    return records;
+}
+
+void argsort(const sorting_algorithm &algorithm, const uint32_t *keys, uint32_t *indices, uint32_t size,
+             const cancel_token &token) {
+    std::unique_ptr<uint64_t[]> records = sorted_records(algorithm, keys, size, token);
+    for (uint32_t i = 0; i < size; ++i) indices[i] = packed_value(records[i]);
+}
+
+void argsort(const sorting_algorithm &algorithm, const uint32_t *keys, uint64_t *indices, uint32_t size,
+             const cancel_token &token) {
+    std::unique_ptr<uint64_t[]> records = sorted_records(algorithm, keys, size, token);
+    for (uint32_t i = 0; i < size; ++i) indices[i] = packed_value(records[i]);
+}
+
+void sort_pairs(const sorting_algorithm &algorithm, uint32_t *keys, uint32_t *values, uint32_t size,
+                const cancel_token &token) {
+    std::unique_ptr<uint64_t[]> records = sorted_records(algorithm, keys, size, token);
+    std::unique_ptr<uint32_t[]> original(new uint32_t[size]);
+    std::copy(values, values + size, original.get());
+
+    for (uint32_t i = 0; i < size; ++i) {
+        keys[i] = packed_key(records[i]);
+        values[i] = original[packed_value(records[i])];
+    }
+}
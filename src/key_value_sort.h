@@ -0,0 +1,55 @@
+#ifndef SORTING_ALGORITHMS_KEY_VALUE_SORT_H
+#define SORTING_ALGORITHMS_KEY_VALUE_SORT_H
+
+#include "algorithm_registry.h"
+#include "cancel_token.h"
+
+#include <cstdint>
+
+// What a sort produces:
+//   KEYS     the keys themselves, sorted in place
+//   ARGSORT  the permutation that sorts the keys; the keys are left untouched
+//   PAIRS    separate key and value arrays, both reordered by the keys
+//   PACKED   one array of key << 32 | value records
+enum SORT_MODE {
+    KEYS,
+    ARGSORT,
+    PAIRS,
+    PACKED,
+    SORT_MODE_COUNT
+};
+
+extern const char *SORT_MODE_IDS[];
+
+// Returns false if the id is unknown.
+bool parse_sort_mode(const char *id, SORT_MODE &mode);
+
+inline uint64_t pack_pair(uint32_t key, uint32_t value) {
+    return (uint64_t) key << 32 | value;
+}
+
+inline uint32_t packed_key(uint64_t record) {
+    return (uint32_t) (record >> 32);
+}
+
+inline uint32_t packed_value(uint64_t record) {
+    return (uint32_t) record;
+}
+
+// All of these go through the engine's sort_packed with the element index as the
+// value, so equal keys keep their input order whether or not the engine is stable.
+// On cancellation the outputs are still permutations of the inputs, just not sorted.
+
+// indices[i] is the position in keys of the i-th smallest key.
+void argsort(const sorting_algorithm &algorithm, const uint32_t *keys, uint32_t *indices, uint32_t size,
+             const cancel_token &token);
+
+// Same permutation widened to 64 bits, for callers that index 64-bit containers.
+void argsort(const sorting_algorithm &algorithm, const uint32_t *keys, uint64_t *indices, uint32_t size,
+             const cancel_token &token);
+
+// Sorts keys and applies the same permutation to values.
+void sort_pairs(const sorting_algorithm &algorithm, uint32_t *keys, uint32_t *values, uint32_t size,
+                const cancel_token &token);
+
+#endif //SORTING_ALGORITHMS_KEY_VALUE_SORT_H
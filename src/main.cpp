@@ -2,6 +2,16 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include "algorithm_registry.h"
+#include "benchmark_panel.h"
+#include "common.h"
+#include "dataset_io.h"
+#include "parallel.h"
+#include "perf_counters.h"
+#include "run_controller.h"
+#include "sort_verifier.h"
+#include "visual_algorithms.h"
+
 #include <cstdio>
 #include <random>
 #include <thread>
@@ -15,33 +25,6 @@
 #define WINDOW_HEIGHT 720
 #define WINDOW_TITLE "Sorting Algorithms Visualization"
 
-struct rgb {
-    uint8_t r, g, b;
-
-    rgb(uint8_t r, uint8_t g, uint8_t b) {
-        this->r = r;
-        this->g = g;
-        this->b = b;
-    }
-};
-
-enum SORTING_ALGORITHMS {
-    BUBBLE_SORT,
-    MERGE_SORT [[maybe_unused]]
-};
-
-const char *SORTING_ALGORITHMS_NAMES[] = {"Bubble Sort", "Merge Sort"};
-
-enum PROCESS {
-    NONE,
-    SHUFFLING,
-    SORTING
-};
-
-PROCESS current_process = PROCESS::NONE;
-
-std::atomic<bool> stop_flag(false);
-
 static void glfw_error_callback(int error, const char *DESCRIPTION) {
     fprintf(stderr, "GLFW Error %d: %s\n", error, DESCRIPTION);
 }
@@ -49,7 +32,7 @@ static void glfw_error_callback(int error, const char *DESCRIPTION) {
 void draw_bar_chart(
         const uint32_t *ARR,
         uint32_t arr_size,
-        rgb *colors,
+        const rgb *colors,
         GLFWwindow *window,
         double clearance,
         double height_coefficient_multiplier
@@ -87,204 +70,57 @@ void draw_bar_chart(
     }
 }
 
-void bubble_sort_algorithm(uint32_t *array, uint32_t array_size) {
-    for (uint32_t i = 0; i < array_size - 1; ++i) {
-        for (uint32_t j = 0; j < array_size - i - 1; ++j) {
-            if (array[j] > array[j + 1]) {
-                std::swap(array[j], array[j + 1]);
-            }
-        }
+// The combo lists the full sorts followed by the partial sorts.
+static bool sorting_algorithm_name(void *, int index, const char **name) {
+    if ((uint32_t) index < SORTING_ALGORITHMS_COUNT) {
+        *name = SORTING_ALGORITHMS[index].name;
+    } else {
+        *name = SELECTION_ALGORITHMS[index - SORTING_ALGORITHMS_COUNT].name;
     }
+    return true;
 }
 
-void bubble_sort_algorithm_visual(uint32_t *array, rgb *colors, uint32_t array_size, uint32_t delay_ms) {
-    current_process = PROCESS::SORTING;
-    for (uint32_t i = 0; i < array_size - 1; ++i) {
-        for (uint32_t j = 0; j < array_size - i - 1; ++j) {
-            if (stop_flag.load()) {
-                current_process = PROCESS::NONE;
-                return;
-            }
-
-            colors[j] = rgb(0, 255, 0);
-            colors[j + 1] = rgb(255, 0, 0);
-
-            if (array[j] > array[j + 1]) {
-                std::swap(array[j], array[j + 1]);
-            }
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
-
-            colors[j] = rgb(255, 255, 255);
-            colors[j + 1] = rgb(255, 255, 255);
-        }
-    }
-    current_process = PROCESS::NONE;
+static const selection_algorithm *selected_partial_sort(int index) {
+    if ((uint32_t) index < SORTING_ALGORITHMS_COUNT) return nullptr;
+    return &SELECTION_ALGORITHMS[index - SORTING_ALGORITHMS_COUNT];
 }
 
-void merge(uint32_t *arr, uint32_t l, uint32_t m, uint32_t r) {
-    uint32_t i, j, k;
-    uint32_t l_size = m - l + 1;
-    uint32_t r_size = r - m;
-
-    uint32_t L[l_size], R[r_size];
-
-    for (i = 0; i < l_size; i++) L[i] = arr[l + i];
-    for (j = 0; j < r_size; j++) R[j] = arr[m + 1 + j];
-
-    i = 0;
-    j = 0;
-    k = l;
-    while (i < l_size && j < r_size) {
-        if (L[i] <= R[j]) {
-            arr[k] = L[i];
-            i++;
-        } else {
-            arr[k] = R[j];
-            j++;
-        }
-
-        k++;
+// The counters follow the thread that sorted, so they are not shown when it had helpers.
+static void draw_perf_results(const perf_results &results, uint64_t elements, uint32_t threads) {
+    if (threads > 1) {
+        ImGui::TextDisabled("Hardware counters: n/a, the sort ran on %u threads", threads);
+        return;
     }
-
-    while (i < l_size) {
-        arr[k] = L[i];
-        i++;
-        k++;
+    if (!results.any()) {
+        ImGui::TextDisabled("Hardware counters unavailable");
+        return;
     }
 
-    while (j < r_size) {
-        arr[k] = R[j];
-        j++;
-        k++;
+    if (results.ipc() >= 0) ImGui::Text("IPC: %.2f", results.ipc());
+    for (uint32_t e = BRANCH_MISSES; e < PERF_EVENT_COUNT; ++e) {
+        double value = results.per_element((PERF_EVENT) e, elements);
+        if (value >= 0) ImGui::Text("%s per element: %.3f", PERF_EVENT_NAMES[e], value);
     }
 }
 
-void merge_visual(uint32_t *arr, rgb *colors, uint32_t l, uint32_t m, uint32_t r, uint32_t delay_ms) {
-    uint32_t i, j, k;
-    uint32_t n1 = m - l + 1;
-    uint32_t n2 = r - m;
-
-    uint32_t L[n1], R[n2];
-
-    for (i = 0; i < n1; i++) {
-        L[i] = arr[l + i];
-    }
-
-    for (j = 0; j < n2; j++) {
-        R[j] = arr[m + 1 + j];
-    }
-
-    i = 0;
-    j = 0;
-    k = l;
-    while (i < n1 && j < n2) {
-        if (stop_flag.load()) {
-            for (uint32_t c = l; c <= r; ++c) {
-                colors[c] = rgb(255, 255, 255);
-            }
-            current_process = PROCESS::NONE;
-            return;
-        }
-
-        if (colors[l + i].r == 255 && colors[l + i].g == 255 && colors[l + i].b == 255) colors[l + i] = rgb(255, 0, 0);
-        if (colors[m + 1 + j].r == 255 && colors[m + 1 + j].g == 255 && colors[m + 1 + j].b == 255)
-            colors[m + 1 + j] = rgb(255, 0, 0);
-
-        if (L[i] <= R[j]) {
-            arr[k] = L[i];
-            i++;
-        } else {
-            arr[k] = R[j];
-            j++;
-        }
-        k++;
-
-        if (!stop_flag.load()) std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
-
-        for (uint32_t c = l; c <= r; ++c) {
-            colors[c] = rgb(255, 255, 255);
-        }
-    }
-
-    for (uint32_t c = l; c <= r; ++c) {
-        colors[c] = rgb(255, 255, 255);
-    }
-
-    while (i < n1) {
-        if (stop_flag.load()) {
-            for (uint32_t c = l; c <= r; ++c) {
-                colors[c] = rgb(255, 255, 255);
-            }
-            current_process = PROCESS::NONE;
-            return;
-        }
-
-        arr[k] = L[i];
-        i++;
-        k++;
+static void draw_verify_result(const verify_result &result, double milliseconds) {
+    if (result.ok()) {
+        ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Verified in %.2f ms", milliseconds);
+        return;
     }
 
-    while (j < n2) {
-        if (stop_flag.load()) {
-            for (uint32_t c = l; c <= r; ++c) {
-                colors[c] = rgb(255, 255, 255);
-            }
-            current_process = PROCESS::NONE;
-            return;
-        }
-
-        arr[k] = R[j];
-        j++;
-        k++;
-    }
+    if (!result.sorted) ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Not sorted at index %u", result.first_unsorted);
+    if (!result.permutation) ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Values changed (checksum mismatch)");
 }
 
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "misc-no-recursion"
-
-void merge_sort_algorithm(uint32_t *arr, uint32_t l, uint32_t r) {
-    if (l < r) {
-        uint32_t m = l + (r - l) / 2;
-        merge_sort_algorithm(arr, l, m);
-        merge_sort_algorithm(arr, m + 1, r);
-        merge(arr, l, m, r);
-    }
+static void draw_operation_counts(const operation_counts &counts) {
+    ImGui::Text("Comparisons: %llu", (unsigned long long) counts.comparisons);
+    ImGui::Text("Swaps: %llu", (unsigned long long) counts.swaps);
+    ImGui::Text("Reads: %llu  Writes: %llu", (unsigned long long) counts.reads, (unsigned long long) counts.writes);
+    ImGui::Text("Aux Memory Peak: %llu bytes", (unsigned long long) counts.aux_bytes_peak);
+    ImGui::Text("Recursion Depth: %u", counts.max_depth);
 }
 
-void merge_sort_algorithm_visual(uint32_t *arr, rgb *colors, uint32_t l, uint32_t r, uint32_t delay_ms) {
-    if (l < r) {
-        uint32_t m = l + (r - l) / 2;
-
-        merge_sort_algorithm_visual(arr, colors, l, m, delay_ms);
-        merge_sort_algorithm_visual(arr, colors, m + 1, r, delay_ms);
-
-        colors[l] = rgb(0, 255, 0);
-        colors[m] = rgb(0, 0, 255);
-        colors[r] = rgb(0, 255, 0);
-
-        merge_visual(arr, colors, l, m, r, delay_ms);
-
-        if (!stop_flag.load()) std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
-
-        if (stop_flag.load()) {
-            for (uint32_t c = l; c <= r; ++c) {
-                colors[c] = rgb(255, 255, 255);
-            }
-            current_process = PROCESS::NONE;
-            return;
-        }
-    } else if (l == r) {
-        colors[l] = rgb(0, 255, 0);
-        if (!stop_flag.load()) std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
-        colors[l] = rgb(255, 255, 255);
-    }
-
-    current_process = PROCESS::NONE;
-}
-
-#pragma clang diagnostic pop
-
 int main(int, char **) {
     glfwSetErrorCallback(glfw_error_callback);
     if (!glfwInit()) {
@@ -323,6 +159,9 @@ int main(int, char **) {
 
     ImVec4 clear_color = ImVec4(0.1f, 0.1f, 0.1f, 0.1f);
 
+    run_controller controller;
+    benchmark_sweep sweep;
+
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
@@ -331,21 +170,76 @@ int main(int, char **) {
         ImGui::NewFrame();
 
         static bool render = true, show_message = false, auto_update = false, unique_nums = false, unique_nums_ui = false;
+        static bool report_sort_time = false, report_counts = false, report_perf = false, report_verify = false;
         static float clearance = 0.3, height_coefficient_multiplier = 0.9;
 
-        static SORTING_ALGORITHMS selected_sorting_algorithm = SORTING_ALGORITHMS::BUBBLE_SORT;
+        static int selected_sorting_algorithm = 0, selection_k = 10;
+        static bool count_operations = false, hardware_counters = false, verify_sort_result = true;
+        static bool show_benchmark = false;
 
-        static int arr_size = 100, arr_size_ui = 100, max_num = 1000, max_num_ui = 1000, delay = 5;
+        static int arr_size = 100, arr_size_ui = 100, max_num = 1000, max_num_ui = 1000;
+        static int speed_unit = 0;
+        static float speed = 200, shuffle_speed = 100;
 
-        static uint32_t *arr = nullptr;
-        static rgb *colors = nullptr;
         static uint64_t sort_time = 0;
+        static perf_results sort_perf;
+        static uint32_t sort_perf_threads = 1;
+        static verify_result sort_verify;
+        static double sort_verify_ms = 0;
 
         static std::random_device rd;
         static std::mt19937 rng(rd());
 
+        if (controller.poll_finished() && report_sort_time) {
+            report_sort_time = false;
+            show_message = true;
+        }
+
+        if (arr_size_ui < 1) arr_size_ui = 1;
+
+        double frames_per_second = io.Framerate > 1.0f ? io.Framerate : 60.0;
+        double visual_operations_per_second = speed_unit == 0 ? speed : speed * frames_per_second;
+
+        if (controller.process() == PROCESS::SORTING) {
+            controller.set_operations_per_second(visual_operations_per_second);
+        }
+
         if (ImGui::BeginMainMenuBar()) {
             if (ImGui::BeginMenu("File")) {
+                static char dataset_path[512] = "dataset.csv";
+                static std::string dataset_status;
+
+                ImGui::InputText("Path", dataset_path, sizeof(dataset_path));
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Raw little-endian uint32 binary, or .csv/.txt/.tsv with one key per field.");
+
+                if (ImGui::Button("Load") && !controller.busy()) {
+                    std::vector<uint32_t> values;
+                    std::string error;
+                    if (load_dataset(dataset_path, values, error)) {
+                        dataset_status = "Loaded " + std::to_string(values.size()) + " values.";
+                        arr_size = arr_size_ui = (int) std::min<size_t>(values.size(), INT32_MAX);
+                        controller.assign(std::move(values));
+                    } else {
+                        dataset_status = error;
+                    }
+                }
+
+                ImGui::SameLine();
+
+                if (ImGui::Button("Save") && !controller.busy()) {
+                    std::string error;
+                    if (save_dataset(dataset_path, controller.data(), controller.size(), error)) {
+                        dataset_status = "Saved " + std::to_string(controller.size()) + " values.";
+                    } else {
+                        dataset_status = error;
+                    }
+                }
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Saves the array as it is now, e.g. after sorting.");
+
+                if (!dataset_status.empty()) ImGui::TextUnformatted(dataset_status.c_str());
+                ImGui::Separator();
+
                 if (ImGui::MenuItem("Exit")) {
                     glfwSetWindowShouldClose(window, true);
                 }
@@ -353,12 +247,17 @@ int main(int, char **) {
             }
 
             if (ImGui::BeginMenu("Array")) {
-                static int shuffle_delay_ms = 10;
-
                 ImGui::InputInt("Number Of Elements", &arr_size_ui, 1);
                 ImGui::InputInt("Max Value", &max_num_ui, 1);
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Affects only non-unique arrays!");
-                ImGui::InputInt("Shuffle Visual Delay (milliseconds)", &shuffle_delay_ms, 1);
+                ImGui::SliderFloat(
+                        "Shuffle Speed (operations per second)",
+                        &shuffle_speed,
+                        1,
+                        1e8,
+                        "%.0f",
+                        ImGuiSliderFlags_Logarithmic
+                );
                 ImGui::Checkbox("Only Unique Values", &unique_nums_ui);
                 if (ImGui::IsItemHovered())
                     ImGui::SetTooltip(
@@ -367,63 +266,23 @@ int main(int, char **) {
                 ImGui::Checkbox("Auto Update", &auto_update);
                 ImGui::Separator();
 
-                if (ImGui::Button("Randomize") && current_process == PROCESS::NONE) {
+                if (ImGui::Button("Randomize") && !controller.busy()) {
                     arr_size = arr_size_ui;
                     max_num = max_num_ui;
                     unique_nums = unique_nums_ui;
 
-                    free(arr);
-                    free(colors);
-
-                    arr = (uint32_t *) malloc(arr_size_ui * sizeof(uint32_t));
-                    colors = (rgb *) malloc(arr_size_ui * sizeof(rgb));
-
-                    if (unique_nums) {
-                        for (int i = 0; i < arr_size_ui; ++i) {
-                            arr[i] = i;
-                            colors[i] = rgb(255, 255, 255);
-                        }
-
-                        for (int i = arr_size_ui - 1; i > 0; --i) {
-                            std::uniform_int_distribution<int> distribution(0, i);
-                            std::swap(arr[i], arr[distribution(rng)]);
-                        }
-                    } else {
-                        std::uniform_int_distribution<uint32_t> distribution(1, arr_size_ui);
-                        for (int i = 0; i < arr_size_ui; ++i) {
-                            arr[i] = distribution(rng);
-                            colors[i] = rgb(255, 255, 255);
-                        }
-                    }
+                    controller.regenerate(arr_size, unique_nums ? DISTRIBUTION::UNIQUE : DISTRIBUTION::UNIFORM, rng);
                 }
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Randomizes array with new values.");
 
                 ImGui::SameLine();
 
-                if (ImGui::Button("Shuffle") && current_process == PROCESS::NONE) {
-                    current_process = PROCESS::SHUFFLING;
-
-                    auto shuffle_thread_func = []() {
-                        for (int i = arr_size - 1; i > 0; --i) {
-                            std::uniform_int_distribution<int> distribution(0, i);
-                            int j = distribution(rng);
-
-                            colors[i] = rgb(255, 0, 0);
-                            colors[j] = rgb(0, 255, 0);
-
-                            std::swap(arr[i], arr[j]);
-
-                            std::this_thread::sleep_for(std::chrono::milliseconds(shuffle_delay_ms));
-
-                            colors[i] = rgb(255, 255, 255);
-                            colors[j] = rgb(255, 255, 255);
-                        }
-
-                        current_process = PROCESS::NONE;
-                    };
-
-                    std::thread shuffle_thread(shuffle_thread_func);
-                    shuffle_thread.detach();
+                if (ImGui::Button("Shuffle") && !controller.busy()) {
+                    controller.set_operations_per_second(shuffle_speed);
+                    controller.start_visual(
+                            PROCESS::SHUFFLING,
+                            shuffle_visual(controller.data(), controller.size(), rng, controller.token())
+                    );
                 }
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Shuffles array. Keeps old values.");
 
@@ -433,83 +292,159 @@ int main(int, char **) {
             if (ImGui::BeginMenu("Sort")) {
                 ImGui::Combo(
                         "Sorting Algorithm",
-                        reinterpret_cast<int *>(&selected_sorting_algorithm),
-                        SORTING_ALGORITHMS_NAMES, 2
+                        &selected_sorting_algorithm,
+                        sorting_algorithm_name,
+                        nullptr,
+                        (int) (SORTING_ALGORITHMS_COUNT + SELECTION_ALGORITHMS_COUNT)
                 );
 
-                ImGui::InputInt("Visual Delay (microseconds)", &delay, 1);
+                const selection_algorithm *partial = selected_partial_sort(selected_sorting_algorithm);
+                if (partial) {
+                    ImGui::InputInt("k", &selection_k, 1);
+                    if (selection_k < 0) selection_k = 0;
+                    if (ImGui::IsItemHovered())
+                        ImGui::SetTooltip(partial->kind == SELECTION::NTH_ELEMENT
+                                          ? "Rank of the key to put in place (0 is the smallest)."
+                                          : "How many of the smallest keys to collect and sort.");
+                }
+
+                static const char *SPEED_UNIT_NAMES[] = {"Operations Per Second", "Operations Per Frame"};
+                ImGui::Combo("Speed Unit", &speed_unit, SPEED_UNIT_NAMES, 2);
+                ImGui::SliderFloat("Visual Speed", &speed, 1, 1e8, "%.0f", ImGuiSliderFlags_Logarithmic);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Can be changed while a visualization is running.");
+
+                ImGui::Checkbox("Count Operations", &count_operations);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Runs the instrumented kernel for 'Sort'. Visualizations always count.");
+                ImGui::SameLine();
+                ImGui::Checkbox("Hardware Counters", &hardware_counters);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Wraps 'Sort' with perf_event_open counters (Linux only).");
+                ImGui::SameLine();
+                ImGui::Checkbox("Verify", &verify_sort_result);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Checks that 'Sort' left the array sorted with the same values. Not included in the time.");
+
+                static int thread_count = (int) active_threads();
+                if (ImGui::InputInt("Threads", &thread_count, 1)) {
+                    thread_count = std::clamp(thread_count, 1, 4096);
+                    set_active_threads((uint32_t) thread_count);
+                }
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Size of the thread pool that parallel sorts and verification share.");
+
+                static int affinity = (int) thread_affinity();
+                if (ImGui::Combo("Thread Affinity", &affinity, THREAD_AFFINITY_IDS, THREAD_AFFINITY_COUNT)) {
+                    set_thread_affinity((THREAD_AFFINITY) affinity);
+                }
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("none: left to the scheduler, compact: one CPU per worker, spread: round-robin over NUMA nodes.");
 
                 ImGui::Separator();
 
-                if (ImGui::Button("Sort") && current_process == PROCESS::NONE && arr) {
-                    switch (selected_sorting_algorithm) {
-                        case BUBBLE_SORT: {
-                            current_process = PROCESS::SORTING;
-                            auto start_time = std::chrono::high_resolution_clock::now();
-                            bubble_sort_algorithm(arr, arr_size);
-                            auto end_time = std::chrono::high_resolution_clock::now();
-                            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                    end_time - start_time);
-                            sort_time = duration.count();
-                            show_message = true;
-                            current_process = PROCESS::NONE;
-                            break;
-                        }
-                        case MERGE_SORT:
-                            current_process = PROCESS::SORTING;
-                            auto start_time = std::chrono::high_resolution_clock::now();
-                            merge_sort_algorithm(arr, 0, arr_size - 1);
-                            auto end_time = std::chrono::high_resolution_clock::now();
-                            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                    end_time - start_time);
-                            sort_time = duration.count();
-                            show_message = true;
-                            current_process = PROCESS::NONE;
-                            break;
-                    }
+                if (ImGui::Button("Sort") && !controller.busy() && !controller.empty()) {
+                    report_counts = count_operations;
+                    report_perf = hardware_counters;
+                    report_verify = verify_sort_result;
+                    report_sort_time = controller.start(
+                            PROCESS::SORTING,
+                            [algorithm = partial ? nullptr : &SORTING_ALGORITHMS[selected_sorting_algorithm],
+                                    partial,
+                                    k = (uint32_t) selection_k,
+                                    counted = count_operations,
+                                    measured = hardware_counters,
+                                    verified = verify_sort_result](run_controller &run) {
+                                auto verify_start = std::chrono::high_resolution_clock::now();
+                                uint64_t input_checksum = verified ? multiset_checksum(run.data(), run.size()) : 0;
+                                double checksum_ms = std::chrono::duration<double, std::milli>(
+                                        std::chrono::high_resolution_clock::now() - verify_start).count();
+
+                                // Counters follow the calling thread, so they are opened on the worker.
+                                perf_counters perf;
+                                if (measured) perf.start();
+                                auto start_time = std::chrono::high_resolution_clock::now();
+                                if (partial && counted) {
+                                    partial->select_counted(run.data(), run.size(), k, run.token(), run.counters());
+                                } else if (partial) {
+                                    partial->select(run.data(), run.size(), k, run.token());
+                                } else if (counted) {
+                                    algorithm->sort_counted(run.data(), run.size(), run.token(), run.counters());
+                                } else {
+                                    algorithm->sort(run.data(), run.size(), run.token());
+                                }
+                                auto end_time = std::chrono::high_resolution_clock::now();
+                                if (measured) perf.stop();
+                                sort_perf = measured ? perf.results() : perf_results();
+                                sort_perf_threads = algorithm && algorithm->parallel && !counted ? active_threads() : 1;
+                                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                        end_time - start_time);
+                                sort_time = duration.count();
+
+                                if (verified) {
+                                    verify_start = std::chrono::high_resolution_clock::now();
+                                    sort_verify = partial
+                                                  ? verify_selection(input_checksum, run.data(), run.size(), k, partial->kind)
+                                                  : verify_sort(input_checksum, run.data(), run.size());
+                                    sort_verify_ms = checksum_ms + std::chrono::duration<double, std::milli>(
+                                            std::chrono::high_resolution_clock::now() - verify_start).count();
+                                }
+                            }
+                    );
                 }
 
                 ImGui::SameLine();
 
-                if (ImGui::Button("Visualize") && current_process == PROCESS::NONE && arr && colors) {
-                    switch (selected_sorting_algorithm) {
-                        case BUBBLE_SORT: {
-                            current_process = PROCESS::SORTING;
-                            stop_flag.store(false);
-                            std::thread sorting_thread(
-                                    bubble_sort_algorithm_visual,
-                                    arr,
-                                    colors,
-                                    arr_size,
-                                    delay
-                            );
-
-                            sorting_thread.detach();
-                            break;
-                        }
-                        case MERGE_SORT:
-                            current_process = PROCESS::SORTING;
-                            stop_flag.store(false);
-                            std::thread sorting_thread(
-                                    merge_sort_algorithm_visual,
-                                    arr,
-                                    colors,
-                                    0,
-                                    arr_size,
-                                    delay
-                            );
-
-                            sorting_thread.detach();
-                            break;
-                    }
+                if (ImGui::Button("Visualize") && !controller.busy() && !controller.empty()) {
+                    controller.set_operations_per_second(visual_operations_per_second);
+                    controller.start_visual(
+                            PROCESS::SORTING,
+                            partial
+                            ? partial->visual(controller.data(), controller.size(), (uint32_t) selection_k, controller.token())
+                            : SORTING_ALGORITHMS[selected_sorting_algorithm].visual(
+                                    controller.data(),
+                                    controller.size(),
+                                    controller.token()
+                            )
+                    );
                 }
 
                 ImGui::SameLine();
 
                 if (ImGui::Button("Stop")) {
-                    stop_flag.store(true);
+                    controller.stop();
+                }
+
+                ImGui::Separator();
+
+                static int step_operations = 100;
+
+                if (controller.paused()) {
+                    if (ImGui::Button("Resume")) controller.resume();
+                } else {
+                    if (ImGui::Button("Pause")) controller.pause();
                 }
 
+                ImGui::SameLine();
+
+                if (ImGui::Button("Step")) controller.step(1);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Performs a single compare/swap/write and pauses.");
+
+                ImGui::SameLine();
+
+                if (ImGui::Button("Step N")) controller.step(step_operations);
+
+                ImGui::InputInt("N", &step_operations, 1);
+                if (step_operations < 1) step_operations = 1;
+
+                ImGui::Text("Operations: %llu", (unsigned long long) controller.operations());
+                draw_operation_counts(controller.counters().counts());
+
+                ImGui::EndMenu();
+            }
+
+            if (ImGui::BeginMenu("Benchmark")) {
+                ImGui::MenuItem("Scaling Sweep", nullptr, &show_benchmark);
                 ImGui::EndMenu();
             }
 
@@ -517,6 +452,21 @@ int main(int, char **) {
                 ImGui::Checkbox("Render Enable", &render);
                 ImGui::SliderFloat("Clearance", &clearance, 0, 1);
                 ImGui::SliderFloat("Height Coefficient", &height_coefficient_multiplier, 0, 1);
+                ImGui::Separator();
+
+                static int publish_mode = run_controller::PUBLISH_MODE::PUBLISH_RATE, publish_value = 120;
+                static const char *PUBLISH_MODE_NAMES[] = {"Snapshots Per Second", "Operations Per Snapshot"};
+
+                bool publish_changed = ImGui::Combo("Snapshot Publishing", &publish_mode, PUBLISH_MODE_NAMES, 2);
+                publish_changed |= ImGui::InputInt("Publish Value", &publish_value, 1);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("How often a running sort hands a consistent copy of the array to the renderer.");
+                if (publish_value < 1) publish_value = 1;
+
+                if (publish_changed) {
+                    controller.set_publish_policy((run_controller::PUBLISH_MODE) publish_mode, publish_value);
+                }
+
                 ImGui::EndMenu();
             }
 
@@ -525,17 +475,14 @@ int main(int, char **) {
                 ImGui::TextColored(ImVec4(0.0f, 0.0f, 1.0f, 1.0f), "Made by Denys Bondar in 2023.");
                 ImGui::Text("");
                 ImGui::Text("This program is still in development, so there might be bugs.");
-                ImGui::Text("");
-                ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "---------- IMPORTANT ----------");
-                ImGui::Text("Please don't use 'stop' button for large arrays while sorting with merge sort.");
-                ImGui::Text("Merge sort is implemented as a recursive function that runs on independent thread, so it's not that easy to stop it.");
-                ImGui::Text("Hopefully, I will fix it in next updates.");
                 ImGui::EndMenu();
             }
 
             ImGui::EndMainMenuBar();
         }
 
+        if (show_benchmark) draw_benchmark_panel(&show_benchmark, sweep);
+
         if (show_message) {
             ImGui::OpenPopup("Message");
             show_message = false;
@@ -546,7 +493,9 @@ int main(int, char **) {
                 nullptr,
                 ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove
         )) {
-            float popup_width = 200, popup_height = 100;
+            float popup_width = report_counts || report_perf ? 320 : 200;
+            float popup_height = 100 + (report_counts ? 100.0f : 0.0f) + (report_perf ? 120.0f : 0.0f) +
+                                 (report_verify ? 40.0f : 0.0f);
 
             int window_width, window_height;
             glfwGetFramebufferSize(window, &window_width, &window_height);
@@ -560,7 +509,10 @@ int main(int, char **) {
 
             ImGui::SetWindowSize(ImVec2(popup_width, popup_height));
 
-            ImGui::Text("Sorted in %i milliseconds", sort_time);
+            ImGui::Text("Sorted in %llu milliseconds", (unsigned long long) sort_time);
+            if (report_verify) draw_verify_result(sort_verify, sort_verify_ms);
+            if (report_counts) draw_operation_counts(controller.counters().counts());
+            if (report_perf) draw_perf_results(sort_perf, controller.size(), sort_perf_threads);
             ImGui::Separator();
 
             if (ImGui::Button("OK", ImVec2(120, 0))) {
@@ -585,35 +537,21 @@ int main(int, char **) {
             max_num = max_num_ui;
             unique_nums = unique_nums_ui;
 
-            free(arr);
-            free(colors);
-
-            arr = (uint32_t *) malloc(arr_size_ui * sizeof(uint32_t));
-            colors = (rgb *) malloc(arr_size_ui * sizeof(rgb));
-
-            if (unique_nums) {
-                for (int i = 0; i < arr_size_ui; ++i) {
-                    arr[i] = i;
-                    colors[i] = rgb(255, 255, 255);
-                }
-
-                for (int i = arr_size_ui - 1; i > 0; --i) {
-                    std::uniform_int_distribution<int> distribution(0, i);
-                    std::swap(arr[i], arr[distribution(rng)]);
-                }
-            } else {
-                std::uniform_int_distribution<uint32_t> distribution(1, arr_size_ui);
-                for (int i = 0; i < arr_size_ui; ++i) {
-                    arr[i] = distribution(rng);
-                    colors[i] = rgb(255, 255, 255);
-                }
-            }
-
-            arr_size = arr_size_ui;
+            controller.regenerate(arr_size, unique_nums ? DISTRIBUTION::UNIQUE : DISTRIBUTION::UNIFORM, rng);
         }
 
-        if (render && arr && colors) {
-            draw_bar_chart(arr, arr_size, colors, window, clearance, height_coefficient_multiplier);
+        controller.advance();
+
+        const run_controller::snapshot &snapshot = controller.latest_snapshot();
+        if (render && !snapshot.arr.empty()) {
+            draw_bar_chart(
+                    snapshot.arr.data(),
+                    (uint32_t) snapshot.arr.size(),
+                    snapshot.colors.data(),
+                    window,
+                    clearance,
+                    height_coefficient_multiplier
+            );
         }
 
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -0,0 +1,139 @@
+#include "numa.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+const char *MEMORY_PLACEMENT_IDS[] = {"single", "local", "interleaved"};
+
+bool parse_memory_placement(const char *id, MEMORY_PLACEMENT &placement) {
+    for (uint32_t p = 0; p < MEMORY_PLACEMENT_COUNT; ++p) {
+        if (strcmp(id, MEMORY_PLACEMENT_IDS[p]) == 0) {
+            placement = (MEMORY_PLACEMENT) p;
+            return true;
+        }
+    }
+    return false;
+}
+
+static thread_local int32_t bound_node = -1;
+
+int32_t numa_bound_node() {
+    return bound_node;
+}
+
+#if defined(__linux__)
+
+// Parses a sysfs CPU list such as "0-3,8-11".
+static std::vector<uint32_t> parse_cpu_list(const char *list) {
+    std::vector<uint32_t> cpus;
+    const char *p = list;
+
+    while (*p >= '0' && *p <= '9') {
+        char *end;
+        uint32_t first = (uint32_t) strtoul(p, &end, 10), last = first;
+        if (*end == '-') last = (uint32_t) strtoul(end + 1, &end, 10);
+        for (uint32_t cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+
+        p = *end == ',' ? end + 1 : end;
+    }
+    return cpus;
+}
+
+static std::vector<numa_node> detect_numa_nodes() {
+    std::vector<numa_node> nodes;
+
+    for (uint32_t id = 0; id < 1024; ++id) {
+        char path[96], list[4096] = {};
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", id);
+        FILE *file = fopen(path, "r");
+        if (!file) {
+            // Node ids can have gaps, but not past the possible range.
+            if (id >= 64) break;
+            continue;
+        }
+        if (!fgets(list, sizeof(list), file)) list[0] = 0;
+        fclose(file);
+
+        numa_node node{id, parse_cpu_list(list)};
+        if (!node.cpus.empty()) nodes.push_back(node);
+    }
+    return nodes;
+}
+
+numa_binding::numa_binding(uint32_t node) : previous_node(bound_node) {
+    bound_node = (int32_t) node;
+
+    const std::vector<numa_node> &nodes = numa_nodes();
+    cpu_set_t previous, mask;
+    if (nodes.size() == 1 || sched_getaffinity(0, sizeof(previous), &previous) != 0) return;
+
+    CPU_ZERO(&mask);
+    for (uint32_t cpu: nodes[node % nodes.size()].cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &mask);
+    }
+    if (sched_setaffinity(0, sizeof(mask), &mask) != 0) return;
+
+    saved_mask.resize(sizeof(previous));
+    memcpy(saved_mask.data(), &previous, sizeof(previous));
+}
+
+numa_binding::~numa_binding() {
+    bound_node = previous_node;
+    if (saved_mask.empty()) return;
+
+    cpu_set_t previous;
+    memcpy(&previous, saved_mask.data(), sizeof(previous));
+    sched_setaffinity(0, sizeof(previous), &previous);
+}
+
+#else
+
+static std::vector<numa_node> detect_numa_nodes() {
+    return {};
+}
+
+numa_binding::numa_binding(uint32_t node) : previous_node(bound_node) {
+    bound_node = (int32_t) node;
+}
+
+numa_binding::~numa_binding() {
+    bound_node = previous_node;
+}
+
+#endif
+
+const std::vector<numa_node> &numa_nodes() {
+    static const std::vector<numa_node> nodes = []() {
+        std::vector<numa_node> detected = detect_numa_nodes();
+        if (detected.empty()) {
+            numa_node all{0, {}};
+            for (uint32_t cpu = 0; cpu < hardware_threads(); ++cpu) all.cpus.push_back(cpu);
+            detected.push_back(all);
+        }
+        return detected;
+    }();
+    return nodes;
+}
+
+// -1 until the first numa_aware() call reads SORTING_NUMA.
+static std::atomic<int> selected_numa_aware(-1);
+
+bool numa_aware() {
+    int aware = selected_numa_aware.load(std::memory_order_relaxed);
+    if (aware >= 0) return aware;
+
+    const char *value = getenv("SORTING_NUMA");
+    aware = value && strcmp(value, "1") == 0;
+    selected_numa_aware.store(aware, std::memory_order_relaxed);
+    return aware;
+}
+
+void set_numa_aware(bool aware) {
+    selected_numa_aware.store(aware, std::memory_order_relaxed);
+}
@@ -0,0 +1,223 @@
+#ifndef SORTING_ALGORITHMS_NUMA_H
+#define SORTING_ALGORITHMS_NUMA_H
+
+#include "cancel_token.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// NUMA support without libnuma. Nodes are read from /sys/devices/system/node on Linux
+// (elsewhere there is one node holding every CPU), threads are bound to a node through
+// their scheduler affinity mask, and memory is placed by the kernel's first-touch
+// policy: a page lands on the node of the thread that first writes it, so a buffer is
+// placed by choosing which threads fill it.
+
+// Granularity of INTERLEAVED placement.
+static constexpr uint32_t NUMA_PAGE_BYTES = 4096;
+// numa_sort leaves slices shorter than this to a single parallel sort.
+static constexpr uint32_t NUMA_SORT_MIN_SLICE = 1 << 16;
+
+struct numa_node {
+    uint32_t id;
+    std::vector<uint32_t> cpus;
+};
+
+// Nodes that have CPUs, at least one.
+const std::vector<numa_node> &numa_nodes();
+
+// Binds the calling thread to the CPUs of numa_nodes()[node % count] until destroyed,
+// then restores its previous mask. Batches the thread submits to a thread_pool meanwhile
+// carry the node, and whichever thread runs one of their tasks binds itself to it for
+// that task, so nested parallel work stays on the node. The mask is left alone where
+// affinity cannot be set, but the node is still carried.
+class numa_binding {
+public:
+    explicit numa_binding(uint32_t node);
+    ~numa_binding();
+
+    numa_binding(const numa_binding &) = delete;
+    numa_binding &operator=(const numa_binding &) = delete;
+
+private:
+    int32_t previous_node;
+    std::vector<unsigned char> saved_mask;
+};
+
+// Node of the innermost numa_binding on the calling thread, or -1.
+int32_t numa_bound_node();
+
+// Where the pages of a buffer end up:
+//   SINGLE_NODE  all on the node of the calling thread, as with a plain copy
+//   NODE_LOCAL   node n holds the n-th of numa_nodes().size() equal slices, the one
+//                numa_sort gives to node n
+//   INTERLEAVED  pages round-robin over the nodes, like numactl --interleave=all
+enum MEMORY_PLACEMENT {
+    SINGLE_NODE,
+    NODE_LOCAL,
+    INTERLEAVED,
+    MEMORY_PLACEMENT_COUNT
+};
+
+extern const char *MEMORY_PLACEMENT_IDS[];
+
+// Returns false if the id is unknown.
+bool parse_memory_placement(const char *id, MEMORY_PLACEMENT &placement);
+
+// NUMA-aware mode of the parallel engines, where they sort through numa_sort: off
+// unless the SORTING_NUMA environment variable is 1 or set_numa_aware() turned it on.
+bool numa_aware();
+void set_numa_aware(bool aware);
+
+// First element of node `node`'s slice when [0, size) is split over `nodes` nodes.
+inline uint32_t numa_slice_begin(uint32_t size, uint32_t node, uint32_t nodes) {
+    return (uint32_t) ((uint64_t) size * node / nodes);
+}
+
+// Copies src to dst with dst's pages placed as asked. Placement only takes effect on
+// pages nothing has written yet, such as a fresh large allocation.
+template<typename T>
+void place_copy(T *dst, const T *src, uint32_t size, MEMORY_PLACEMENT placement) {
+    uint32_t nodes = (uint32_t) numa_nodes().size();
+    if (placement == SINGLE_NODE || nodes == 1) {
+        std::copy(src, src + size, dst);
+        return;
+    }
+
+    run_parallel(nodes, [&](uint32_t node) {
+        numa_binding binding(node);
+
+        if (placement == NODE_LOCAL) {
+            uint32_t begin = numa_slice_begin(size, node, nodes), end = numa_slice_begin(size, node + 1, nodes);
+            std::copy(src + begin, src + end, dst + begin);
+            return;
+        }
+
+        // Chunk 0 runs up to the first page boundary, every further chunk is one page.
+        uint64_t per_page = std::max<uint64_t>(1, NUMA_PAGE_BYTES / sizeof(T));
+        uint64_t head = (NUMA_PAGE_BYTES - (uintptr_t) dst % NUMA_PAGE_BYTES) % NUMA_PAGE_BYTES / sizeof(T);
+        for (uint64_t chunk = node; ; chunk += nodes) {
+            uint64_t begin = chunk ? head + (chunk - 1) * per_page : 0;
+            uint64_t end = std::min<uint64_t>(head + chunk * per_page, size);
+            if (begin >= size) break;
+            std::copy(src + begin, src + end, dst + begin);
+        }
+    });
+}
+
+// Splits sorted runs [run_begin[r], run_begin[r + 1]) of arr at global rank `rank`:
+// positions[r] is where run r is cut, the cuts add up to `rank` elements, and no element
+// before a cut is larger than one after any cut. O(runs^2 log^2 n).
+template<typename T>
+void multisequence_split(const T *arr, const uint32_t *run_begin, uint32_t runs, uint64_t rank, uint32_t *positions) {
+    auto count_below = [&](const T &key, uint32_t r) {
+        return (uint32_t) (std::lower_bound(arr + run_begin[r], arr + run_begin[r + 1], key) - arr);
+    };
+    auto count_up_to = [&](const T &key, uint32_t r) {
+        return (uint32_t) (std::upper_bound(arr + run_begin[r], arr + run_begin[r + 1], key) - arr);
+    };
+
+    // The key of rank `rank` is in some run; search each for a key whose range of
+    // global ranks contains it.
+    for (uint32_t run = 0; run < runs; ++run) {
+        uint32_t lo = run_begin[run], hi = run_begin[run + 1];
+
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            uint64_t below = 0, up_to = 0;
+            for (uint32_t r = 0; r < runs; ++r) {
+                below += count_below(arr[mid], r) - run_begin[r];
+                up_to += count_up_to(arr[mid], r) - run_begin[r];
+            }
+
+            if (up_to <= rank) {
+                lo = mid + 1;
+            } else if (below > rank) {
+                hi = mid;
+            } else {
+                // Everything below arr[mid] goes left, then as many copies of it as fit.
+                uint64_t remaining = rank - below;
+                for (uint32_t r = 0; r < runs; ++r) {
+                    positions[r] = count_below(arr[mid], r);
+                    uint32_t equal = std::min<uint64_t>(remaining, count_up_to(arr[mid], r) - positions[r]);
+                    positions[r] += equal;
+                    remaining -= equal;
+                }
+                return;
+            }
+        }
+    }
+
+    // Only reached for rank == total.
+    for (uint32_t r = 0; r < runs; ++r) positions[r] = run_begin[r + 1];
+}
+
+// NUMA-aware sort: node n's threads, bound to it, sort the n-th slice (local under
+// NODE_LOCAL placement) with sort(slice, length, threads). Then the output is cut into
+// one part per thread by multisequence_split, and each thread, bound to the node whose
+// slice its part falls in, merges the part from every slice into a scratch buffer it
+// first-touches, before all parts are copied back. Only the merge reads remote memory,
+// once. Cancellation is checked before the merge; the array stays a permutation of its
+// input either way.
+template<typename T, typename SORT>
+void numa_sort(T *arr, uint32_t size, uint32_t nodes, uint32_t threads, const cancel_token &token, SORT sort) {
+    threads = std::max<uint32_t>(1, threads);
+    nodes = std::clamp<uint32_t>(std::min(nodes, size / NUMA_SORT_MIN_SLICE), 1, threads);
+    if (nodes == 1) {
+        sort(arr, size, threads);
+        return;
+    }
+
+    uint32_t per_node = threads / nodes;
+    std::vector<uint32_t> run_begin(nodes + 1);
+    for (uint32_t node = 0; node <= nodes; ++node) run_begin[node] = numa_slice_begin(size, node, nodes);
+
+    run_parallel(nodes, [&](uint32_t node) {
+        numa_binding binding(node);
+        sort(arr + run_begin[node], run_begin[node + 1] - run_begin[node], per_node);
+    });
+    if (token.requested()) return;
+
+    // Part p of node n covers output ranks [bounds[p], bounds[p + 1]) inside n's slice.
+    uint32_t parts = nodes * per_node;
+    std::vector<uint32_t> bounds(parts + 1);
+    for (uint32_t node = 0; node < nodes; ++node) {
+        uint32_t length = run_begin[node + 1] - run_begin[node];
+        for (uint32_t p = 0; p < per_node; ++p) {
+            bounds[node * per_node + p] = run_begin[node] + numa_slice_begin(length, p, per_node);
+        }
+    }
+    bounds[parts] = size;
+
+    std::vector<uint32_t> cuts((uint64_t) (parts + 1) * nodes);
+    run_parallel(parts + 1, [&](uint32_t p) {
+        multisequence_split(arr, run_begin.data(), nodes, bounds[p], cuts.data() + (uint64_t) p * nodes);
+    });
+
+    std::vector<std::unique_ptr<T[]>> merged(parts);
+    run_parallel(parts, [&](uint32_t p) {
+        numa_binding binding(p / per_node);
+        const uint32_t *from = cuts.data() + (uint64_t) p * nodes, *to = from + nodes;
+        uint32_t length = bounds[p + 1] - bounds[p];
+        merged[p].reset(new T[length]);
+
+        // Runs are few, so the smallest head is found by a linear scan.
+        std::vector<uint32_t> heads(from, to);
+        for (uint32_t i = 0; i < length; ++i) {
+            uint32_t best = nodes;
+            for (uint32_t r = 0; r < nodes; ++r) {
+                if (heads[r] < to[r] && (best == nodes || arr[heads[r]] < arr[heads[best]])) best = r;
+            }
+            merged[p][i] = arr[heads[best]++];
+        }
+    });
+
+    run_parallel(parts, [&](uint32_t p) {
+        numa_binding binding(p / per_node);
+        std::copy(merged[p].get(), merged[p].get() + (bounds[p + 1] - bounds[p]), arr + bounds[p]);
+    });
+}
+
+#endif //SORTING_ALGORITHMS_NUMA_H
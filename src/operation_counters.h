@@ -0,0 +1,103 @@
+#ifndef SORTING_ALGORITHMS_OPERATION_COUNTERS_H
+#define SORTING_ALGORITHMS_OPERATION_COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+
+struct operation_counts {
+    uint64_t comparisons = 0;
+    uint64_t swaps = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t aux_bytes_peak = 0;
+    uint32_t max_depth = 0;
+};
+
+// Counting policy for the kernels in sorting_algorithms.h. Every hook is an empty
+// inline function, so a kernel instantiated with it is the uninstrumented kernel.
+struct no_counters {
+    void compare() {}
+    void swap() {}
+    void read(uint64_t) {}
+    void write(uint64_t) {}
+    void allocate(uint64_t) {}
+    void release(uint64_t) {}
+    void enter() {}
+    void leave() {}
+};
+
+// Counting policy that records every operation. There is exactly one writer (the
+// thread running the kernel), so counters are bumped with a relaxed load/store
+// pair instead of a read-modify-write, and other threads may read them live.
+class operation_counters {
+public:
+    void compare() {
+        bump(comparisons, 1);
+    }
+
+    void swap() {
+        bump(swaps, 1);
+    }
+
+    void read(uint64_t elements) {
+        bump(reads, elements);
+    }
+
+    void write(uint64_t elements) {
+        bump(writes, elements);
+    }
+
+    void allocate(uint64_t bytes) {
+        aux_bytes += bytes;
+        if (aux_bytes > aux_bytes_peak.load(std::memory_order_relaxed))
+            aux_bytes_peak.store(aux_bytes, std::memory_order_relaxed);
+    }
+
+    void release(uint64_t bytes) {
+        aux_bytes -= bytes;
+    }
+
+    void enter() {
+        if (++depth > max_depth.load(std::memory_order_relaxed)) max_depth.store(depth, std::memory_order_relaxed);
+    }
+
+    void leave() {
+        --depth;
+    }
+
+    // Only while no kernel is running with these counters.
+    void reset() {
+        comparisons.store(0);
+        swaps.store(0);
+        reads.store(0);
+        writes.store(0);
+        aux_bytes_peak.store(0);
+        max_depth.store(0);
+        aux_bytes = 0;
+        depth = 0;
+    }
+
+    operation_counts counts() const {
+        operation_counts result;
+        result.comparisons = comparisons.load(std::memory_order_relaxed);
+        result.swaps = swaps.load(std::memory_order_relaxed);
+        result.reads = reads.load(std::memory_order_relaxed);
+        result.writes = writes.load(std::memory_order_relaxed);
+        result.aux_bytes_peak = aux_bytes_peak.load(std::memory_order_relaxed);
+        result.max_depth = max_depth.load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    static void bump(std::atomic<uint64_t> &counter, uint64_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> comparisons{0}, swaps{0}, reads{0}, writes{0}, aux_bytes_peak{0};
+    std::atomic<uint32_t> max_depth{0};
+
+    uint64_t aux_bytes = 0;
+    uint32_t depth = 0;
+};
+
+#endif //SORTING_ALGORITHMS_OPERATION_COUNTERS_H
@@ -0,0 +1,45 @@
+#include "pacer.h"
+
+#include <algorithm>
+
+// After a stall (window drag, slow frame) at most this much backlog is run, the
+// rest is dropped instead of bursting to catch up.
+static constexpr double MAX_LAG_SECONDS = 0.1;
+
+pacer::pacer(double operations_per_second) {
+    target_rate = operations_per_second;
+}
+
+void pacer::set_rate(double operations_per_second) {
+    target_rate = std::max(operations_per_second, 1e-3);
+}
+
+double pacer::rate() const {
+    return target_rate;
+}
+
+void pacer::restart() {
+    active_rate = 0.0;
+}
+
+uint64_t pacer::due() {
+    clock::time_point now = clock::now();
+
+    if (target_rate != active_rate) {
+        // Keep the fractional progress towards the next operation when the rate changes.
+        double elapsed = std::chrono::duration<double>(now - origin).count();
+        double carried = active_rate > 0.0 ? std::clamp(elapsed * active_rate - (double) scheduled, 0.0, 1.0) : 0.0;
+
+        active_rate = target_rate;
+        origin = now - std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(carried / active_rate));
+        scheduled = 0;
+    }
+
+    double elapsed = std::chrono::duration<double>(now - origin).count();
+    auto target = (uint64_t) (elapsed * active_rate);
+    uint64_t operations = target - scheduled;
+    scheduled = target;
+
+    uint64_t max_operations = std::max<uint64_t>(1, (uint64_t) (active_rate * MAX_LAG_SECONDS));
+    return std::min(operations, max_operations);
+}
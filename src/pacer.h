@@ -0,0 +1,33 @@
+#ifndef SORTING_ALGORITHMS_PACER_H
+#define SORTING_ALGORITHMS_PACER_H
+
+#include <chrono>
+#include <cstdint>
+
+// Paces visual runs to a target number of operations per second. The driver asks
+// once per frame how many operations have come due and runs them as a batch, so
+// nothing ever sleeps and any rate from well below one operation per frame up to
+// millions per frame is just a different batch size.
+class pacer {
+public:
+    explicit pacer(double operations_per_second = 1000.0);
+
+    void set_rate(double operations_per_second);
+    double rate() const;
+
+    // Starts a fresh schedule, e.g. when a run starts or resumes from a pause.
+    void restart();
+
+    // Operations that came due since the previous call.
+    uint64_t due();
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    double target_rate;
+    double active_rate = 0.0;
+    uint64_t scheduled = 0;
+    clock::time_point origin;
+};
+
+#endif //SORTING_ALGORITHMS_PACER_H
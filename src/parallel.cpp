@@ -0,0 +1,82 @@
+#include "parallel.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+// 0 until the first active_threads() call reads SORTING_THREADS.
+static std::atomic<uint32_t> selected_threads(0);
+
+uint32_t hardware_threads() {
+    uint32_t threads = std::thread::hardware_concurrency();
+    return threads ? threads : 1;
+}
+
+static uint32_t initial_threads() {
+    const char *id = getenv("SORTING_THREADS");
+    if (!id || !*id) return hardware_threads();
+
+    uint32_t threads;
+    if (!parse_threads(id, threads)) {
+        fprintf(stderr, "Ignoring invalid SORTING_THREADS=%s\n", id);
+        return hardware_threads();
+    }
+    return threads;
+}
+
+uint32_t active_threads() {
+    uint32_t threads = selected_threads.load(std::memory_order_relaxed);
+    if (threads) return threads;
+
+    threads = initial_threads();
+    selected_threads.store(threads, std::memory_order_relaxed);
+    return threads;
+}
+
+void set_active_threads(uint32_t threads) {
+    selected_threads.store(threads ? threads : hardware_threads(), std::memory_order_relaxed);
+}
+
+bool parse_threads(const char *id, uint32_t &threads) {
+    char *end;
+    unsigned long value = strtoul(id, &end, 10);
+    if (end == id || *end || value == 0 || value > 4096) return false;
+
+    threads = (uint32_t) value;
+    return true;
+}
+
+// -1 until the first thread_affinity() call reads SORTING_AFFINITY.
+static std::atomic<int> selected_affinity(-1);
+
+THREAD_AFFINITY thread_affinity() {
+    int affinity = selected_affinity.load(std::memory_order_relaxed);
+    if (affinity >= 0) return (THREAD_AFFINITY) affinity;
+
+    THREAD_AFFINITY parsed = AFFINITY_NONE;
+    const char *id = getenv("SORTING_AFFINITY");
+    if (id && *id && !parse_thread_affinity(id, parsed)) fprintf(stderr, "Ignoring invalid SORTING_AFFINITY=%s\n", id);
+
+    selected_affinity.store(parsed, std::memory_order_relaxed);
+    return parsed;
+}
+
+void set_thread_affinity(THREAD_AFFINITY affinity) {
+    selected_affinity.store(affinity, std::memory_order_relaxed);
+}
+
+std::shared_ptr<thread_pool> shared_thread_pool() {
+    static std::mutex mutex;
+    static std::shared_ptr<thread_pool> pool;
+
+    uint32_t threads = active_threads();
+    THREAD_AFFINITY affinity = thread_affinity();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pool || pool->threads() != threads || pool->affinity() != affinity) {
+        pool = std::make_shared<thread_pool>(threads, affinity);
+    }
+    return pool;
+}
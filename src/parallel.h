@@ -0,0 +1,49 @@
+#ifndef SORTING_ALGORITHMS_PARALLEL_H
+#define SORTING_ALGORITHMS_PARALLEL_H
+
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <memory>
+
+// Number of hardware threads, at least 1.
+uint32_t hardware_threads();
+
+// Threads the parallel engines use: hardware_threads(), unless changed by the
+// SORTING_THREADS environment variable or set_active_threads().
+uint32_t active_threads();
+
+// 0 selects hardware_threads() again.
+void set_active_threads(uint32_t threads);
+
+// Returns false unless id is a positive thread count.
+bool parse_threads(const char *id, uint32_t &threads);
+
+// How the shared pool pins its workers: AFFINITY_NONE unless changed by the
+// SORTING_AFFINITY environment variable or set_thread_affinity().
+THREAD_AFFINITY thread_affinity();
+void set_thread_affinity(THREAD_AFFINITY affinity);
+
+// The pool of active_threads() threads with thread_affinity() pinning that parallel
+// sorts, verifiers and loaders share. It is started on first use and replaced on the
+// next call after either setting changes; callers keep the old one alive until done.
+std::shared_ptr<thread_pool> shared_thread_pool();
+
+// Runs job(index) for index in [0, threads), the last one on the calling thread, and
+// returns once all of them have finished. The others are tasks of the pool the calling
+// thread works for, otherwise of the shared pool, so they run on at most its threads.
+template<typename JOB>
+void run_parallel(uint32_t threads, JOB job) {
+    if (threads <= 1) {
+        if (threads == 1) job(0);
+        return;
+    }
+
+    if (thread_pool *pool = thread_pool::current()) {
+        pool->run(threads, job);
+        return;
+    }
+    shared_thread_pool()->run(threads, job);
+}
+
+#endif //SORTING_ALGORITHMS_PARALLEL_H
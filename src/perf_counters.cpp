@@ -0,0 +1,121 @@
+#include "perf_counters.h"
+
+const char *PERF_EVENT_NAMES[] = {
+        "cycles",
+        "instructions",
+        "branch-misses",
+        "L1d-misses",
+        "LLC-misses",
+        "dTLB-misses"
+};
+
+bool perf_results::any() const {
+    for (bool v: valid) if (v) return true;
+    return false;
+}
+
+double perf_results::ipc() const {
+    if (!valid[CYCLES] || !valid[INSTRUCTIONS] || values[CYCLES] == 0) return -1.0;
+    return (double) values[INSTRUCTIONS] / (double) values[CYCLES];
+}
+
+double perf_results::per_element(PERF_EVENT event, uint64_t elements) const {
+    if (!valid[event] || elements == 0) return -1.0;
+    return (double) values[event] / (double) elements;
+}
+
+#ifdef __linux__
+
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static uint64_t cache_event(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static int open_event(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+perf_counters::perf_counters() {
+    descriptors[CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    descriptors[INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    descriptors[BRANCH_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    descriptors[L1D_MISSES] = open_event(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D));
+    descriptors[LLC_MISSES] = open_event(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL));
+    descriptors[DTLB_MISSES] = open_event(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB));
+}
+
+perf_counters::~perf_counters() {
+    for (int descriptor: descriptors) if (descriptor >= 0) close(descriptor);
+}
+
+bool perf_counters::available() const {
+    for (int descriptor: descriptors) if (descriptor >= 0) return true;
+    return false;
+}
+
+void perf_counters::start() {
+    for (int descriptor: descriptors) {
+        if (descriptor < 0) continue;
+        ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+        ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters::stop() {
+    for (int descriptor: descriptors) if (descriptor >= 0) ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+perf_results perf_counters::results() const {
+    perf_results results;
+
+    for (uint32_t e = 0; e < PERF_EVENT_COUNT; ++e) {
+        if (descriptors[e] < 0) continue;
+
+        uint64_t data[3];
+        if (read(descriptors[e], data, sizeof(data)) != (ssize_t) sizeof(data) || data[2] == 0) continue;
+
+        double scale = (double) data[1] / (double) data[2];
+        results.values[e] = (uint64_t) ((double) data[0] * scale);
+        results.valid[e] = true;
+    }
+
+    return results;
+}
+
+#else
+
+perf_counters::perf_counters() {
+    for (int &descriptor: descriptors) descriptor = -1;
+}
+
+perf_counters::~perf_counters() = default;
+
+bool perf_counters::available() const {
+    return false;
+}
+
+void perf_counters::start() {}
+
+void perf_counters::stop() {}
+
+perf_results perf_counters::results() const {
+    return {};
+}
+
+#endif
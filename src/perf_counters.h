@@ -0,0 +1,53 @@
+#ifndef SORTING_ALGORITHMS_PERF_COUNTERS_H
+#define SORTING_ALGORITHMS_PERF_COUNTERS_H
+
+#include <cstdint>
+
+enum PERF_EVENT {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    LLC_MISSES,
+    DTLB_MISSES,
+    PERF_EVENT_COUNT
+};
+
+extern const char *PERF_EVENT_NAMES[];
+
+struct perf_results {
+    uint64_t values[PERF_EVENT_COUNT] = {};
+    bool valid[PERF_EVENT_COUNT] = {};
+
+    bool any() const;
+    double ipc() const;
+
+    // Returns a negative value if the event was not counted.
+    double per_element(PERF_EVENT event, uint64_t elements) const;
+};
+
+// Hardware counters for the calling thread, opened with perf_event_open on Linux.
+// Each event is opened on its own, so whatever the kernel, the CPU or a container's
+// seccomp profile refuses is just missing from the results; on other platforms,
+// or when nothing can be opened, available() is false and results are empty.
+class perf_counters {
+public:
+    perf_counters();
+    ~perf_counters();
+
+    perf_counters(const perf_counters &) = delete;
+    perf_counters &operator=(const perf_counters &) = delete;
+
+    bool available() const;
+
+    void start();
+    void stop();
+
+    // Values are scaled up if the kernel had to multiplex the counters.
+    perf_results results() const;
+
+private:
+    int descriptors[PERF_EVENT_COUNT];
+};
+
+#endif //SORTING_ALGORITHMS_PERF_COUNTERS_H
@@ -0,0 +1,257 @@
+#include "run_controller.h"
+
+#include <utility>
+
+// Upper bound on the time a single frame spends running visual operations.
+static constexpr std::chrono::milliseconds FRAME_BUDGET(8);
+
+run_controller::~run_controller() {
+    stop();
+    join();
+}
+
+PROCESS run_controller::process() const {
+    return current_process.load();
+}
+
+bool run_controller::busy() const {
+    return current_process.load() != PROCESS::NONE || worker.joinable();
+}
+
+bool run_controller::empty() const {
+    return working_arr.empty();
+}
+
+uint32_t run_controller::size() const {
+    return (uint32_t) working_arr.size();
+}
+
+void run_controller::regenerate(uint32_t size, DISTRIBUTION distribution, std::mt19937 &rng) {
+    stop();
+    join();
+
+    working_arr.assign(size, 0);
+    working_colors.assign(size, rgb(255, 255, 255));
+
+    generate_array(working_arr.data(), size, distribution, rng);
+
+    force_publish();
+}
+
+void run_controller::assign(std::vector<uint32_t> values) {
+    stop();
+    join();
+
+    working_arr = std::move(values);
+    working_colors.assign(working_arr.size(), rgb(255, 255, 255));
+
+    force_publish();
+}
+
+bool run_controller::start(PROCESS process, std::function<void(run_controller &)> job) {
+    if (busy() || working_arr.empty()) return false;
+
+    cancel.reset();
+    finished.store(false);
+    run_counters.reset();
+    current_process.store(process);
+
+    worker = std::thread([this, job = std::move(job)]() {
+        job(*this);
+        force_publish();
+        current_process.store(PROCESS::NONE);
+        finished.store(true);
+    });
+
+    return true;
+}
+
+void run_controller::stop() {
+    cancel.request();
+
+    // A cancelled generator returns at its next resume with the array consistent.
+    if (visual.valid()) {
+        while (visual.next()) {}
+        finish_visual();
+    }
+}
+
+bool run_controller::poll_finished() {
+    if (!finished.load()) return false;
+
+    join();
+    finished.store(false);
+    return true;
+}
+
+bool run_controller::start_visual(PROCESS process, sort_generator generator) {
+    if (busy() || working_arr.empty()) return false;
+
+    cancel.reset();
+    run_counters.reset();
+    current_process.store(process);
+
+    visual = std::move(generator);
+    pacing.restart();
+    pause_flag = false;
+    steps_granted = 0;
+    operations_done = 0;
+
+    return true;
+}
+
+void run_controller::advance() {
+    if (!visual.valid()) return;
+
+    uint64_t budget = pause_flag ? steps_granted : pacing.due();
+    auto deadline = std::chrono::steady_clock::now() + FRAME_BUDGET;
+
+    uint64_t performed = 0;
+    bool done = false;
+
+    while (performed < budget) {
+        if (!visual.next()) {
+            done = true;
+            break;
+        }
+
+        apply_event(visual.value());
+        ++performed;
+
+        if (performed % 1024 == 0 && std::chrono::steady_clock::now() > deadline) break;
+    }
+
+    operations_done += performed;
+
+    if (done) {
+        finish_visual();
+    } else if (pause_flag) {
+        steps_granted -= performed;
+        if (performed > 0) force_publish();
+    } else {
+        publish(performed);
+    }
+}
+
+void run_controller::pause() {
+    pause_flag = true;
+}
+
+void run_controller::resume() {
+    pause_flag = false;
+    steps_granted = 0;
+    pacing.restart();
+}
+
+void run_controller::step(uint32_t operations) {
+    pause_flag = true;
+    steps_granted += operations;
+}
+
+bool run_controller::paused() const {
+    return pause_flag;
+}
+
+uint64_t run_controller::operations() const {
+    return operations_done;
+}
+
+operation_counters &run_controller::counters() {
+    return run_counters;
+}
+
+uint32_t *run_controller::data() {
+    return working_arr.data();
+}
+
+rgb *run_controller::colors() {
+    return working_colors.data();
+}
+
+const cancel_token &run_controller::token() const {
+    return cancel;
+}
+
+void run_controller::set_operations_per_second(double operations_per_second) {
+    pacing.set_rate(operations_per_second);
+}
+
+void run_controller::set_publish_policy(PUBLISH_MODE mode, uint32_t value) {
+    publish_mode = mode;
+    publish_value = value > 0 ? value : 1;
+}
+
+const run_controller::snapshot &run_controller::latest_snapshot() {
+    snapshots.update();
+    return snapshots.front();
+}
+
+void run_controller::join() {
+    if (worker.joinable()) worker.join();
+}
+
+void run_controller::publish(uint64_t operations) {
+    operations_since_publish += operations;
+    if (operations_since_publish == 0) return;
+
+    if (publish_mode == PUBLISH_MODE::PUBLISH_EVERY_N_OPERATIONS) {
+        if (operations_since_publish < publish_value) return;
+    } else {
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_publish < std::chrono::nanoseconds(1000000000ull / publish_value)) return;
+    }
+
+    force_publish();
+}
+
+void run_controller::force_publish() {
+    snapshot &back = snapshots.back();
+    back.arr.assign(working_arr.begin(), working_arr.end());
+    back.colors.assign(working_colors.begin(), working_colors.end());
+    snapshots.publish();
+
+    operations_since_publish = 0;
+    last_publish = std::chrono::steady_clock::now();
+}
+
+void run_controller::apply_event(const sort_event &event) {
+    clear_highlights();
+
+    switch (event.type) {
+        case SORT_EVENT::COMPARE:
+            run_counters.compare();
+            run_counters.read(2);
+            working_colors[event.a] = rgb(0, 255, 0);
+            working_colors[event.b] = rgb(255, 0, 0);
+            highlighted[highlighted_count++] = event.a;
+            highlighted[highlighted_count++] = event.b;
+            break;
+        case SORT_EVENT::SWAP:
+            run_counters.swap();
+            run_counters.write(2);
+            working_colors[event.a] = rgb(255, 0, 0);
+            working_colors[event.b] = rgb(0, 255, 0);
+            highlighted[highlighted_count++] = event.a;
+            highlighted[highlighted_count++] = event.b;
+            break;
+        case SORT_EVENT::WRITE:
+            run_counters.write(1);
+            working_colors[event.a] = rgb(255, 0, 0);
+            highlighted[highlighted_count++] = event.a;
+            break;
+    }
+}
+
+void run_controller::clear_highlights() {
+    for (uint32_t h = 0; h < highlighted_count; ++h) working_colors[highlighted[h]] = rgb(255, 255, 255);
+    highlighted_count = 0;
+}
+
+void run_controller::finish_visual() {
+    visual = sort_generator();
+    clear_highlights();
+    pause_flag = false;
+    steps_granted = 0;
+    current_process.store(PROCESS::NONE);
+    force_publish();
+}
@@ -0,0 +1,125 @@
+#ifndef SORTING_ALGORITHMS_RUN_CONTROLLER_H
+#define SORTING_ALGORITHMS_RUN_CONTROLLER_H
+
+#include "array_generators.h"
+#include "cancel_token.h"
+#include "common.h"
+#include "operation_counters.h"
+#include "pacer.h"
+#include "triple_buffer.h"
+#include "visual_algorithms.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Owns the array and color buffers and everything that mutates them: at most one
+// worker thread running a job (fast sorts) or one visual generator driven from the
+// UI thread. The renderer reads a snapshot that is published through a triple
+// buffer, so it never shares memory that is being written.
+class run_controller {
+public:
+    struct snapshot {
+        std::vector<uint32_t> arr;
+        std::vector<rgb> colors;
+    };
+
+    enum PUBLISH_MODE {
+        PUBLISH_RATE,
+        PUBLISH_EVERY_N_OPERATIONS
+    };
+
+    run_controller() = default;
+    ~run_controller();
+
+    run_controller(const run_controller &) = delete;
+    run_controller &operator=(const run_controller &) = delete;
+
+    PROCESS process() const;
+    bool busy() const;
+    bool empty() const;
+    uint32_t size() const;
+
+    // UI thread. Stops and joins a running job before the buffers are reallocated.
+    void regenerate(uint32_t size, DISTRIBUTION distribution, std::mt19937 &rng);
+    // UI thread. Same as regenerate, with the values taken over from a loaded dataset.
+    void assign(std::vector<uint32_t> values);
+
+    // UI thread. Returns false if a job or visual run is still active.
+    bool start(PROCESS process, std::function<void(run_controller &)> job);
+    void stop();
+
+    // UI thread. Joins a worker that has finished; returns true once per completed job.
+    bool poll_finished();
+
+    // UI thread. The generator must have been created over data() with token().
+    bool start_visual(PROCESS process, sort_generator visual);
+
+    // UI thread, once per frame. Runs the operations that came due and publishes.
+    void advance();
+
+    void pause();
+    void resume();
+    void step(uint32_t operations);
+    bool paused() const;
+
+    // Operations performed by the current (or last) visual run.
+    uint64_t operations() const;
+
+    // Counters of the current (or last) run. Reset when a run starts; visual runs
+    // fill them from their events, jobs may pass them to a counted kernel.
+    operation_counters &counters();
+
+    // Worker thread (or UI thread while idle).
+    uint32_t *data();
+    rgb *colors();
+    const cancel_token &token() const;
+
+    void set_operations_per_second(double operations_per_second);
+
+    // UI thread. Either snapshots per second or operations between snapshots.
+    void set_publish_policy(PUBLISH_MODE mode, uint32_t value);
+
+    // Renderer. Returns the latest complete snapshot; valid until the next call.
+    const snapshot &latest_snapshot();
+
+private:
+    void join();
+    void publish(uint64_t operations);
+    void force_publish();
+    void apply_event(const sort_event &event);
+    void clear_highlights();
+    void finish_visual();
+
+    std::vector<uint32_t> working_arr;
+    std::vector<rgb> working_colors;
+
+    // A thread of its own rather than a shared pool task: thread_pool::run blocks its caller
+    // and counts it as one of the pool's threads, so a parallel engine started here still
+    // runs on all active_threads() while the UI thread stays free.
+    std::thread worker;
+    std::atomic<PROCESS> current_process{PROCESS::NONE};
+    cancel_token cancel;
+    std::atomic<bool> finished{false};
+    operation_counters run_counters;
+
+    sort_generator visual;
+    pacer pacing;
+    bool pause_flag = false;
+    uint64_t steps_granted = 0;
+    uint64_t operations_done = 0;
+    uint32_t highlighted[2] = {};
+    uint32_t highlighted_count = 0;
+
+    triple_buffer<snapshot> snapshots;
+
+    PUBLISH_MODE publish_mode = PUBLISH_MODE::PUBLISH_RATE;
+    uint32_t publish_value = 120;
+    uint64_t operations_since_publish = 0;
+    std::chrono::steady_clock::time_point last_publish;
+};
+
+#endif //SORTING_ALGORITHMS_RUN_CONTROLLER_H
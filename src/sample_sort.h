@@ -0,0 +1,419 @@
+#ifndef SORTING_ALGORITHMS_SAMPLE_SORT_H
+#define SORTING_ALGORITHMS_SAMPLE_SORT_H
+
+#include "parallel.h"
+#include "sorting_algorithms.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+// In-place samplesort after IPS4o (Axtmann, Witt, Ferizovic and Sanders). Each level
+// picks splitters from an oversampled random sample, classifies every key with a
+// branchless descent of the splitter tree into up to 256 buckets, and permutes the
+// range into bucket order in blocks, through per-thread buffers of one block per
+// bucket instead of a second array. Threads classify disjoint stripes, then move
+// blocks concurrently; buckets are sorted recursively, buckets too big to balance by
+// every thread together and the rest as one task per bucket. Compared to IPS4o the
+// bucket pointers are guarded by a lock per bucket instead of being updated
+// lock-free, and moving empty blocks and fixing up bucket boundaries run on one thread.
+// Counters are not synchronised, so counted runs must use one thread.
+
+// Ranges up to this size are left to quicksort.
+static constexpr uint32_t SAMPLE_SORT_BASE_CASE = 4096;
+static constexpr uint32_t SAMPLE_SORT_LOG_BUCKETS = 8;
+static constexpr uint32_t SAMPLE_SORT_BUCKETS = 1 << SAMPLE_SORT_LOG_BUCKETS;
+// Smaller ranges are partitioned by one thread.
+static constexpr uint32_t SAMPLE_SORT_PARALLEL_THRESHOLD = 1 << 16;
+// Unit of the block permutation; one buffer block per bucket per thread stays in L2.
+static constexpr uint32_t SAMPLE_SORT_BLOCK_BYTES = 2048;
+// Keys classified per batch, so the tree descents of a batch overlap.
+static constexpr uint32_t SAMPLE_SORT_UNROLL = 8;
+
+template<typename T>
+constexpr uint32_t sample_sort_block() {
+    return sizeof(T) >= SAMPLE_SORT_BLOCK_BYTES ? 1 : SAMPLE_SORT_BLOCK_BYTES / sizeof(T);
+}
+
+template<typename T>
+struct sample_sort_classifier {
+    // Sorted splitters, and the same splitters in breadth-first order at tree[1, buckets).
+    T splitters[SAMPLE_SORT_BUCKETS - 1];
+    T tree[SAMPLE_SORT_BUCKETS];
+    uint32_t log_buckets;
+    uint32_t buckets;
+    // Set when the sample had duplicate splitters: each bucket b but the last is then split
+    // into keys below splitters[b] (class 2b) and keys equal to it (class 2b + 1), and equal
+    // keys need no further sorting.
+    bool equality;
+
+    uint32_t classes() const {
+        return equality ? 2 * buckets : buckets;
+    }
+
+    bool equality_class(uint32_t c) const {
+        return equality && (c & 1);
+    }
+
+    // Bucket b holds the keys in (splitters[b - 1], splitters[b]].
+    template<typename Counters>
+    uint32_t classify(const T &key, Counters &counters) const {
+        uint32_t node = 1;
+        for (uint32_t level = 0; level < log_buckets; ++level) {
+            counters.compare();
+            node = 2 * node + (tree[node] < key);
+        }
+        return finish(node, key, counters);
+    }
+
+    // Classifies keys[0, SAMPLE_SORT_UNROLL) level by level, so the descents overlap
+    // instead of each waiting on its own chain of loads.
+    template<typename Counters>
+    void classify_batch(const T *keys, uint32_t *classes, Counters &counters) const {
+        uint32_t nodes[SAMPLE_SORT_UNROLL];
+        std::fill(nodes, nodes + SAMPLE_SORT_UNROLL, 1);
+
+        for (uint32_t level = 0; level < log_buckets; ++level) {
+            for (uint32_t j = 0; j < SAMPLE_SORT_UNROLL; ++j) {
+                counters.compare();
+                nodes[j] = 2 * nodes[j] + (tree[nodes[j]] < keys[j]);
+            }
+        }
+        for (uint32_t j = 0; j < SAMPLE_SORT_UNROLL; ++j) classes[j] = finish(nodes[j], keys[j], counters);
+    }
+
+private:
+    template<typename Counters>
+    uint32_t finish(uint32_t leaf, const T &key, Counters &counters) const {
+        uint32_t bucket = leaf - buckets;
+        if (!equality) return bucket;
+
+        counters.compare();
+        return 2 * bucket + (bucket < buckets - 1 && !(key < splitters[bucket]));
+    }
+};
+
+// Per-thread scratch, reused by every level that thread partitions.
+template<typename T>
+struct sample_sort_workspace {
+    static constexpr uint32_t BLOCK = sample_sort_block<T>();
+    static constexpr uint64_t BYTES = (2 * SAMPLE_SORT_BUCKETS + 2) * BLOCK * sizeof(T);
+
+    std::unique_ptr<T[]> buffers{new T[2 * SAMPLE_SORT_BUCKETS * BLOCK]};
+    std::unique_ptr<T[]> swap{new T[2 * BLOCK]};
+    uint32_t fill[2 * SAMPLE_SORT_BUCKETS];
+    uint32_t counts[2 * SAMPLE_SORT_BUCKETS];
+    // This thread's stripe; [begin, write) holds its flushed full blocks.
+    uint32_t begin, end, write;
+};
+
+template<typename T, typename Counters>
+void build_sample_sort_classifier(const T *arr, uint32_t size, sample_sort_classifier<T> &classifier,
+                                  const cancel_token &token, Counters &counters) {
+    uint32_t log_buckets = std::clamp<uint32_t>(std::bit_width(size / 64) - 1, 1, SAMPLE_SORT_LOG_BUCKETS);
+    uint32_t buckets = 1 << log_buckets;
+    uint32_t oversampling = std::max<uint32_t>(1, (uint32_t) (0.2 * std::log2((double) size)));
+
+    uint32_t sample_size = oversampling * buckets - 1;
+    std::vector<T> sample(sample_size);
+    std::mt19937 rng(size);
+    for (T &key: sample) key = arr[rng() % size];
+    counters.read(sample_size);
+    counters.allocate((uint64_t) sample_size * sizeof(T));
+
+    quick_sort_algorithm(sample.data(), sample_size, quick_sort_depth_limit(sample_size), token, counters);
+
+    uint32_t unique = 0;
+    classifier.equality = false;
+    for (uint32_t s = 1; s < buckets; ++s) {
+        const T &candidate = sample[s * oversampling - 1];
+        counters.compare();
+        if (unique == 0 || classifier.splitters[unique - 1] < candidate) {
+            classifier.splitters[unique++] = candidate;
+        } else {
+            classifier.equality = true;
+        }
+    }
+    counters.release((uint64_t) sample_size * sizeof(T));
+
+    // Fewest buckets that fit the distinct splitters, padded with copies of the largest.
+    classifier.log_buckets = std::bit_width(unique);
+    classifier.buckets = 1 << classifier.log_buckets;
+    for (uint32_t s = unique; s + 1 < classifier.buckets; ++s) classifier.splitters[s] = classifier.splitters[unique - 1];
+
+    for (uint32_t depth = 0; depth < classifier.log_buckets; ++depth) {
+        uint32_t stride = 1 << (classifier.log_buckets - depth);
+        for (uint32_t i = 0; i < 1u << depth; ++i) {
+            classifier.tree[(1 << depth) + i] = classifier.splitters[(2 * i + 1) * stride / 2 - 1];
+        }
+    }
+}
+
+// Reorders arr into the classifier's classes and stores where each one starts in
+// starts[0, classes], with starts[classes] == size.
+template<typename T, typename Counters>
+void sample_sort_partition(T *arr, uint32_t size, const sample_sort_classifier<T> &classifier,
+                           sample_sort_workspace<T> *workspaces, uint32_t threads, uint32_t *starts,
+                           Counters &counters) {
+    constexpr uint32_t BLOCK = sample_sort_block<T>();
+    uint32_t classes = classifier.classes();
+    uint32_t blocks = size / BLOCK;
+    threads = std::max<uint32_t>(1, std::min(threads, blocks));
+    uint64_t stripe = (uint64_t) (blocks / threads) * BLOCK;
+
+    // Local classification: every thread streams its stripe into one buffer block per
+    // class and flushes each full buffer to the front of the stripe, behind the reads.
+    run_parallel(threads, [&](uint32_t t) {
+        sample_sort_workspace<T> &local = workspaces[t];
+        local.begin = (uint32_t) (t * stripe);
+        local.end = t + 1 == threads ? size : (uint32_t) ((t + 1) * stripe);
+        local.write = local.begin;
+        std::fill(local.fill, local.fill + classes, 0);
+        std::fill(local.counts, local.counts + classes, 0);
+
+        auto push = [&](uint32_t c, const T &key) {
+            T *buffer = local.buffers.get() + (uint64_t) c * BLOCK;
+            if (local.fill[c] == BLOCK) {
+                std::copy(buffer, buffer + BLOCK, arr + local.write);
+                counters.write(BLOCK);
+                local.write += BLOCK;
+                local.fill[c] = 0;
+            }
+            buffer[local.fill[c]++] = key;
+            ++local.counts[c];
+        };
+
+        uint32_t i = local.begin;
+        for (; i + SAMPLE_SORT_UNROLL <= local.end; i += SAMPLE_SORT_UNROLL) {
+            uint32_t batch[SAMPLE_SORT_UNROLL];
+            classifier.classify_batch(arr + i, batch, counters);
+            for (uint32_t j = 0; j < SAMPLE_SORT_UNROLL; ++j) push(batch[j], arr[i + j]);
+        }
+        for (; i < local.end; ++i) push(classifier.classify(arr[i], counters), arr[i]);
+        counters.read(local.end - local.begin);
+    });
+
+    uint32_t sum = 0;
+    for (uint32_t c = 0; c < classes; ++c) {
+        starts[c] = sum;
+        for (uint32_t t = 0; t < threads; ++t) sum += workspaces[t].counts[c];
+    }
+    starts[classes] = size;
+
+    // Class c receives its full blocks in the block-aligned region [aligned(starts[c]),
+    // aligned(starts[c + 1])). Within each region, unprocessed blocks are first moved in
+    // front of the empty ones, so [write_slot[c], read_slot[c]) are the blocks still to
+    // be placed and everything from read_slot[c] on is free.
+    auto aligned = [](uint64_t position) {
+        return (position + BLOCK - 1) / BLOCK * BLOCK;
+    };
+    auto full = [&](uint64_t slot) {
+        uint32_t t = (uint32_t) std::min<uint64_t>(slot / stripe, threads - 1);
+        return slot < workspaces[t].write;
+    };
+
+    uint64_t write_slot[2 * SAMPLE_SORT_BUCKETS], read_slot[2 * SAMPLE_SORT_BUCKETS];
+    for (uint32_t c = 0; c < classes; ++c) {
+        uint64_t lo = aligned(starts[c]);
+        uint64_t hi = std::min(aligned(starts[c + 1]), (uint64_t) blocks * BLOCK);
+        uint64_t empty = lo, filled = std::max(lo, hi);
+
+        while (true) {
+            while (empty < filled && full(empty)) empty += BLOCK;
+            while (filled > empty && !full(filled - BLOCK)) filled -= BLOCK;
+            if (filled <= empty) break;
+
+            filled -= BLOCK;
+            std::copy(arr + filled, arr + filled + BLOCK, arr + empty);
+            counters.read(BLOCK);
+            counters.write(BLOCK);
+            empty += BLOCK;
+        }
+
+        write_slot[c] = lo;
+        read_slot[c] = empty;
+    }
+
+    // Block permutation: threads take unprocessed blocks from the classes in turn, starting
+    // at different ones, and carry each to the next slot of its own class, picking up the
+    // unprocessed block found there, until a block lands in a free slot. Only the slot
+    // straddling the end of the array cannot take a whole block; it goes to overflow.
+    std::unique_ptr<std::mutex[]> locks(new std::mutex[classes]);
+    std::unique_ptr<T[]> overflow(new T[BLOCK]);
+    uint32_t overflow_class = classes;
+
+    run_parallel(threads, [&](uint32_t t) {
+        T *carry = workspaces[t].swap.get();
+        T *spare = carry + BLOCK;
+
+        for (uint32_t v = 0; v < classes; ++v) {
+            uint32_t source = (t * classes / threads + v) % classes;
+
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> lock(locks[source]);
+                    if (read_slot[source] <= write_slot[source]) break;
+
+                    read_slot[source] -= BLOCK;
+                    std::copy(arr + read_slot[source], arr + read_slot[source] + BLOCK, carry);
+                }
+                counters.read(BLOCK);
+
+                while (true) {
+                    uint32_t target = classifier.classify(carry[0], counters);
+                    std::lock_guard<std::mutex> lock(locks[target]);
+                    uint64_t slot = write_slot[target];
+                    write_slot[target] += BLOCK;
+                    counters.write(BLOCK);
+
+                    if (slot < read_slot[target]) {
+                        std::copy(arr + slot, arr + slot + BLOCK, spare);
+                        std::copy(carry, carry + BLOCK, arr + slot);
+                        counters.read(BLOCK);
+                        std::swap(carry, spare);
+                        continue;
+                    }
+
+                    if (slot + BLOCK > size) {
+                        std::copy(carry, carry + BLOCK, overflow.get());
+                        overflow_class = target;
+                    } else {
+                        std::copy(carry, carry + BLOCK, arr + slot);
+                    }
+                    break;
+                }
+            }
+        }
+    });
+
+    // Cleanup: a class's blocks start up to a block after its first position and may run
+    // up to a block past its last, into the next class. Class by class, the keys past its
+    // end, in the overflow block and left in the thread buffers fill the gaps at its head
+    // and tail; the next class's head is only overwritten after that.
+    for (uint32_t c = 0; c < classes; ++c) {
+        uint64_t begin = starts[c], end = starts[c + 1];
+        uint64_t region = aligned(begin);
+        uint64_t written = write_slot[c] - (overflow_class == c ? BLOCK : 0);
+
+        uint64_t hole = begin, head_end = std::min(region, end), tail = std::min(written, end);
+        auto place = [&](const T *from, uint64_t count) {
+            for (uint64_t i = 0; i < count; ++i) {
+                if (hole == head_end) hole = tail;
+                arr[hole++] = from[i];
+            }
+            counters.read(count);
+            counters.write(count);
+        };
+
+        uint64_t spill = std::max(end, region);
+        if (written > spill) place(arr + spill, written - spill);
+        if (overflow_class == c) place(overflow.get(), BLOCK);
+        for (uint32_t t = 0; t < threads; ++t) {
+            place(workspaces[t].buffers.get() + (uint64_t) c * BLOCK, workspaces[t].fill[c]);
+        }
+    }
+}
+
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "misc-no-recursion"
+
+template<typename T, typename Counters>
+void sample_sort_sequential(T *arr, uint32_t size, sample_sort_workspace<T> &workspace, const cancel_token &token,
+                            Counters &counters) {
+    if (token.requested()) return;
+    if (size <= SAMPLE_SORT_BASE_CASE) {
+        if (size > 1) quick_sort_algorithm(arr, size, quick_sort_depth_limit(size), token, counters);
+        return;
+    }
+    counters.enter();
+
+    sample_sort_classifier<T> classifier;
+    uint32_t starts[2 * SAMPLE_SORT_BUCKETS + 1];
+    build_sample_sort_classifier(arr, size, classifier, token, counters);
+    sample_sort_partition(arr, size, classifier, &workspace, 1, starts, counters);
+
+    for (uint32_t c = 0; c < classifier.classes(); ++c) {
+        uint32_t length = starts[c + 1] - starts[c];
+        if (classifier.equality_class(c)) continue;
+
+        // Cannot happen with distinct splitters, but must not recurse forever if it did.
+        if (length == size) {
+            quick_sort_algorithm(arr, size, quick_sort_depth_limit(size), token, counters);
+        } else {
+            sample_sort_sequential(arr + starts[c], length, workspace, token, counters);
+        }
+    }
+
+    counters.leave();
+}
+
+template<typename T, typename Counters>
+void sample_sort_parallel(T *arr, uint32_t size, uint32_t threads, sample_sort_workspace<T> *workspaces,
+                          const cancel_token &token, Counters &counters) {
+    if (threads == 1 || size < SAMPLE_SORT_PARALLEL_THRESHOLD) {
+        sample_sort_sequential(arr, size, workspaces[0], token, counters);
+        return;
+    }
+    if (token.requested()) return;
+    counters.enter();
+
+    sample_sort_classifier<T> classifier;
+    uint32_t starts[2 * SAMPLE_SORT_BUCKETS + 1];
+    build_sample_sort_classifier(arr, size, classifier, token, counters);
+    sample_sort_partition(arr, size, classifier, workspaces, threads, starts, counters);
+
+    // Buckets bigger than a thread's share are partitioned by all threads, one after the
+    // other. The rest are tasks that idle threads claim largest first.
+    std::vector<std::pair<uint32_t, uint32_t>> tasks;
+    for (uint32_t c = 0; c < classifier.classes(); ++c) {
+        uint32_t length = starts[c + 1] - starts[c];
+        if (classifier.equality_class(c) || length < 2) continue;
+
+        if (length == size) {
+            quick_sort_algorithm(arr, size, quick_sort_depth_limit(size), token, counters);
+        } else if (length > size / threads) {
+            sample_sort_parallel(arr + starts[c], length, threads, workspaces, token, counters);
+        } else {
+            tasks.emplace_back(starts[c], length);
+        }
+    }
+    std::sort(tasks.begin(), tasks.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+
+    std::atomic<uint32_t> next(0);
+    run_parallel(threads, [&](uint32_t t) {
+        for (uint32_t task = next++; task < tasks.size(); task = next++) {
+            sample_sort_sequential(arr + tasks[task].first, tasks[task].second, workspaces[t], token, counters);
+        }
+    });
+
+    counters.leave();
+}
+
+#pragma clang diagnostic pop
+
+// Sorts with up to `threads` threads. Cancellation is checked before each bucket; the
+// array stays a permutation of its input either way.
+template<typename T, typename Counters>
+void sample_sort_algorithm(T *arr, uint32_t size, uint32_t threads, const cancel_token &token, Counters &counters) {
+    if (size <= SAMPLE_SORT_BASE_CASE) {
+        if (size > 1) quick_sort_algorithm(arr, size, quick_sort_depth_limit(size), token, counters);
+        return;
+    }
+
+    threads = std::max<uint32_t>(1, std::min(threads, size / SAMPLE_SORT_BASE_CASE));
+    std::unique_ptr<sample_sort_workspace<T>[]> workspaces(new sample_sort_workspace<T>[threads]);
+    counters.allocate(threads * sample_sort_workspace<T>::BYTES);
+
+    sample_sort_parallel(arr, size, threads, workspaces.get(), token, counters);
+
+    counters.release(threads * sample_sort_workspace<T>::BYTES);
+}
+
+#endif //SORTING_ALGORITHMS_SAMPLE_SORT_H
@@ -0,0 +1,101 @@
+#include "segmented_sort.h"
+
+#include "operation_counters.h"
+#include "parallel.h"
+#include "sample_sort.h"
+#include "simd_quicksort.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+const char *SEGMENT_DISTRIBUTION_IDS[] = {"tiny", "small", "mixed", "skewed"};
+
+bool parse_segment_distribution(const char *id, SEGMENT_DISTRIBUTION &distribution) {
+    for (uint32_t d = 0; d < SEGMENT_DISTRIBUTION_COUNT; ++d) {
+        if (strcmp(id, SEGMENT_DISTRIBUTION_IDS[d]) == 0) {
+            distribution = (SEGMENT_DISTRIBUTION) d;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<uint32_t> generate_segment_offsets(uint32_t size, SEGMENT_DISTRIBUTION distribution, std::mt19937 &rng) {
+    std::uniform_int_distribution<uint32_t> tiny(2, 16), small(8, 1000), short_run(1, 32), long_run(1000, 100000);
+    std::uniform_int_distribution<uint32_t> percent(0, 99);
+    std::uniform_real_distribution<double> log_length(0, std::log2(1000.0));
+
+    std::vector<uint32_t> offsets{0};
+    for (uint32_t position = 0; position < size;) {
+        uint32_t length;
+        switch (distribution) {
+            case SEGMENTS_TINY:
+                length = tiny(rng);
+                break;
+            case SEGMENTS_SMALL:
+                length = small(rng);
+                break;
+            case SEGMENTS_MIXED:
+                length = (uint32_t) std::exp2(log_length(rng));
+                break;
+            default:
+                length = percent(rng) == 0 ? long_run(rng) : short_run(rng);
+                break;
+        }
+
+        position += std::min(length, size - position);
+        offsets.push_back(position);
+    }
+    return offsets;
+}
+
+// End of the task starting at segment `first`: the first segment boundary at least
+// SEGMENTED_TASK_KEYS keys on, or the last segment.
+static uint32_t task_end(const uint32_t *offsets, uint32_t first, uint32_t segments) {
+    uint64_t target = (uint64_t) offsets[first] + SEGMENTED_TASK_KEYS;
+    return (uint32_t) (std::lower_bound(offsets + first + 1, offsets + segments, target) - offsets);
+}
+
+void segmented_sort(uint32_t *keys, const uint32_t *offsets, uint32_t segments, const cancel_token &token) {
+    if (segments == 0) return;
+
+    uint32_t size = offsets[segments] - offsets[0];
+    uint32_t threads = size < SEGMENTED_PARALLEL_THRESHOLD ? 1 : active_threads();
+
+    if (threads == 1) {
+        for (uint32_t first = 0, last; first < segments && !token.requested(); first = last) {
+            last = task_end(offsets, first, segments);
+            simd_sort_segments(keys, offsets, first, last, token);
+        }
+        return;
+    }
+
+    // A task that is a single segment longer than a thread's share would leave the
+    // other threads idle, so such segments are sorted by all of them instead.
+    std::vector<std::pair<uint32_t, uint32_t>> tasks;
+    std::vector<uint32_t> large;
+    for (uint32_t first = 0, last; first < segments; first = last) {
+        last = task_end(offsets, first, segments);
+        if (last == first + 1 && offsets[last] - offsets[first] > size / threads) {
+            large.push_back(first);
+        } else {
+            tasks.emplace_back(first, last);
+        }
+    }
+
+    no_counters counters;
+    for (uint32_t s: large) {
+        if (token.requested()) return;
+        sample_sort_algorithm(keys + offsets[s], offsets[s + 1] - offsets[s], threads, token, counters);
+    }
+
+    std::atomic<uint32_t> next(0);
+    run_parallel(threads, [&](uint32_t) {
+        for (uint32_t task = next++; task < tasks.size() && !token.requested(); task = next++) {
+            simd_sort_segments(keys, offsets, tasks[task].first, tasks[task].second, token);
+        }
+    });
+}
@@ -0,0 +1,48 @@
+#ifndef SORTING_ALGORITHMS_SEGMENTED_SORT_H
+#define SORTING_ALGORITHMS_SEGMENTED_SORT_H
+
+#include "cancel_token.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Batched sorting of many independent arrays laid out back to back in one buffer.
+// Segment s is keys[offsets[s], offsets[s + 1]); offsets holds segments + 1
+// non-decreasing positions.
+
+// Below this many keys in total, segmented_sort stays on the calling thread.
+static constexpr uint32_t SEGMENTED_PARALLEL_THRESHOLD = 1 << 17;
+// Runs of consecutive segments are handed to the pool in tasks of about this many keys.
+static constexpr uint32_t SEGMENTED_TASK_KEYS = 1 << 16;
+
+// Sorts every segment in place with simd_sort_segments, which picks a bitonic sorting
+// network, insertion sort or quicksort by length without a dispatch per segment. On the
+// shared thread pool, segments longer than one thread's share of the keys are sample
+// sorted by all threads in turn and the rest are split into tasks of consecutive segments.
+// Cancellation is checked between tasks; every segment stays a permutation of its input.
+void segmented_sort(uint32_t *keys, const uint32_t *offsets, uint32_t segments, const cancel_token &token);
+
+// Segment lengths for benchmarks and tests:
+//   SEGMENTS_TINY    2 to 16 keys
+//   SEGMENTS_SMALL   8 to 1000 keys
+//   SEGMENTS_MIXED   1 to 1000 keys, log-uniform, so most are short
+//   SEGMENTS_SKEWED  1 to 32 keys, except one in a hundred with 1000 to 100000
+enum SEGMENT_DISTRIBUTION {
+    SEGMENTS_TINY,
+    SEGMENTS_SMALL,
+    SEGMENTS_MIXED,
+    SEGMENTS_SKEWED,
+    SEGMENT_DISTRIBUTION_COUNT
+};
+
+extern const char *SEGMENT_DISTRIBUTION_IDS[];
+
+// Returns false if the id is unknown.
+bool parse_segment_distribution(const char *id, SEGMENT_DISTRIBUTION &distribution);
+
+// Cuts [0, size) into segments drawn from the distribution; the last one is truncated
+// to end at size. Returns the offsets, from 0 to size.
+std::vector<uint32_t> generate_segment_offsets(uint32_t size, SEGMENT_DISTRIBUTION distribution, std::mt19937 &rng);
+
+#endif //SORTING_ALGORITHMS_SEGMENTED_SORT_H
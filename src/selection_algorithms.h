@@ -0,0 +1,250 @@
+#ifndef SORTING_ALGORITHMS_SELECTION_ALGORITHMS_H
+#define SORTING_ALGORITHMS_SELECTION_ALGORITHMS_H
+
+#include "sorting_algorithms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Partial sorts on the kernels and counter policies of sorting_algorithms.h.
+// nth_element kernels leave the key of rank k at arr[k], nothing larger before it and
+// nothing smaller after it, and do nothing if k >= size. Top-k kernels leave the k
+// smallest keys in ascending order in arr[0, k) and clamp k to size. Both keep the
+// array a permutation of its input, also when cancelled.
+
+// Floyd-Rivest picks its pivot from a sample once a range is longer than this.
+static constexpr uint32_t FLOYD_RIVEST_SAMPLE_LIMIT = 600;
+
+// Leaves the k smallest keys in arr[0, k) as a max-heap; O(n log k).
+template<typename T, typename Counters>
+void heap_select(T *arr, uint32_t size, uint32_t k, const cancel_token &token, Counters &counters) {
+    for (uint32_t i = k / 2; i-- > 0;) {
+        if (i % cancel_token::CANCEL_POLL_INTERVAL == 0 && token.requested()) return;
+        sift_down(arr, i, k, counters);
+    }
+
+    for (uint32_t i = k; i < size; ++i) {
+        if (i % cancel_token::CANCEL_POLL_INTERVAL == 0 && token.requested()) return;
+
+        counters.compare();
+        counters.read(2);
+        if (arr[i] < arr[0]) {
+            counters.swap();
+            counters.write(2);
+            std::swap(arr[0], arr[i]);
+            sift_down(arr, 0, k, counters);
+        }
+    }
+}
+
+// nth_element by heap_select of the k + 1 smallest keys, whose maximum is the answer.
+template<typename T, typename Counters>
+void heap_nth_element(T *arr, uint32_t size, uint32_t k, const cancel_token &token, Counters &counters) {
+    heap_select(arr, size, k + 1, token, counters);
+
+    counters.swap();
+    counters.read(2);
+    counters.write(2);
+    std::swap(arr[0], arr[k]);
+}
+
+// Quickselect on quick_partition that falls back to heap_nth_element past the same
+// depth limit as quicksort, so adversarial inputs stay O(n log n).
+template<typename T, typename Counters>
+void introselect_algorithm(T *arr, uint32_t size, uint32_t k, const cancel_token &token, Counters &counters) {
+    if (k >= size) return;
+
+    uint32_t depth_limit = quick_sort_depth_limit(size);
+    counters.enter();
+
+    while (size > QUICK_SORT_CUTOFF && !token.requested()) {
+        if (depth_limit == 0) {
+            heap_nth_element(arr, size, k, token, counters);
+            counters.leave();
+            return;
+        }
+        --depth_limit;
+
+        uint32_t split = quick_partition(arr, size, token, counters);
+
+        if (k < split) {
+            size = split;
+        } else {
+            arr += split;
+            size -= split;
+            k -= split;
+        }
+    }
+
+    if (!token.requested()) insertion_sort_algorithm(arr, size, counters);
+    counters.leave();
+}
+
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "misc-no-recursion"
+
+// Floyd and Rivest's SELECT on [left, right]. Long ranges first select within a sample
+// placed around k, so the pivot lands close to rank k and each partition discards most
+// of the range: about n + min(k, n - k) comparisons on average.
+template<typename T, typename Counters>
+void floyd_rivest_select(T *arr, int64_t left, int64_t right, int64_t k, uint32_t depth_limit,
+                         const cancel_token &token, Counters &counters) {
+    counters.enter();
+
+    while (right > left && !token.requested()) {
+        if (depth_limit == 0) {
+            heap_nth_element(arr + left, (uint32_t) (right - left + 1), (uint32_t) (k - left), token, counters);
+            break;
+        }
+        --depth_limit;
+
+        if (right - left > FLOYD_RIVEST_SAMPLE_LIMIT) {
+            double n = (double) (right - left + 1);
+            double i = (double) (k - left + 1);
+            double z = std::log(n);
+            double s = 0.5 * std::exp(2 * z / 3);
+            double sd = 0.5 * std::sqrt(z * s * (n - s) / n) * (i < n / 2 ? -1 : 1);
+
+            int64_t sample_left = std::max(left, (int64_t) ((double) k - i * s / n + sd));
+            int64_t sample_right = std::min(right, (int64_t) ((double) k + (n - i) * s / n + sd));
+            floyd_rivest_select(arr, sample_left, sample_right, k, depth_limit, token, counters);
+        }
+
+        // arr[left] and arr[right] end up as sentinels for both scans.
+        T pivot = arr[k];
+        int64_t i = left, j = right;
+
+        counters.read(2);
+        counters.compare();
+        counters.swap();
+        std::swap(arr[left], arr[k]);
+        if (pivot < arr[right]) {
+            counters.swap();
+            std::swap(arr[right], arr[left]);
+        }
+
+        // Polled between swaps, once per CANCEL_POLL_INTERVAL elements scanned; a cancelled
+        // pass still closes the partition with the swaps below.
+        int64_t poll = cancel_token::CANCEL_POLL_INTERVAL;
+        while (i < j) {
+            if ((i - left) + (right - j) >= poll) {
+                if (token.requested()) break;
+                poll += cancel_token::CANCEL_POLL_INTERVAL;
+            }
+
+            counters.swap();
+            counters.write(2);
+            std::swap(arr[i], arr[j]);
+            ++i;
+            --j;
+
+            counters.compare();
+            counters.read(1);
+            while (arr[i] < pivot) {
+                ++i;
+                counters.compare();
+                counters.read(1);
+            }
+
+            counters.compare();
+            counters.read(1);
+            while (pivot < arr[j]) {
+                --j;
+                counters.compare();
+                counters.read(1);
+            }
+        }
+
+        counters.compare();
+        counters.swap();
+        if (!(arr[left] < pivot)) {
+            std::swap(arr[left], arr[j]);
+        } else {
+            ++j;
+            std::swap(arr[j], arr[right]);
+        }
+
+        if (j <= k) left = j + 1;
+        if (k <= j) right = j - 1;
+    }
+
+    counters.leave();
+}
+
+#pragma clang diagnostic pop
+
+template<typename T, typename Counters>
+void floyd_rivest_algorithm(T *arr, uint32_t size, uint32_t k, const cancel_token &token, Counters &counters) {
+    if (k >= size) return;
+    floyd_rivest_select(arr, 0, (int64_t) size - 1, (int64_t) k, quick_sort_depth_limit(size), token, counters);
+}
+
+template<typename T, typename Counters>
+void heap_top_k_algorithm(T *arr, uint32_t size, uint32_t k, const cancel_token &token, Counters &counters) {
+    k = std::min(k, size);
+
+    heap_select(arr, size, k, token, counters);
+    if (!token.requested()) sort_heap(arr, k, token, counters);
+}
+
+// MSD radix select: each level counts one 8-bit digit over [lo, hi), moves keys whose
+// digit is below the one holding rank k to the front of the range and those above it
+// to the back, and narrows to the middle. After the last digit the middle holds only
+// copies of the key of rank k, so arr[0, k) are the k smallest; they are then sorted
+// with the LSD radix kernel.
+template<typename T, typename Counters>
+void radix_select_algorithm(T *arr, uint32_t size, uint32_t k, const cancel_token &token, Counters &counters) {
+    k = std::min(k, size);
+    if (k == 0) return;
+
+    uint32_t lo = 0, hi = size;
+
+    for (uint32_t level = RADIX_PASSES; level-- > 0 && k < hi && hi - lo > 1;) {
+        if (token.requested()) return;
+
+        uint32_t shift = level * RADIX_BITS;
+        uint32_t counts[RADIX_BUCKETS] = {};
+        for (uint32_t i = lo; i < hi;) {
+            if (token.requested()) return;
+
+            uint32_t end = std::min(hi, i + cancel_token::CANCEL_POLL_INTERVAL);
+            counters.read(end - i);
+            for (; i < end; ++i) ++counts[(radix_key(arr[i]) >> shift) & (RADIX_BUCKETS - 1)];
+        }
+
+        uint32_t bucket = 0, below = lo;
+        while (below + counts[bucket] <= k) below += counts[bucket++];
+
+        // Dutch national flag partition by digit: [lo, less) below, [greater, hi) above.
+        uint32_t less = lo, i = lo, greater = hi, poll = cancel_token::CANCEL_POLL_INTERVAL;
+        while (i < greater) {
+            if ((i - lo) + (hi - greater) >= poll) {
+                if (token.requested()) return;
+                poll += cancel_token::CANCEL_POLL_INTERVAL;
+            }
+
+            uint32_t digit = (radix_key(arr[i]) >> shift) & (RADIX_BUCKETS - 1);
+            counters.read(1);
+
+            if (digit < bucket) {
+                counters.swap();
+                counters.write(2);
+                std::swap(arr[less++], arr[i++]);
+            } else if (digit > bucket) {
+                counters.swap();
+                counters.write(2);
+                std::swap(arr[i], arr[--greater]);
+            } else {
+                ++i;
+            }
+        }
+
+        lo = less;
+        hi = greater;
+    }
+
+    radix_sort_algorithm(arr, k, token, counters);
+}
+
+#endif //SORTING_ALGORITHMS_SELECTION_ALGORITHMS_H
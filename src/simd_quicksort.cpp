@@ -0,0 +1,544 @@
+#include "simd_quicksort.h"
+
+#include "cpu_dispatch.h"
+#include "sorting_algorithms.h"
+
+#include <algorithm>
+#include <bit>
+
+#ifdef SORTING_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+static void quick_sort_generic(uint32_t *arr, uint32_t size, const cancel_token &token) {
+    no_counters counters;
+    if (size > 1) quick_sort_algorithm(arr, size, quick_sort_depth_limit(size), token, counters);
+}
+
+// Segments up to this long are insertion sorted directly by the generic kernel, which
+// saves quicksort's partitioning step on them.
+static constexpr uint32_t SEGMENT_INSERTION_LIMIT = 32;
+
+static void sort_segments_generic(uint32_t *keys, const uint32_t *offsets, uint32_t first, uint32_t last,
+                                  const cancel_token &token) {
+    no_counters counters;
+
+    for (uint32_t s = first; s < last; ++s) {
+        uint32_t *arr = keys + offsets[s];
+        uint32_t size = offsets[s + 1] - offsets[s];
+
+        if (size <= 1) continue;
+        if (size <= SEGMENT_INSERTION_LIMIT) {
+            insertion_sort_algorithm(arr, size, counters);
+        } else {
+            quick_sort_algorithm(arr, size, quick_sort_depth_limit(size), token, counters);
+        }
+    }
+}
+
+#ifdef SORTING_X86_DISPATCH
+
+static inline uint32_t median_of_three(uint32_t a, uint32_t b, uint32_t c) {
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+// Ninther of nine evenly spaced keys; size must be at least 9.
+static uint32_t choose_pivot(const uint32_t *arr, uint32_t size) {
+    uint32_t step = size / 9;
+
+    return median_of_three(
+            median_of_three(arr[0], arr[step], arr[2 * step]),
+            median_of_three(arr[3 * step], arr[4 * step], arr[5 * step]),
+            median_of_three(arr[6 * step], arr[7 * step], arr[8 * step])
+    );
+}
+
+// Moves size % LANES keys to their side one at a time, leaving [left, right) a whole
+// number of vectors with the keys below the pivot before it and the rest after it.
+template<uint32_t LANES>
+static inline void partition_remainder(uint32_t *arr, uint32_t size, uint32_t pivot, uint32_t &left, uint32_t &right) {
+    left = 0;
+    right = size;
+
+    for (uint32_t i = size % LANES; i > 0; --i) {
+        if (arr[left] < pivot) {
+            ++left;
+        } else {
+            std::swap(arr[left], arr[--right]);
+        }
+    }
+}
+
+// Quicksort over one instruction set's kernels. PARTITION(arr, size, pivot) moves the
+// keys below the pivot to the front and returns their count; SMALL_SORT sorts ranges of
+// up to SMALL_SORT_LIMIT keys.
+template<uint32_t SMALL_SORT_LIMIT, uint32_t (*PARTITION)(uint32_t *, uint32_t, uint32_t), void (*SMALL_SORT)(uint32_t *, uint32_t)>
+static void vector_quick_sort(uint32_t *arr, uint32_t size, uint32_t depth_limit, const cancel_token &token) {
+    while (size > SMALL_SORT_LIMIT) {
+        if (token.requested()) return;
+
+        if (depth_limit == 0) {
+            no_counters counters;
+            heap_sort_algorithm(arr, size, token, counters);
+            return;
+        }
+        --depth_limit;
+
+        uint32_t pivot = choose_pivot(arr, size);
+        uint32_t split = PARTITION(arr, size, pivot);
+
+        if (split == 0) {
+            // The pivot is the smallest key, so its copies are final once they are in front.
+            // Splitting them off always makes progress, even when most keys are equal.
+            if (pivot == UINT32_MAX) return;
+
+            split = PARTITION(arr, size, pivot + 1);
+            arr += split;
+            size -= split;
+            continue;
+        }
+
+        if (split < size - split) {
+            vector_quick_sort<SMALL_SORT_LIMIT, PARTITION, SMALL_SORT>(arr, split, depth_limit, token);
+            arr += split;
+            size -= split;
+        } else {
+            vector_quick_sort<SMALL_SORT_LIMIT, PARTITION, SMALL_SORT>(arr + split, size - split, depth_limit, token);
+            size = split;
+        }
+    }
+
+    if (!token.requested()) SMALL_SORT(arr, size);
+}
+
+// Bitonic networks: in the step with block size k and distance j, lane i is paired with
+// lane i ^ j and keeps the larger key where this mask is set.
+static constexpr uint32_t bitonic_max_mask(uint32_t lanes, uint32_t k, uint32_t j) {
+    uint32_t mask = 0;
+
+    for (uint32_t i = 0; i < lanes; ++i) {
+        bool upper = (i & j) != 0;
+        bool descending = (i & k) != 0;
+        if (upper != descending) mask |= 1u << i;
+    }
+    return mask;
+}
+
+// ---------------- AVX2 ----------------
+
+struct partition_table {
+    uint32_t orders[256];
+
+    constexpr partition_table() : orders() {
+        for (uint32_t mask = 0; mask < 256; ++mask) {
+            uint32_t order = 0, slot = 0;
+
+            for (uint32_t lane = 0; lane < 8; ++lane) {
+                if (mask >> lane & 1) order |= lane << (4 * slot++);
+            }
+            for (uint32_t lane = 0; lane < 8; ++lane) {
+                if (!(mask >> lane & 1)) order |= lane << (4 * slot++);
+            }
+            orders[mask] = order;
+        }
+    }
+};
+
+// For every mask of lanes below the pivot, the lane order that moves those lanes to the
+// front, as eight 4-bit indices (1 KiB instead of 8 KiB of full index vectors).
+static constexpr partition_table PARTITION_TABLE;
+
+// Writes the whole permuted vector to both ends; only the first lower_count lanes on the
+// left and the last 8 - lower_count on the right are kept, the rest is overwritten later.
+SORTING_TARGET_AVX2 static inline void store_partitioned_8(uint32_t *arr, __m256i keys, __m256i pivot,
+                                                           uint32_t &store_left, uint32_t &store_right) {
+    __m256i upper = _mm256_cmpeq_epi32(_mm256_max_epu32(keys, pivot), keys);
+    uint32_t lower_mask = ~(uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(upper)) & 0xff;
+    uint32_t lower_count = (uint32_t) _mm_popcnt_u32(lower_mask);
+
+    __m256i order = _mm256_srlv_epi32(
+            _mm256_set1_epi32((int) PARTITION_TABLE.orders[lower_mask]),
+            _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28)
+    );
+    keys = _mm256_permutevar8x32_epi32(keys, order);
+
+    _mm256_storeu_si256((__m256i *) (arr + store_left), keys);
+    _mm256_storeu_si256((__m256i *) (arr + store_right - 8), keys);
+    store_left += lower_count;
+    store_right -= 8 - lower_count;
+}
+
+// In-place vector partition: one vector from each end is held back, so there are always
+// two vectors of free space to write into, and each step reads from the end with less
+// of it so that neither side's stores reach keys not yet read.
+SORTING_TARGET_AVX2 static uint32_t partition_avx2(uint32_t *arr, uint32_t size, uint32_t pivot) {
+    uint32_t left, right;
+    partition_remainder<8>(arr, size, pivot, left, right);
+    if (left == right) return left;
+
+    const __m256i pivot_vector = _mm256_set1_epi32((int) pivot);
+    uint32_t store_left = left, store_right = right;
+
+    if (right - left == 8) {
+        store_partitioned_8(arr, _mm256_loadu_si256((const __m256i *) (arr + left)), pivot_vector, store_left, store_right);
+        return store_left;
+    }
+
+    __m256i first = _mm256_loadu_si256((const __m256i *) (arr + left));
+    __m256i last = _mm256_loadu_si256((const __m256i *) (arr + right - 8));
+    left += 8;
+    right -= 8;
+
+    while (left < right) {
+        __m256i keys;
+        if (left - store_left <= store_right - right) {
+            keys = _mm256_loadu_si256((const __m256i *) (arr + left));
+            left += 8;
+        } else {
+            right -= 8;
+            keys = _mm256_loadu_si256((const __m256i *) (arr + right));
+        }
+        store_partitioned_8(arr, keys, pivot_vector, store_left, store_right);
+    }
+
+    store_partitioned_8(arr, first, pivot_vector, store_left, store_right);
+    store_partitioned_8(arr, last, pivot_vector, store_left, store_right);
+    return store_left;
+}
+
+// Pairs at distance 1, 2 and 4 are swapped with immediate shuffles rather than a
+// variable permute, and the mask is a compile-time blend.
+template<uint32_t K, uint32_t J>
+SORTING_TARGET_AVX2 static inline __m256i exchange_8(__m256i keys) {
+    constexpr int TAKE_MAX = (int) bitonic_max_mask(8, K, J);
+
+    __m256i partner;
+    if constexpr (J == 1) {
+        partner = _mm256_shuffle_epi32(keys, 0xb1);
+    } else if constexpr (J == 2) {
+        partner = _mm256_shuffle_epi32(keys, 0x4e);
+    } else {
+        partner = _mm256_permute2x128_si256(keys, keys, 0x01);
+    }
+    return _mm256_blend_epi32(_mm256_min_epu32(keys, partner), _mm256_max_epu32(keys, partner), TAKE_MAX);
+}
+
+// Steps J, J / 2, ..., 1 of the stage with block size K.
+template<uint32_t K, uint32_t J>
+SORTING_TARGET_AVX2 static inline __m256i bitonic_stage_8(__m256i keys) {
+    keys = exchange_8<K, J>(keys);
+    if constexpr (J > 1) keys = bitonic_stage_8<K, J / 2>(keys);
+    return keys;
+}
+
+SORTING_TARGET_AVX2 static inline __m256i bitonic_sort_8(__m256i keys) {
+    keys = bitonic_stage_8<2, 1>(keys);
+    keys = bitonic_stage_8<4, 2>(keys);
+    return bitonic_stage_8<8, 4>(keys);
+}
+
+SORTING_TARGET_AVX2 static inline __m256i bitonic_merge_8(__m256i keys) {
+    return bitonic_stage_8<8, 4>(keys);
+}
+
+SORTING_TARGET_AVX2 static inline __m256i reverse_8(__m256i keys) {
+    return _mm256_permutevar8x32_epi32(keys, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+// Sorts REGISTERS vectors as one sequence: each vector is sorted on its own, then groups
+// are merged pairwise. Against the reversed upper group one min/max layer leaves two
+// bitonic groups with every key of the lower one no larger than any of the upper one;
+// each is then merged across vectors and finally within them.
+template<uint32_t REGISTERS>
+SORTING_TARGET_AVX2 static inline void bitonic_sort_registers_8(__m256i *keys) {
+    for (uint32_t r = 0; r < REGISTERS; ++r) keys[r] = bitonic_sort_8(keys[r]);
+
+#pragma GCC unroll 8
+    for (uint32_t width = 1; width < REGISTERS; width *= 2) {
+        for (uint32_t group = 0; group < REGISTERS; group += 2 * width) {
+            __m256i *low = keys + group, *high = keys + group + width;
+
+            __m256i reversed[REGISTERS];
+            for (uint32_t i = 0; i < width; ++i) reversed[i] = reverse_8(high[width - 1 - i]);
+            for (uint32_t i = 0; i < width; ++i) {
+                high[i] = _mm256_max_epu32(low[i], reversed[i]);
+                low[i] = _mm256_min_epu32(low[i], reversed[i]);
+            }
+
+            for (__m256i *half: {low, high}) {
+                for (uint32_t distance = width / 2; distance > 0; distance /= 2) {
+                    for (uint32_t i = 0; i < width; ++i) {
+                        if (i & distance) continue;
+
+                        __m256i a = half[i], b = half[i + distance];
+                        half[i] = _mm256_min_epu32(a, b);
+                        half[i + distance] = _mm256_max_epu32(a, b);
+                    }
+                }
+                for (uint32_t i = 0; i < width; ++i) half[i] = bitonic_merge_8(half[i]);
+            }
+        }
+    }
+}
+
+// Up to 64 keys in one, two, four or eight vectors; missing lanes are padded with
+// UINT32_MAX, which sorts to the end.
+SORTING_TARGET_AVX2 static void small_sort_avx2(uint32_t *arr, uint32_t size) {
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i fill = _mm256_set1_epi32(-1);
+
+    uint32_t registers = std::bit_ceil((size + 7) / 8);
+    __m256i keys[8], masks[8];
+
+    for (uint32_t r = 0; r < registers; ++r) {
+        masks[r] = _mm256_cmpgt_epi32(_mm256_set1_epi32((int) size - (int) (8 * r)), lanes);
+        keys[r] = _mm256_blendv_epi8(fill, _mm256_maskload_epi32((const int *) (arr + 8 * r), masks[r]), masks[r]);
+    }
+
+    switch (registers) {
+        case 0:
+            return;
+        case 1:
+            bitonic_sort_registers_8<1>(keys);
+            break;
+        case 2:
+            bitonic_sort_registers_8<2>(keys);
+            break;
+        case 4:
+            bitonic_sort_registers_8<4>(keys);
+            break;
+        default:
+            bitonic_sort_registers_8<8>(keys);
+    }
+
+    for (uint32_t r = 0; r < registers; ++r) _mm256_maskstore_epi32((int *) (arr + 8 * r), masks[r], keys[r]);
+}
+
+static void quick_sort_avx2(uint32_t *arr, uint32_t size, const cancel_token &token) {
+    vector_quick_sort<64, partition_avx2, small_sort_avx2>(arr, size, quick_sort_depth_limit(size), token);
+}
+
+SORTING_TARGET_AVX2 static void sort_segments_avx2(uint32_t *keys, const uint32_t *offsets, uint32_t first,
+                                                   uint32_t last, const cancel_token &token) {
+    for (uint32_t s = first; s < last; ++s) {
+        uint32_t *arr = keys + offsets[s];
+        uint32_t size = offsets[s + 1] - offsets[s];
+
+        if (size <= 1) continue;
+        if (size <= 64) {
+            small_sort_avx2(arr, size);
+        } else {
+            vector_quick_sort<64, partition_avx2, small_sort_avx2>(arr, size, quick_sort_depth_limit(size), token);
+        }
+    }
+}
+
+// ---------------- AVX-512 ----------------
+
+// GCC 12's AVX-512 headers start unmasked intrinsics from _mm512_undefined_epi32(), which
+// -Wall reports at every call site inlined into these kernels.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ == 12
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// vpcompressd writes exactly the selected lanes, so no key outside the free space is touched.
+SORTING_TARGET_AVX512 static inline void store_partitioned_16(uint32_t *arr, __m512i keys, __m512i pivot,
+                                                              uint32_t &store_left, uint32_t &store_right) {
+    __mmask16 upper = _mm512_cmpge_epu32_mask(keys, pivot);
+    uint32_t upper_count = (uint32_t) _mm_popcnt_u32(upper);
+
+    _mm512_mask_compressstoreu_epi32(arr + store_left, (__mmask16) ~upper, keys);
+    store_left += 16 - upper_count;
+    store_right -= upper_count;
+    _mm512_mask_compressstoreu_epi32(arr + store_right, upper, keys);
+}
+
+// Same scheme as partition_avx2, 16 keys per step.
+SORTING_TARGET_AVX512 static uint32_t partition_avx512(uint32_t *arr, uint32_t size, uint32_t pivot) {
+    uint32_t left, right;
+    partition_remainder<16>(arr, size, pivot, left, right);
+    if (left == right) return left;
+
+    const __m512i pivot_vector = _mm512_set1_epi32((int) pivot);
+    uint32_t store_left = left, store_right = right;
+
+    if (right - left == 16) {
+        store_partitioned_16(arr, _mm512_loadu_si512(arr + left), pivot_vector, store_left, store_right);
+        return store_left;
+    }
+
+    __m512i first = _mm512_loadu_si512(arr + left);
+    __m512i last = _mm512_loadu_si512(arr + right - 16);
+    left += 16;
+    right -= 16;
+
+    while (left < right) {
+        __m512i keys;
+        if (left - store_left <= store_right - right) {
+            keys = _mm512_loadu_si512(arr + left);
+            left += 16;
+        } else {
+            right -= 16;
+            keys = _mm512_loadu_si512(arr + right);
+        }
+        store_partitioned_16(arr, keys, pivot_vector, store_left, store_right);
+    }
+
+    store_partitioned_16(arr, first, pivot_vector, store_left, store_right);
+    store_partitioned_16(arr, last, pivot_vector, store_left, store_right);
+    return store_left;
+}
+
+template<uint32_t K, uint32_t J>
+SORTING_TARGET_AVX512 static inline __m512i exchange_16(__m512i keys) {
+    __m512i partner;
+    if constexpr (J == 1) {
+        partner = _mm512_shuffle_epi32(keys, (_MM_PERM_ENUM) 0xb1);
+    } else if constexpr (J == 2) {
+        partner = _mm512_shuffle_epi32(keys, (_MM_PERM_ENUM) 0x4e);
+    } else if constexpr (J == 4) {
+        partner = _mm512_shuffle_i32x4(keys, keys, 0xb1);
+    } else {
+        partner = _mm512_shuffle_i32x4(keys, keys, 0x4e);
+    }
+    return _mm512_mask_max_epu32(_mm512_min_epu32(keys, partner), (__mmask16) bitonic_max_mask(16, K, J), keys, partner);
+}
+
+template<uint32_t K, uint32_t J>
+SORTING_TARGET_AVX512 static inline __m512i bitonic_stage_16(__m512i keys) {
+    keys = exchange_16<K, J>(keys);
+    if constexpr (J > 1) keys = bitonic_stage_16<K, J / 2>(keys);
+    return keys;
+}
+
+SORTING_TARGET_AVX512 static inline __m512i bitonic_sort_16(__m512i keys) {
+    keys = bitonic_stage_16<2, 1>(keys);
+    keys = bitonic_stage_16<4, 2>(keys);
+    keys = bitonic_stage_16<8, 4>(keys);
+    return bitonic_stage_16<16, 8>(keys);
+}
+
+SORTING_TARGET_AVX512 static inline __m512i bitonic_merge_16(__m512i keys) {
+    return bitonic_stage_16<16, 8>(keys);
+}
+
+SORTING_TARGET_AVX512 static inline __m512i reverse_16(__m512i keys) {
+    return _mm512_permutexvar_epi32(_mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), keys);
+}
+
+// Same merge order as bitonic_sort_registers_8.
+template<uint32_t REGISTERS>
+SORTING_TARGET_AVX512 static inline void bitonic_sort_registers_16(__m512i *keys) {
+    for (uint32_t r = 0; r < REGISTERS; ++r) keys[r] = bitonic_sort_16(keys[r]);
+
+#pragma GCC unroll 8
+    for (uint32_t width = 1; width < REGISTERS; width *= 2) {
+        for (uint32_t group = 0; group < REGISTERS; group += 2 * width) {
+            __m512i *low = keys + group, *high = keys + group + width;
+
+            __m512i reversed[REGISTERS];
+            for (uint32_t i = 0; i < width; ++i) reversed[i] = reverse_16(high[width - 1 - i]);
+            for (uint32_t i = 0; i < width; ++i) {
+                high[i] = _mm512_max_epu32(low[i], reversed[i]);
+                low[i] = _mm512_min_epu32(low[i], reversed[i]);
+            }
+
+            for (__m512i *half: {low, high}) {
+                for (uint32_t distance = width / 2; distance > 0; distance /= 2) {
+                    for (uint32_t i = 0; i < width; ++i) {
+                        if (i & distance) continue;
+
+                        __m512i a = half[i], b = half[i + distance];
+                        half[i] = _mm512_min_epu32(a, b);
+                        half[i + distance] = _mm512_max_epu32(a, b);
+                    }
+                }
+                for (uint32_t i = 0; i < width; ++i) half[i] = bitonic_merge_16(half[i]);
+            }
+        }
+    }
+}
+
+// Up to 128 keys, padded like small_sort_avx2.
+SORTING_TARGET_AVX512 static void small_sort_avx512(uint32_t *arr, uint32_t size) {
+    const __m512i fill = _mm512_set1_epi32(-1);
+
+    uint32_t registers = std::bit_ceil((size + 15) / 16);
+    __m512i keys[8];
+    __mmask16 masks[8];
+
+    for (uint32_t r = 0; r < registers; ++r) {
+        uint32_t remaining = size > 16 * r ? size - 16 * r : 0;
+        masks[r] = (__mmask16) (remaining >= 16 ? 0xffff : (1u << remaining) - 1);
+        keys[r] = _mm512_mask_loadu_epi32(fill, masks[r], arr + 16 * r);
+    }
+
+    switch (registers) {
+        case 0:
+            return;
+        case 1:
+            bitonic_sort_registers_16<1>(keys);
+            break;
+        case 2:
+            bitonic_sort_registers_16<2>(keys);
+            break;
+        case 4:
+            bitonic_sort_registers_16<4>(keys);
+            break;
+        default:
+            bitonic_sort_registers_16<8>(keys);
+    }
+
+    for (uint32_t r = 0; r < registers; ++r) _mm512_mask_storeu_epi32(arr + 16 * r, masks[r], keys[r]);
+}
+
+static void quick_sort_avx512(uint32_t *arr, uint32_t size, const cancel_token &token) {
+    vector_quick_sort<128, partition_avx512, small_sort_avx512>(arr, size, quick_sort_depth_limit(size), token);
+}
+
+SORTING_TARGET_AVX512 static void sort_segments_avx512(uint32_t *keys, const uint32_t *offsets, uint32_t first,
+                                                       uint32_t last, const cancel_token &token) {
+    for (uint32_t s = first; s < last; ++s) {
+        uint32_t *arr = keys + offsets[s];
+        uint32_t size = offsets[s + 1] - offsets[s];
+
+        if (size <= 1) continue;
+        if (size <= 128) {
+            small_sort_avx512(arr, size);
+        } else {
+            vector_quick_sort<128, partition_avx512, small_sort_avx512>(arr, size, quick_sort_depth_limit(size), token);
+        }
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ == 12
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+using quick_sort_kernel = void (*)(uint32_t *, uint32_t, const cancel_token &);
+
+#ifdef SORTING_X86_DISPATCH
+static const quick_sort_kernel QUICK_SORT_KERNELS[CPU_ISA_COUNT] = {quick_sort_generic, quick_sort_avx2, quick_sort_avx512};
+#else
+static const quick_sort_kernel QUICK_SORT_KERNELS[CPU_ISA_COUNT] = {quick_sort_generic};
+#endif
+
+void simd_quick_sort(uint32_t *arr, uint32_t size, const cancel_token &token) {
+    dispatch(QUICK_SORT_KERNELS)(arr, size, token);
+}
+
+using sort_segments_kernel = void (*)(uint32_t *, const uint32_t *, uint32_t, uint32_t, const cancel_token &);
+
+#ifdef SORTING_X86_DISPATCH
+static const sort_segments_kernel SORT_SEGMENTS_KERNELS[CPU_ISA_COUNT] = {sort_segments_generic, sort_segments_avx2, sort_segments_avx512};
+#else
+static const sort_segments_kernel SORT_SEGMENTS_KERNELS[CPU_ISA_COUNT] = {sort_segments_generic};
+#endif
+
+void simd_sort_segments(uint32_t *keys, const uint32_t *offsets, uint32_t first, uint32_t last,
+                        const cancel_token &token) {
+    dispatch(SORT_SEGMENTS_KERNELS)(keys, offsets, first, last, token);
+}
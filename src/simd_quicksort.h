@@ -0,0 +1,24 @@
+#ifndef SORTING_ALGORITHMS_SIMD_QUICKSORT_H
+#define SORTING_ALGORITHMS_SIMD_QUICKSORT_H
+
+#include "cancel_token.h"
+
+#include <cstdint>
+
+// Vectorized quicksort for uint32_t keys, dispatched on active_isa():
+//   avx512  partitions 16 keys per step with compress-stores (vpcompressd) and sorts
+//           ranges of up to 128 keys with an in-register bitonic network
+//   avx2    partitions 8 keys per step through a permutation lookup table and sorts
+//           ranges of up to 64 keys with a bitonic network
+//   generic the scalar quick_sort_algorithm
+// Like the scalar engine it falls back to heapsort past quick_sort_depth_limit, and it
+// polls the token once per partition.
+void simd_quick_sort(uint32_t *arr, uint32_t size, const cancel_token &token);
+
+// Sorts keys[offsets[s], offsets[s + 1]) for each s in [first, last) on the same kernels,
+// dispatched once for all of them: segments the bitonic network holds go straight to
+// it (generic: insertion sort up to 32 keys), longer ones to quicksort.
+void simd_sort_segments(uint32_t *keys, const uint32_t *offsets, uint32_t first, uint32_t last,
+                        const cancel_token &token);
+
+#endif //SORTING_ALGORITHMS_SIMD_QUICKSORT_H
@@ -0,0 +1,149 @@
+#include "simd_select.h"
+
+#include "cpu_dispatch.h"
+#include "selection_algorithms.h"
+#include "simd_quicksort.h"
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#ifdef SORTING_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+// Returns the index of the first key in [begin, size) below bound, or size.
+static uint32_t find_below_generic(const uint32_t *arr, uint32_t begin, uint32_t size, uint32_t bound) {
+    for (uint32_t i = begin; i < size; ++i) {
+        if (arr[i] < bound) return i;
+    }
+    return size;
+}
+
+#ifdef SORTING_X86_DISPATCH
+
+SORTING_TARGET_AVX2 static uint32_t find_below_avx2(const uint32_t *arr, uint32_t begin, uint32_t size, uint32_t bound) {
+    // AVX2 only compares signed integers; flipping the sign bit maps unsigned order onto it.
+    const __m256i sign = _mm256_set1_epi32((int) 0x80000000u);
+    const __m256i limit = _mm256_xor_si256(_mm256_set1_epi32((int) bound), sign);
+    uint32_t i = begin;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i below_0 = _mm256_cmpgt_epi32(limit, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (arr + i)), sign));
+        __m256i below_1 = _mm256_cmpgt_epi32(limit, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (arr + i + 8)), sign));
+        __m256i below_2 = _mm256_cmpgt_epi32(limit, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (arr + i + 16)), sign));
+        __m256i below_3 = _mm256_cmpgt_epi32(limit, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (arr + i + 24)), sign));
+
+        __m256i any = _mm256_or_si256(_mm256_or_si256(below_0, below_1), _mm256_or_si256(below_2, below_3));
+        if (_mm256_testz_si256(any, any)) continue;
+
+        uint32_t mask = (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(below_0))
+                        | (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(below_1)) << 8
+                        | (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(below_2)) << 16
+                        | (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(below_3)) << 24;
+        return i + (uint32_t) std::countr_zero(mask);
+    }
+
+    return find_below_generic(arr, i, size, bound);
+}
+
+SORTING_TARGET_AVX512 static uint32_t find_below_avx512(const uint32_t *arr, uint32_t begin, uint32_t size, uint32_t bound) {
+    const __m512i limit = _mm512_set1_epi32((int) bound);
+    uint32_t i = begin;
+
+    for (; i + 64 <= size; i += 64) {
+        __mmask16 below_0 = _mm512_cmplt_epu32_mask(_mm512_loadu_si512(arr + i), limit);
+        __mmask16 below_1 = _mm512_cmplt_epu32_mask(_mm512_loadu_si512(arr + i + 16), limit);
+        __mmask16 below_2 = _mm512_cmplt_epu32_mask(_mm512_loadu_si512(arr + i + 32), limit);
+        __mmask16 below_3 = _mm512_cmplt_epu32_mask(_mm512_loadu_si512(arr + i + 48), limit);
+
+        if (!(below_0 | below_1 | below_2 | below_3)) continue;
+
+        uint64_t mask = (uint64_t) below_0 | (uint64_t) below_1 << 16 | (uint64_t) below_2 << 32 | (uint64_t) below_3 << 48;
+        return i + (uint32_t) std::countr_zero(mask);
+    }
+
+    for (; i + 16 <= size; i += 16) {
+        __mmask16 below = _mm512_cmplt_epu32_mask(_mm512_loadu_si512(arr + i), limit);
+        if (below) return i + (uint32_t) std::countr_zero((uint32_t) below);
+    }
+
+    return find_below_generic(arr, i, size, bound);
+}
+
+#endif
+
+using find_below_kernel = uint32_t (*)(const uint32_t *, uint32_t, uint32_t, uint32_t);
+
+#ifdef SORTING_X86_DISPATCH
+static const find_below_kernel FIND_BELOW_KERNELS[CPU_ISA_COUNT] = {find_below_generic, find_below_avx2, find_below_avx512};
+#else
+static const find_below_kernel FIND_BELOW_KERNELS[CPU_ISA_COUNT] = {find_below_generic};
+#endif
+
+void simd_top_k(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token) {
+    k = std::min(k, size);
+    if (k == 0) return;
+
+    if (k > SIMD_TOP_K_LIMIT) {
+        no_counters counters;
+        radix_select_algorithm(arr, size, k, token, counters);
+        return;
+    }
+
+    find_below_kernel find_below = dispatch(FIND_BELOW_KERNELS);
+
+    // Every key below the threshold is kept; the buffer always holds at least k keys no
+    // larger than it, so anything skipped cannot be among the k smallest.
+    uint32_t capacity = 4 * k + 64;
+    std::vector<uint32_t> candidates(arr, arr + k);
+    candidates.reserve(capacity);
+    uint32_t threshold = *std::max_element(candidates.begin(), candidates.end());
+
+    for (uint32_t i = find_below(arr, k, size, threshold); i < size; i = find_below(arr, i + 1, size, threshold)) {
+        candidates.push_back(arr[i]);
+        if (candidates.size() < capacity) continue;
+
+        if (token.requested()) return;
+        std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end());
+        candidates.resize(k);
+        threshold = candidates[k - 1];
+    }
+
+    std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end());
+    uint32_t kth = candidates[k - 1];
+    uint32_t equal_wanted = k - (uint32_t) std::count_if(candidates.begin(), candidates.begin() + k, [kth](uint32_t key) {
+        return key < kth;
+    });
+
+    // Keep what already belongs in the prefix and collect the slots that do not; the
+    // suffix then holds exactly as many winners as there are slots.
+    std::vector<uint32_t> slots;
+    uint32_t equal_kept = 0;
+    for (uint32_t i = 0; i < k; ++i) {
+        if (arr[i] < kth) continue;
+        if (arr[i] == kth && equal_kept < equal_wanted) {
+            ++equal_kept;
+            continue;
+        }
+        slots.push_back(i);
+    }
+
+    for (uint32_t i = k; !slots.empty() && i < size; ++i) {
+        bool take_equal = equal_kept < equal_wanted;
+        if (!take_equal || kth != UINT32_MAX) {
+            i = find_below(arr, i, size, take_equal ? kth + 1 : kth);
+            if (i == size) break;
+        }
+
+        if (arr[i] == kth) {
+            if (!take_equal) continue;
+            ++equal_kept;
+        }
+
+        std::swap(arr[i], arr[slots.back()]);
+        slots.pop_back();
+    }
+
+    simd_quick_sort(arr, k, token);
+}
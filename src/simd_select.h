@@ -0,0 +1,20 @@
+#ifndef SORTING_ALGORITHMS_SIMD_SELECT_H
+#define SORTING_ALGORITHMS_SIMD_SELECT_H
+
+#include "cancel_token.h"
+
+#include <cstdint>
+
+// Above this k the candidate buffer stops fitting in L1 and simd_top_k hands the whole
+// job to the radix select kernel.
+static constexpr uint32_t SIMD_TOP_K_LIMIT = 1024;
+
+// Top-k for small k: one vector scan keeps only keys below the k-th smallest key seen
+// so far in a candidate buffer, which is cut back to k whenever it fills. Once the k-th
+// smallest key is known, a second scan swaps the remaining winners into arr[0, k) and
+// simd_quick_sort orders them. Both scans compare 8 (avx2) or 16 (avx512) keys per
+// instruction against the threshold and only drop to scalar code on a hit, which gets
+// rare after the first few thousand keys of unordered input.
+void simd_top_k(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token);
+
+#endif //SORTING_ALGORITHMS_SIMD_SELECT_H
@@ -0,0 +1,320 @@
+#include "sort_verifier.h"
+#include "cpu_dispatch.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SORT_VERIFIER_SSE2
+#endif
+
+#ifdef SORTING_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+// Below this many elements the threads cost more than they save.
+static constexpr uint32_t PARALLEL_THRESHOLD = 1 << 20;
+// Threads scan their range in blocks and give up once a smaller descent is known.
+static constexpr uint32_t SCAN_BLOCK = 1 << 16;
+
+static uint32_t verify_thread_count(uint32_t size) {
+    if (size < PARALLEL_THRESHOLD) return 1;
+
+    return std::min(active_threads(), size / (PARALLEL_THRESHOLD / 4));
+}
+
+// Runs job(slice_index, begin, end) over `threads` contiguous slices of [0, size) on
+// the thread pool, the last slice on the calling thread.
+template<typename JOB>
+static void for_each_slice(uint32_t size, uint32_t threads, JOB job) {
+    uint32_t slice = size / threads;
+
+    run_parallel(threads, [&](uint32_t t) {
+        job(t, t * slice, t + 1 == threads ? size : (t + 1) * slice);
+    });
+}
+
+// splitmix64 finalizer: summing mixed values keeps the hash order-independent while
+// making it hard for two different multisets to collide (a plain sum would not be).
+static inline uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Four independent sums keep the multipliers busy instead of waiting on one chain.
+static uint64_t checksum_range_generic(const uint32_t *arr, uint32_t begin, uint32_t end) {
+    uint64_t sums[4] = {};
+    uint32_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        sums[0] += mix(arr[i]);
+        sums[1] += mix(arr[i + 1]);
+        sums[2] += mix(arr[i + 2]);
+        sums[3] += mix(arr[i + 3]);
+    }
+    for (; i < end; ++i) sums[0] += mix(arr[i]);
+
+    return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+#ifdef SORTING_X86_DISPATCH
+
+// AVX2 has no 64-bit multiply; the low 64 bits of x * c are built from three 32x32 products.
+SORTING_TARGET_AVX2 static inline __m256i multiply_avx2(__m256i x, uint64_t c) {
+    const __m256i c_low = _mm256_set1_epi64x((int64_t) (c & 0xffffffffu));
+    const __m256i c_high = _mm256_set1_epi64x((int64_t) (c >> 32));
+
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), c_low), _mm256_mul_epu32(x, c_high));
+    return _mm256_add_epi64(_mm256_mul_epu32(x, c_low), _mm256_slli_epi64(cross, 32));
+}
+
+SORTING_TARGET_AVX2 static inline __m256i mix_avx2(__m256i x) {
+    x = _mm256_add_epi64(x, _mm256_set1_epi64x((int64_t) 0x9e3779b97f4a7c15ull));
+    x = multiply_avx2(_mm256_xor_si256(x, _mm256_srli_epi64(x, 30)), 0xbf58476d1ce4e5b9ull);
+    x = multiply_avx2(_mm256_xor_si256(x, _mm256_srli_epi64(x, 27)), 0x94d049bb133111ebull);
+    return _mm256_xor_si256(x, _mm256_srli_epi64(x, 31));
+}
+
+SORTING_TARGET_AVX2 static uint64_t checksum_range_avx2(const uint32_t *arr, uint32_t begin, uint32_t end) {
+    __m256i sums[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+    uint32_t i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        sums[0] = _mm256_add_epi64(sums[0], mix_avx2(_mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *) (arr + i)))));
+        sums[1] = _mm256_add_epi64(sums[1], mix_avx2(_mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *) (arr + i + 4)))));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, _mm256_add_epi64(sums[0], sums[1]));
+
+    uint64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < end; ++i) sum += mix(arr[i]);
+    return sum;
+}
+
+// GCC 12's AVX-512 headers start unmasked intrinsics from _mm512_undefined_epi32(), which
+// -Wall reports at every call site inlined into these kernels.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ == 12
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+SORTING_TARGET_AVX512 static inline __m512i mix_avx512(__m512i x) {
+    x = _mm512_add_epi64(x, _mm512_set1_epi64((int64_t) 0x9e3779b97f4a7c15ull));
+    x = _mm512_mullo_epi64(_mm512_xor_si512(x, _mm512_srli_epi64(x, 30)), _mm512_set1_epi64((int64_t) 0xbf58476d1ce4e5b9ull));
+    x = _mm512_mullo_epi64(_mm512_xor_si512(x, _mm512_srli_epi64(x, 27)), _mm512_set1_epi64((int64_t) 0x94d049bb133111ebull));
+    return _mm512_xor_si512(x, _mm512_srli_epi64(x, 31));
+}
+
+SORTING_TARGET_AVX512 static uint64_t checksum_range_avx512(const uint32_t *arr, uint32_t begin, uint32_t end) {
+    __m512i sums[2] = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+    uint32_t i = begin;
+
+    for (; i + 16 <= end; i += 16) {
+        sums[0] = _mm512_add_epi64(sums[0], mix_avx512(_mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *) (arr + i)))));
+        sums[1] = _mm512_add_epi64(sums[1], mix_avx512(_mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *) (arr + i + 8)))));
+    }
+
+    // Summed as unsigned: _mm512_reduce_add_epi64 adds signed lanes, which may overflow.
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, _mm512_add_epi64(sums[0], sums[1]));
+
+    uint64_t sum = 0;
+    for (uint64_t lane: lanes) sum += lane;
+    for (; i < end; ++i) sum += mix(arr[i]);
+    return sum;
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ == 12
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+using checksum_kernel = uint64_t (*)(const uint32_t *, uint32_t, uint32_t);
+
+#ifdef SORTING_X86_DISPATCH
+static const checksum_kernel CHECKSUM_KERNELS[CPU_ISA_COUNT] = {checksum_range_generic, checksum_range_avx2, checksum_range_avx512};
+#else
+static const checksum_kernel CHECKSUM_KERNELS[CPU_ISA_COUNT] = {checksum_range_generic};
+#endif
+
+uint64_t multiset_checksum(const uint32_t *arr, uint32_t size) {
+    uint32_t threads = verify_thread_count(size);
+    std::vector<uint64_t> partial(threads);
+    checksum_kernel checksum_range = dispatch(CHECKSUM_KERNELS);
+
+    // Addition is commutative, so the slices can be hashed and summed in any order.
+    for_each_slice(size, threads, [&](uint32_t slice, uint32_t begin, uint32_t end) {
+        partial[slice] = checksum_range(arr, begin, end);
+    });
+
+    uint64_t sum = mix(size);
+    for (uint64_t value: partial) sum += value;
+    return sum;
+}
+
+// First i in [begin, end) with arr[i] < arr[i - 1]; begin must be at least 1.
+static uint32_t find_descent_generic(const uint32_t *arr, uint32_t begin, uint32_t end) {
+    uint32_t i = begin;
+
+#ifdef SORT_VERIFIER_SSE2
+    // SSE2 only compares signed integers; flipping the sign bit maps unsigned order onto it.
+    const __m128i sign = _mm_set1_epi32((int) 0x80000000u);
+
+    for (; i + 4 <= end; i += 4) {
+        __m128i previous = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (arr + i - 1)), sign);
+        __m128i current = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (arr + i)), sign);
+
+        if (_mm_movemask_epi8(_mm_cmpgt_epi32(previous, current))) break;
+    }
+#endif
+
+    for (; i < end; ++i) {
+        if (arr[i] < arr[i - 1]) return i;
+    }
+    return end;
+}
+
+#ifdef SORTING_X86_DISPATCH
+
+// The vector loops only find the block holding the descent; the scalar tail pins it down.
+SORTING_TARGET_AVX2 static uint32_t find_descent_avx2(const uint32_t *arr, uint32_t begin, uint32_t end) {
+    uint32_t i = begin;
+
+    // current >= previous exactly where max(previous, current) == current.
+    for (; i + 16 <= end; i += 16) {
+        __m256i current_0 = _mm256_loadu_si256((const __m256i *) (arr + i));
+        __m256i current_1 = _mm256_loadu_si256((const __m256i *) (arr + i + 8));
+        __m256i ordered_0 = _mm256_cmpeq_epi32(_mm256_max_epu32(_mm256_loadu_si256((const __m256i *) (arr + i - 1)), current_0), current_0);
+        __m256i ordered_1 = _mm256_cmpeq_epi32(_mm256_max_epu32(_mm256_loadu_si256((const __m256i *) (arr + i + 7)), current_1), current_1);
+
+        if (_mm256_movemask_epi8(_mm256_and_si256(ordered_0, ordered_1)) != -1) break;
+    }
+
+    for (; i < end; ++i) {
+        if (arr[i] < arr[i - 1]) return i;
+    }
+    return end;
+}
+
+SORTING_TARGET_AVX512 static uint32_t find_descent_avx512(const uint32_t *arr, uint32_t begin, uint32_t end) {
+    uint32_t i = begin;
+
+    for (; i + 32 <= end; i += 32) {
+        __mmask16 descents_0 = _mm512_cmpgt_epu32_mask(_mm512_loadu_si512(arr + i - 1), _mm512_loadu_si512(arr + i));
+        __mmask16 descents_1 = _mm512_cmpgt_epu32_mask(_mm512_loadu_si512(arr + i + 15), _mm512_loadu_si512(arr + i + 16));
+
+        if (descents_0 | descents_1) break;
+    }
+
+    for (; i < end; ++i) {
+        if (arr[i] < arr[i - 1]) return i;
+    }
+    return end;
+}
+
+#endif
+
+using descent_kernel = uint32_t (*)(const uint32_t *, uint32_t, uint32_t);
+
+#ifdef SORTING_X86_DISPATCH
+static const descent_kernel DESCENT_KERNELS[CPU_ISA_COUNT] = {find_descent_generic, find_descent_avx2, find_descent_avx512};
+#else
+static const descent_kernel DESCENT_KERNELS[CPU_ISA_COUNT] = {find_descent_generic};
+#endif
+
+uint32_t find_unsorted(const uint32_t *arr, uint32_t size) {
+    if (size < 2) return size;
+
+    descent_kernel find_descent = dispatch(DESCENT_KERNELS);
+
+    uint32_t threads = verify_thread_count(size);
+    if (threads == 1) return find_descent(arr, 1, size);
+
+    std::atomic<uint32_t> first(size);
+
+    for_each_slice(size, threads, [&](uint32_t, uint32_t begin, uint32_t end) {
+        // Each slice also checks the pair straddling its start.
+        for (uint32_t block = std::max(begin, 1u); block < end; block += SCAN_BLOCK) {
+            if (block >= first.load(std::memory_order_relaxed)) return;
+
+            uint32_t block_end = std::min(end, block + SCAN_BLOCK);
+            uint32_t descent = find_descent(arr, block, block_end);
+            if (descent == block_end) continue;
+
+            uint32_t known = first.load(std::memory_order_relaxed);
+            while (descent < known && !first.compare_exchange_weak(known, descent, std::memory_order_relaxed)) {}
+            return;
+        }
+    });
+
+    return first.load();
+}
+
+verify_result verify_sort(const uint32_t *input, const uint32_t *output, uint32_t size) {
+    return verify_sort(multiset_checksum(input, size), output, size);
+}
+
+verify_result verify_sort(uint64_t input_checksum, const uint32_t *output, uint32_t size) {
+    verify_result result;
+
+    uint32_t unsorted = find_unsorted(output, size);
+    result.sorted = unsorted == size;
+    result.first_unsorted = result.sorted ? 0 : unsorted;
+    result.permutation = input_checksum == multiset_checksum(output, size);
+
+    return result;
+}
+
+verify_result verify_selection(uint64_t input_checksum, const uint32_t *output, uint32_t size, uint32_t k,
+                               SELECTION kind) {
+    verify_result result;
+    result.permutation = input_checksum == multiset_checksum(output, size);
+
+    // The prefix [0, split) must not exceed the boundary key and the rest must not undercut it.
+    uint32_t split = k, boundary = 0;
+    if (kind == SELECTION::NTH_ELEMENT) {
+        if (k >= size) return result;
+        boundary = output[k];
+    } else {
+        split = std::min(k, size);
+        uint32_t unsorted = find_unsorted(output, split);
+        if (unsorted != split) {
+            result.sorted = false;
+            result.first_unsorted = unsorted;
+            return result;
+        }
+        if (split == 0 || split == size) return result;
+        boundary = output[split - 1];
+    }
+
+    for (uint32_t i = kind == SELECTION::TOP_K ? split : 0; i < size; ++i) {
+        if (i < split ? boundary < output[i] : output[i] < boundary) {
+            result.sorted = false;
+            result.first_unsorted = i;
+            break;
+        }
+    }
+    return result;
+}
+
+void tag_keys(const uint32_t *input, tagged_key *output, uint32_t size, uint32_t key_range) {
+    for (uint32_t i = 0; i < size; ++i) {
+        output[i].key = key_range ? input[i] % key_range : input[i];
+        output[i].tag = i;
+    }
+}
+
+bool is_stable_sorted(const tagged_key *arr, uint32_t size) {
+    for (uint32_t i = 1; i < size; ++i) {
+        if (arr[i].key < arr[i - 1].key) return false;
+        if (arr[i].key == arr[i - 1].key && arr[i].tag < arr[i - 1].tag) return false;
+    }
+    return true;
+}
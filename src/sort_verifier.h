@@ -0,0 +1,60 @@
+#ifndef SORTING_ALGORITHMS_SORT_VERIFIER_H
+#define SORTING_ALGORITHMS_SORT_VERIFIER_H
+
+#include <cstdint>
+
+// Element for stability checks: engines compare keys only, so equal keys must keep
+// their tags in ascending order if the engine is stable.
+struct tagged_key {
+    uint32_t key;
+    uint32_t tag;
+};
+
+inline bool operator<(const tagged_key &a, const tagged_key &b) {
+    return a.key < b.key;
+}
+
+struct verify_result {
+    bool sorted = true;
+    bool permutation = true;
+    // Index of the first element smaller than its predecessor, if not sorted.
+    uint32_t first_unsorted = 0;
+
+    bool ok() const { return sorted && permutation; }
+};
+
+// Both checks are linear, vectorized where the target allows and split across the
+// shared thread pool for large arrays, so they stay far cheaper than the sort itself.
+
+// Order-independent hash of the multiset of values: equal for any permutation of the
+// same values and, with overwhelming probability, different otherwise.
+uint64_t multiset_checksum(const uint32_t *arr, uint32_t size);
+
+// Returns size if the array is sorted, otherwise the index of the first descent.
+uint32_t find_unsorted(const uint32_t *arr, uint32_t size);
+
+verify_result verify_sort(const uint32_t *input, const uint32_t *output, uint32_t size);
+
+// For in-place sorts: checksum the input before sorting and pass it here afterwards.
+verify_result verify_sort(uint64_t input_checksum, const uint32_t *output, uint32_t size);
+
+// What a partial sort promises about its output for a given k:
+//   NTH_ELEMENT  k < size; output[k] is the key a full sort would put there, keys before
+//                it are not larger and keys after it are not smaller
+//   TOP_K        k <= size; output[0, k) is sorted and no key after it is smaller
+enum SELECTION {
+    NTH_ELEMENT,
+    TOP_K
+};
+
+// Linear like verify_sort; first_unsorted is the first position breaking the promise.
+verify_result verify_selection(uint64_t input_checksum, const uint32_t *output, uint32_t size, uint32_t k,
+                               SELECTION kind);
+
+// key = input[i] % key_range, tag = i. A small key range forces many duplicates.
+void tag_keys(const uint32_t *input, tagged_key *output, uint32_t size, uint32_t key_range);
+
+// True if the keys are ascending and every run of equal keys has ascending tags.
+bool is_stable_sorted(const tagged_key *arr, uint32_t size);
+
+#endif //SORTING_ALGORITHMS_SORT_VERIFIER_H
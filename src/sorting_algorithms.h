@@ -0,0 +1,342 @@
+#ifndef SORTING_ALGORITHMS_SORTING_ALGORITHMS_H
+#define SORTING_ALGORITHMS_SORTING_ALGORITHMS_H
+
+#include "cancel_token.h"
+#include "operation_counters.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Fast kernels. Counters is a policy from operation_counters.h; with no_counters
+// every hook compiles away and the kernels are exactly the uninstrumented ones.
+// T only needs operator<, so the same kernels sort uint32_t and tagged keys.
+
+// Merges whose halves fit in this many bytes keep them on the stack; larger ones
+// would overflow a default thread stack long before the array fills memory.
+static constexpr uint32_t MERGE_STACK_LIMIT = 65536;
+
+// Quicksort leaves ranges this short to insertion sort.
+static constexpr uint32_t QUICK_SORT_CUTOFF = 16;
+
+// LSD radix sort digit width: four passes over a 32-bit key.
+static constexpr uint32_t RADIX_BITS = 8;
+static constexpr uint32_t RADIX_BUCKETS = 1 << RADIX_BITS;
+static constexpr uint32_t RADIX_PASSES = 32 / RADIX_BITS;
+
+// Radix kernels sort by radix_key(element): the value itself for uint32_t, the `key`
+// member for records such as tagged keys. Other layouts add an overload here.
+inline uint32_t radix_key(uint32_t value) {
+    return value;
+}
+
+// Packed key-value records (key << 32 | payload) sort by their upper half.
+inline uint32_t radix_key(uint64_t packed) {
+    return (uint32_t) (packed >> 32);
+}
+
+template<typename T>
+uint32_t radix_key(const T &record) {
+    return record.key;
+}
+
+template<typename T, typename Counters>
+void bubble_sort_algorithm(T *array, uint32_t array_size, const cancel_token &token, Counters &counters) {
+    for (uint32_t i = 0; i < array_size - 1; ++i) {
+        for (uint32_t j = 0; j < array_size - i - 1; ++j) {
+            if (j % cancel_token::CANCEL_POLL_INTERVAL == 0 && token.requested()) return;
+
+            counters.compare();
+            counters.read(2);
+            if (array[j + 1] < array[j]) {
+                counters.swap();
+                counters.write(2);
+                std::swap(array[j], array[j + 1]);
+            }
+        }
+    }
+}
+
+template<typename T, typename Counters>
+void merge(T *arr, uint32_t l, uint32_t m, uint32_t r, const cancel_token &token, Counters &counters) {
+    uint32_t i, j, k;
+    uint32_t l_size = m - l + 1;
+    uint32_t r_size = r - m;
+
+    bool on_stack = (uint64_t) (l_size + r_size) * sizeof(T) <= MERGE_STACK_LIMIT;
+    T stack_buffer[on_stack ? l_size + r_size : 1];
+    std::unique_ptr<T[]> heap_buffer(on_stack ? nullptr : new T[l_size + r_size]);
+
+    T *L = on_stack ? stack_buffer : heap_buffer.get();
+    T *R = L + l_size;
+    counters.allocate((uint64_t) (l_size + r_size) * sizeof(T));
+
+    for (i = 0; i < l_size; i++) L[i] = arr[l + i];
+    for (j = 0; j < r_size; j++) R[j] = arr[m + 1 + j];
+    counters.read(l_size + r_size);
+    counters.write(l_size + r_size);
+
+    i = 0;
+    j = 0;
+    k = l;
+    while (i < l_size && j < r_size) {
+        // On cancellation the unmerged tails are still copied back below,
+        // so the range stays a permutation of its input.
+        if ((k - l) % cancel_token::CANCEL_POLL_INTERVAL == 0 && token.requested()) break;
+
+        counters.compare();
+        counters.read(2);
+        counters.write(1);
+        if (!(R[j] < L[i])) {
+            arr[k] = L[i];
+            i++;
+        } else {
+            arr[k] = R[j];
+            j++;
+        }
+
+        k++;
+    }
+
+    counters.read(r - k + 1);
+    counters.write(r - k + 1);
+
+    while (i < l_size) {
+        arr[k] = L[i];
+        i++;
+        k++;
+    }
+
+    while (j < r_size) {
+        arr[k] = R[j];
+        j++;
+        k++;
+    }
+
+    counters.release((uint64_t) (l_size + r_size) * sizeof(T));
+}
+
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "misc-no-recursion"
+
+template<typename T, typename Counters>
+void merge_sort_algorithm(T *arr, uint32_t l, uint32_t r, const cancel_token &token, Counters &counters) {
+    if (l < r && !token.requested()) {
+        counters.enter();
+        uint32_t m = l + (r - l) / 2;
+        merge_sort_algorithm(arr, l, m, token, counters);
+        merge_sort_algorithm(arr, m + 1, r, token, counters);
+        if (!token.requested()) merge(arr, l, m, r, token, counters);
+        counters.leave();
+    }
+}
+
+template<typename T, typename Counters>
+void insertion_sort_algorithm(T *arr, uint32_t size, Counters &counters) {
+    for (uint32_t i = 1; i < size; ++i) {
+        T value = arr[i];
+        uint32_t j = i;
+        counters.read(1);
+
+        while (j > 0) {
+            counters.compare();
+            counters.read(1);
+            if (!(value < arr[j - 1])) break;
+
+            arr[j] = arr[j - 1];
+            counters.write(1);
+            --j;
+        }
+
+        arr[j] = value;
+        counters.write(1);
+    }
+}
+
+template<typename T, typename Counters>
+void sift_down(T *arr, uint32_t root, uint32_t size, Counters &counters) {
+    while (2 * root + 1 < size) {
+        uint32_t child = 2 * root + 1;
+
+        if (child + 1 < size) {
+            counters.compare();
+            counters.read(2);
+            if (arr[child] < arr[child + 1]) ++child;
+        }
+
+        counters.compare();
+        counters.read(2);
+        if (!(arr[root] < arr[child])) return;
+
+        counters.swap();
+        counters.write(2);
+        std::swap(arr[root], arr[child]);
+        root = child;
+    }
+}
+
+// Second half of heapsort: turns a max-heap into ascending order.
+template<typename T, typename Counters>
+void sort_heap(T *arr, uint32_t size, const cancel_token &token, Counters &counters) {
+    for (uint32_t end = size; end > 1; --end) {
+        if (end % cancel_token::CANCEL_POLL_INTERVAL == 0 && token.requested()) return;
+
+        counters.swap();
+        counters.read(2);
+        counters.write(2);
+        std::swap(arr[0], arr[end - 1]);
+        sift_down(arr, 0, end - 1, counters);
+    }
+}
+
+template<typename T, typename Counters>
+void heap_sort_algorithm(T *arr, uint32_t size, const cancel_token &token, Counters &counters) {
+    for (uint32_t i = size / 2; i-- > 0;) {
+        if (i % cancel_token::CANCEL_POLL_INTERVAL == 0 && token.requested()) return;
+        sift_down(arr, i, size, counters);
+    }
+
+    sort_heap(arr, size, token, counters);
+}
+
+// Hoare partition around the median of the first, middle and last elements. Returns
+// p with 0 < p < size such that [0, p) <= pivot <= [p, size); size must be at least 3.
+// The token is polled between swaps, once per CANCEL_POLL_INTERVAL elements scanned; a
+// cancelled partition returns some p in (0, size) that splits nothing.
+template<typename T, typename Counters>
+uint32_t quick_partition(T *arr, uint32_t size, const cancel_token &token, Counters &counters) {
+    uint32_t mid = size / 2;
+
+    // Ordering the three samples in place also gives both scans a sentinel.
+    counters.compare();
+    counters.compare();
+    counters.compare();
+    counters.read(6);
+    if (arr[mid] < arr[0]) std::swap(arr[mid], arr[0]);
+    if (arr[size - 1] < arr[mid]) {
+        std::swap(arr[size - 1], arr[mid]);
+        if (arr[mid] < arr[0]) std::swap(arr[mid], arr[0]);
+    }
+
+    T pivot = arr[mid];
+    uint32_t i = 0, j = size - 1, poll = cancel_token::CANCEL_POLL_INTERVAL;
+
+    while (true) {
+        do {
+            counters.compare();
+            counters.read(1);
+        } while (arr[++i] < pivot);
+
+        do {
+            counters.compare();
+            counters.read(1);
+        } while (pivot < arr[--j]);
+
+        if (i >= j) return j + 1;
+
+        counters.swap();
+        counters.write(2);
+        std::swap(arr[i], arr[j]);
+
+        if (i + (size - j) >= poll) {
+            if (token.requested()) return j + 1;
+            poll += cancel_token::CANCEL_POLL_INTERVAL;
+        }
+    }
+}
+
+// Recursion budget before quicksort falls back to heapsort (introsort).
+inline uint32_t quick_sort_depth_limit(uint32_t size) {
+    return 2 * (uint32_t) std::bit_width(size);
+}
+
+// Recurses into the smaller side and loops on the larger one, so the stack stays
+// O(log n) even when the depth limit is not hit.
+template<typename T, typename Counters>
+void quick_sort_algorithm(T *arr, uint32_t size, uint32_t depth_limit, const cancel_token &token, Counters &counters) {
+    counters.enter();
+
+    while (size > QUICK_SORT_CUTOFF && !token.requested()) {
+        if (depth_limit == 0) {
+            heap_sort_algorithm(arr, size, token, counters);
+            counters.leave();
+            return;
+        }
+        --depth_limit;
+
+        uint32_t split = quick_partition(arr, size, token, counters);
+
+        if (split < size - split) {
+            quick_sort_algorithm(arr, split, depth_limit, token, counters);
+            arr += split;
+            size -= split;
+        } else {
+            quick_sort_algorithm(arr + split, size - split, depth_limit, token, counters);
+            size = split;
+        }
+    }
+
+    if (!token.requested()) insertion_sort_algorithm(arr, size, counters);
+    counters.leave();
+}
+
+#pragma clang diagnostic pop
+
+// Stable LSD radix sort through one scratch array. A single counting pass builds every
+// digit's histogram, and passes where all keys share the digit are skipped. Cancellation
+// is checked every CANCEL_POLL_INTERVAL keys; a cancelled pass is dropped, since the
+// array it reads from still holds the previous one, so the result is a permutation.
+template<typename T, typename Counters>
+void radix_sort_algorithm(T *arr, uint32_t size, const cancel_token &token, Counters &counters) {
+    if (size < 2) return;
+
+    uint32_t counts[RADIX_PASSES][RADIX_BUCKETS] = {};
+    for (uint32_t i = 0; i < size;) {
+        if (token.requested()) return;
+
+        uint32_t end = std::min(size, i + cancel_token::CANCEL_POLL_INTERVAL);
+        counters.read(end - i);
+        for (; i < end; ++i) {
+            uint32_t key = radix_key(arr[i]);
+            for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass) ++counts[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)];
+        }
+    }
+
+    std::unique_ptr<T[]> buffer(new T[size]);
+    counters.allocate((uint64_t) size * sizeof(T));
+
+    T *from = arr, *to = buffer.get();
+    for (uint32_t pass = 0; pass < RADIX_PASSES && !token.requested(); ++pass) {
+        uint32_t shift = pass * RADIX_BITS;
+        if (counts[pass][(radix_key(from[0]) >> shift) & (RADIX_BUCKETS - 1)] == size) continue;
+
+        uint32_t offsets[RADIX_BUCKETS];
+        uint32_t sum = 0;
+        for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+            offsets[bucket] = sum;
+            sum += counts[pass][bucket];
+        }
+
+        uint32_t i = 0;
+        while (i < size && !token.requested()) {
+            uint32_t end = std::min(size, i + cancel_token::CANCEL_POLL_INTERVAL);
+            counters.read(end - i);
+            counters.write(end - i);
+            for (; i < end; ++i) to[offsets[(radix_key(from[i]) >> shift) & (RADIX_BUCKETS - 1)]++] = from[i];
+        }
+        if (i < size) break;
+
+        std::swap(from, to);
+    }
+
+    if (from != arr) {
+        std::copy(from, from + size, arr);
+        counters.read(size);
+        counters.write(size);
+    }
+    counters.release((uint64_t) size * sizeof(T));
+}
+
+#endif //SORTING_ALGORITHMS_SORTING_ALGORITHMS_H
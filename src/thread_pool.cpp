@@ -0,0 +1,183 @@
+#include "thread_pool.h"
+
+#include "numa.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+const char *THREAD_AFFINITY_IDS[] = {"none", "compact", "spread"};
+
+bool parse_thread_affinity(const char *id, THREAD_AFFINITY &affinity) {
+    for (uint32_t a = 0; a < THREAD_AFFINITY_COUNT; ++a) {
+        if (strcmp(id, THREAD_AFFINITY_IDS[a]) == 0) {
+            affinity = (THREAD_AFFINITY) a;
+            return true;
+        }
+    }
+    return false;
+}
+
+static thread_local thread_pool *current_pool = nullptr;
+static thread_local uint32_t current_worker = 0;
+
+// Restricts the calling thread to `cpus`; does nothing where affinity cannot be set.
+static void pin_thread(const std::vector<uint32_t> &cpus) {
+#if defined(__linux__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (uint32_t cpu: cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &mask);
+    }
+    sched_setaffinity(0, sizeof(mask), &mask);
+#else
+    (void) cpus;
+#endif
+}
+
+static std::vector<uint32_t> worker_cpus(uint32_t worker, THREAD_AFFINITY affinity) {
+    const std::vector<numa_node> &nodes = numa_nodes();
+
+    if (affinity == AFFINITY_SPREAD) return nodes[worker % nodes.size()].cpus;
+
+    std::vector<uint32_t> order;
+    for (const numa_node &node: nodes) order.insert(order.end(), node.cpus.begin(), node.cpus.end());
+    return {order[worker % order.size()]};
+}
+
+thread_pool::thread_pool(uint32_t threads, THREAD_AFFINITY affinity) : pinning(affinity) {
+    uint32_t count = threads > 1 ? threads - 1 : 0;
+    queues.reset(new task_queue[count + 1]);
+
+    workers.reserve(count);
+    for (uint32_t w = 0; w < count; ++w) workers.emplace_back(&thread_pool::worker_loop, this, w);
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker: workers) worker.join();
+}
+
+uint32_t thread_pool::threads() const {
+    return (uint32_t) workers.size() + 1;
+}
+
+THREAD_AFFINITY thread_pool::affinity() const {
+    return pinning;
+}
+
+thread_pool *thread_pool::current() {
+    return current_pool;
+}
+
+int32_t thread_pool::bound_node() {
+    return numa_bound_node();
+}
+
+void thread_pool::submit(batch &tasks, uint32_t count) {
+    if (count == 0) return;
+
+    // Counted first, so `queued` never drops below the tasks in the deques.
+    queued.fetch_add(count);
+    task_queue &queue = queues[current_pool == this ? current_worker : workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (uint32_t index = 0; index < count; ++index) queue.tasks.push_back({&tasks, index});
+    }
+
+    submissions.fetch_add(1);
+
+    // Taking the lock orders the wake-up after a sleeper has checked `queued`.
+    { std::lock_guard<std::mutex> lock(sleep_mutex); }
+    if (count == 1) {
+        wake.notify_one();
+    } else {
+        wake.notify_all();
+    }
+}
+
+void thread_pool::finish(batch &tasks) {
+    if (tasks.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+    // The owner may be asleep in wait(); it destroys the batch once it sees zero.
+    { std::lock_guard<std::mutex> lock(sleep_mutex); }
+    wake.notify_all();
+}
+
+void thread_pool::wait(batch &tasks) {
+    uint32_t home = current_pool == this ? current_worker : (uint32_t) workers.size();
+    int32_t node = numa_bound_node();
+
+    while (tasks.remaining.load(std::memory_order_acquire) > 0) {
+        // Tasks queued now that run_one passes over (other nodes') must not keep it awake.
+        uint64_t seen = submissions.load();
+        if (run_one(home, node)) continue;
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [&]() {
+            return tasks.remaining.load(std::memory_order_acquire) == 0 || submissions.load() != seen;
+        });
+    }
+}
+
+bool thread_pool::run_one(uint32_t home, int32_t node) {
+    if (queued.load() == 0) return false;
+
+    uint32_t count = (uint32_t) workers.size() + 1;
+    task next{};
+    bool found = false;
+
+    // Own deque from the back (the most recent, still cached, tasks), others from the front.
+    for (uint32_t v = 0; v < count && !found; ++v) {
+        task_queue &queue = queues[(home + v) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+
+        auto runnable = [&](const task &t) { return node < 0 || t.owner->node == node; };
+        if (v == 0) {
+            auto it = std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), runnable);
+            if (it == queue.tasks.rend()) continue;
+            next = *it;
+            queue.tasks.erase(std::next(it).base());
+        } else {
+            auto it = std::find_if(queue.tasks.begin(), queue.tasks.end(), runnable);
+            if (it == queue.tasks.end()) continue;
+            next = *it;
+            queue.tasks.erase(it);
+        }
+        queued.fetch_sub(1);
+        found = true;
+    }
+    if (!found) return false;
+
+    if (next.owner->node >= 0 && next.owner->node != numa_bound_node()) {
+        numa_binding binding((uint32_t) next.owner->node);
+        next.owner->call(next.owner->context, next.index);
+    } else {
+        next.owner->call(next.owner->context, next.index);
+    }
+    finish(*next.owner);
+    return true;
+}
+
+void thread_pool::worker_loop(uint32_t index) {
+    current_pool = this;
+    current_worker = index;
+    if (pinning != AFFINITY_NONE) pin_thread(worker_cpus(index, pinning));
+
+    while (true) {
+        while (run_one(index, -1)) {}
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [&]() { return stopping || queued.load() > 0; });
+        if (stopping) return;
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef SORTING_ALGORITHMS_THREAD_POOL_H
+#define SORTING_ALGORITHMS_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// How pool workers are pinned to CPUs:
+//   AFFINITY_NONE     the scheduler places them
+//   AFFINITY_COMPACT  worker i on the i-th CPU, filling one NUMA node before the next
+//   AFFINITY_SPREAD   workers round-robin over the NUMA nodes, each on its node's CPUs
+enum THREAD_AFFINITY {
+    AFFINITY_NONE,
+    AFFINITY_COMPACT,
+    AFFINITY_SPREAD,
+    THREAD_AFFINITY_COUNT
+};
+
+extern const char *THREAD_AFFINITY_IDS[];
+
+// Returns false if the id is unknown.
+bool parse_thread_affinity(const char *id, THREAD_AFFINITY &affinity);
+
+// A fixed set of worker threads that run batches of indexed tasks. Every worker has a
+// deque: it pushes the tasks of its own batches to the back and pops from the back,
+// while idle threads steal from the front of the others. Tasks submitted from outside
+// go to a shared deque. A thread waiting for its batch runs queued tasks meanwhile, so
+// batches may be nested inside tasks without tying up workers. A batch submitted under
+// a numa_binding keeps its node: each of its tasks runs bound to that node, whichever
+// thread picks it up, and a thread waiting under a binding only runs tasks of its node.
+class thread_pool {
+public:
+    // `threads` counts the submitting thread, which always works on its own batches,
+    // so the pool starts threads - 1 workers.
+    thread_pool(uint32_t threads, THREAD_AFFINITY affinity);
+    ~thread_pool();
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    uint32_t threads() const;
+    THREAD_AFFINITY affinity() const;
+
+    // The pool whose worker is the calling thread, or nullptr.
+    static thread_pool *current();
+
+    // Runs job(index) for index in [0, count), the last one on the calling thread, and
+    // returns once all of them have finished. Tasks must not wait for each other.
+    template<typename JOB>
+    void run(uint32_t count, JOB &job) {
+        if (count == 0) return;
+        if (workers.empty()) {
+            for (uint32_t index = 0; index < count; ++index) job(index);
+            return;
+        }
+
+        batch tasks;
+        tasks.call = [](void *context, uint32_t index) { (*(JOB *) context)(index); };
+        tasks.context = &job;
+        tasks.remaining.store(count, std::memory_order_relaxed);
+        tasks.node = bound_node();
+
+        submit(tasks, count - 1);
+        job(count - 1);
+        finish(tasks);
+        wait(tasks);
+    }
+
+private:
+    struct batch {
+        void (*call)(void *context, uint32_t index);
+        void *context;
+        std::atomic<uint32_t> remaining;
+        // numa_bound_node() of the submitting thread.
+        int32_t node;
+    };
+
+    struct task {
+        batch *owner;
+        uint32_t index;
+    };
+
+    struct task_queue {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    static int32_t bound_node();
+
+    void submit(batch &tasks, uint32_t count);
+    void finish(batch &tasks);
+    void wait(batch &tasks);
+    // Runs a queued task, only one of a batch bound to `node` unless it is -1.
+    bool run_one(uint32_t home, int32_t node);
+    void worker_loop(uint32_t index);
+
+    THREAD_AFFINITY pinning;
+    // One per worker, then the shared one.
+    std::unique_ptr<task_queue[]> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<uint32_t> queued{0};
+    // Counts submitted batches, so that a waiter can sleep until new tasks arrive.
+    std::atomic<uint64_t> submissions{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif //SORTING_ALGORITHMS_THREAD_POOL_H
@@ -0,0 +1,47 @@
+#ifndef SORTING_ALGORITHMS_TRIPLE_BUFFER_H
+#define SORTING_ALGORITHMS_TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Single producer / single consumer triple buffer. The producer fills back() and
+// publishes it with one atomic exchange; the consumer picks up the latest complete
+// buffer with another. Neither side ever waits for the other.
+template<typename T>
+class triple_buffer {
+public:
+    T &back() {
+        return buffers[back_index];
+    }
+
+    void publish() {
+        uint8_t previous = middle.exchange(back_index | FRESH, std::memory_order_acq_rel);
+        back_index = previous & INDEX_MASK;
+    }
+
+    // Returns true if a newer buffer than the current front() was picked up.
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+
+        uint8_t previous = middle.exchange(front_index, std::memory_order_acq_rel);
+        front_index = previous & INDEX_MASK;
+        return true;
+    }
+
+    const T &front() const {
+        return buffers[front_index];
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    T buffers[3];
+
+    // Producer, shared and consumer indices live on separate cache lines.
+    alignas(64) uint8_t back_index = 0;
+    alignas(64) std::atomic<uint8_t> middle{1};
+    alignas(64) uint8_t front_index = 2;
+};
+
+#endif //SORTING_ALGORITHMS_TRIPLE_BUFFER_H
@@ -0,0 +1,500 @@
+#include "visual_algorithms.h"
+
+#include "selection_algorithms.h"
+#include "sorting_algorithms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+sort_generator bubble_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token) {
+    for (uint32_t i = 0; i + 1 < size; ++i) {
+        for (uint32_t j = 0; j < size - i - 1; ++j) {
+            co_yield {SORT_EVENT::COMPARE, j, j + 1};
+            if (token.requested()) co_return;
+
+            if (arr[j] > arr[j + 1]) {
+                std::swap(arr[j], arr[j + 1]);
+
+                co_yield {SORT_EVENT::SWAP, j, j + 1};
+                if (token.requested()) co_return;
+            }
+        }
+    }
+}
+
+sort_generator merge_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token) {
+    struct frame {
+        uint32_t l, r;
+        bool split;
+    };
+
+    // Top-down order with the recursion on an explicit stack keeps the whole
+    // sort in a single coroutine frame.
+    std::vector<frame> stack;
+    std::vector<uint32_t> scratch(size);
+
+    if (size > 1) stack.push_back({0, size - 1, false});
+
+    while (!stack.empty()) {
+        frame &top = stack.back();
+        uint32_t l = top.l, r = top.r, m = l + (r - l) / 2;
+
+        if (l >= r) {
+            stack.pop_back();
+            continue;
+        }
+
+        if (!top.split) {
+            top.split = true;
+            stack.push_back({m + 1, r, false});
+            stack.push_back({l, m, false});
+            continue;
+        }
+
+        stack.pop_back();
+
+        std::copy(arr + l, arr + r + 1, scratch.begin() + l);
+
+        uint32_t i = l, j = m + 1, k = l;
+        while (i <= m && j <= r) {
+            co_yield {SORT_EVENT::COMPARE, i, j};
+
+            if (scratch[i] <= scratch[j]) {
+                arr[k] = scratch[i++];
+            } else {
+                arr[k] = scratch[j++];
+            }
+
+            co_yield {SORT_EVENT::WRITE, k, 0};
+            ++k;
+
+            // The tails below are still copied, so a cancelled merge leaves a permutation.
+            if (token.requested()) break;
+        }
+
+        while (i <= m) arr[k++] = scratch[i++];
+        while (j <= r) arr[k++] = scratch[j++];
+
+        if (token.requested()) co_return;
+    }
+}
+
+// Insertion sort of arr[begin, begin + size).
+static sort_generator insertion_sort_visual(uint32_t *arr, uint32_t begin, uint32_t size, const cancel_token &token) {
+    uint32_t *part = arr + begin;
+
+    for (uint32_t i = 1; i < size; ++i) {
+        for (uint32_t j = i; j > 0; --j) {
+            co_yield {SORT_EVENT::COMPARE, begin + j - 1, begin + j};
+            if (token.requested()) co_return;
+            if (!(part[j] < part[j - 1])) break;
+
+            std::swap(part[j], part[j - 1]);
+            co_yield {SORT_EVENT::SWAP, begin + j - 1, begin + j};
+            if (token.requested()) co_return;
+        }
+    }
+}
+
+// Same median-of-three Hoare partition as quick_partition over arr[begin, begin + size),
+// which must hold at least 3 keys. Compares are shown between the two scanning indices;
+// the returned split is stored in `split`.
+static sort_generator partition_visual(uint32_t *arr, uint32_t begin, uint32_t size, uint32_t &split,
+                                       const cancel_token &token) {
+    uint32_t *part = arr + begin;
+    uint32_t mid = size / 2, last = size - 1;
+    uint32_t samples[][2] = {{0, mid}, {mid, last}, {0, mid}};
+
+    for (auto &sample: samples) {
+        co_yield {SORT_EVENT::COMPARE, begin + sample[0], begin + sample[1]};
+        if (token.requested()) co_return;
+
+        if (part[sample[1]] < part[sample[0]]) {
+            std::swap(part[sample[0]], part[sample[1]]);
+            co_yield {SORT_EVENT::SWAP, begin + sample[0], begin + sample[1]};
+            if (token.requested()) co_return;
+        }
+    }
+
+    uint32_t pivot = part[mid];
+    uint32_t i = 0, j = last;
+
+    while (true) {
+        do {
+            ++i;
+            co_yield {SORT_EVENT::COMPARE, begin + i, begin + j};
+            if (token.requested()) co_return;
+        } while (part[i] < pivot);
+
+        do {
+            --j;
+            co_yield {SORT_EVENT::COMPARE, begin + j, begin + i};
+            if (token.requested()) co_return;
+        } while (pivot < part[j]);
+
+        if (i >= j) break;
+
+        std::swap(part[i], part[j]);
+        co_yield {SORT_EVENT::SWAP, begin + i, begin + j};
+        if (token.requested()) co_return;
+    }
+
+    split = j + 1;
+}
+
+// Helpers are generators too; their events are forwarded one by one.
+sort_generator quick_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token) {
+    struct range {
+        uint32_t begin, size;
+    };
+
+    std::vector<range> stack;
+    if (size > 1) stack.push_back({0, size});
+
+    while (!stack.empty()) {
+        range top = stack.back();
+        stack.pop_back();
+
+        if (top.size <= QUICK_SORT_CUTOFF) {
+            sort_generator insertion = insertion_sort_visual(arr, top.begin, top.size, token);
+            while (insertion.next()) co_yield insertion.value();
+            if (token.requested()) co_return;
+            continue;
+        }
+
+        uint32_t split = 0;
+        sort_generator partition = partition_visual(arr, top.begin, top.size, split, token);
+        while (partition.next()) co_yield partition.value();
+        if (token.requested()) co_return;
+
+        stack.push_back({top.begin + split, top.size - split});
+        stack.push_back({top.begin, split});
+    }
+}
+
+// Each pass scatters into a scratch array and writes it back in order, so the array
+// shows the keys grouped by the current digit after every pass.
+sort_generator radix_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token) {
+    std::vector<uint32_t> scratch(size);
+
+    for (uint32_t pass = 0; pass < RADIX_PASSES && size > 1; ++pass) {
+        uint32_t shift = pass * RADIX_BITS;
+        uint32_t offsets[RADIX_BUCKETS] = {};
+
+        for (uint32_t i = 0; i < size; ++i) ++offsets[(arr[i] >> shift) & (RADIX_BUCKETS - 1)];
+        if (offsets[(arr[0] >> shift) & (RADIX_BUCKETS - 1)] == size) continue;
+
+        uint32_t sum = 0;
+        for (uint32_t &offset: offsets) {
+            uint32_t count = offset;
+            offset = sum;
+            sum += count;
+        }
+
+        for (uint32_t i = 0; i < size; ++i) scratch[offsets[(arr[i] >> shift) & (RADIX_BUCKETS - 1)]++] = arr[i];
+
+        // A cancelled pass still copies the rest of scratch back, without events, so the
+        // array always ends holding a whole pass.
+        for (uint32_t i = 0; i < size; ++i) {
+            if (token.requested()) {
+                std::copy(scratch.begin() + i, scratch.end(), arr + i);
+                co_return;
+            }
+
+            arr[i] = scratch[i];
+            co_yield {SORT_EVENT::WRITE, i, 0};
+        }
+    }
+}
+
+// One level per range: splitters from a sorted sample, every key of the range
+// classified and written back in bucket order, then each bucket handled the same way
+// and short ones insertion sorted. The kernel's in-place block permutation is shown as
+// a plain scatter through scratch, and 16 buckets instead of 256 keep the levels
+// visible. Keys equal to a splitter always get their own finished bucket.
+sort_generator sample_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token) {
+    constexpr uint32_t BUCKETS = 16;
+    constexpr uint32_t OVERSAMPLING = 3;
+
+    struct range {
+        uint32_t begin, size;
+    };
+
+    std::vector<range> stack;
+    if (size > 1) stack.push_back({0, size});
+    std::vector<uint32_t> scratch(size);
+    std::mt19937 rng(size);
+
+    while (!stack.empty()) {
+        range top = stack.back();
+        stack.pop_back();
+
+        if (top.size <= QUICK_SORT_CUTOFF) {
+            sort_generator insertion = insertion_sort_visual(arr, top.begin, top.size, token);
+            while (insertion.next()) co_yield insertion.value();
+            if (token.requested()) co_return;
+            continue;
+        }
+
+        std::vector<uint32_t> sample(OVERSAMPLING * BUCKETS - 1);
+        for (uint32_t &key: sample) key = arr[top.begin + rng() % top.size];
+        std::sort(sample.begin(), sample.end());
+
+        std::vector<uint32_t> splitters;
+        for (uint32_t s = 1; s < BUCKETS; ++s) {
+            uint32_t candidate = sample[s * OVERSAMPLING - 1];
+            if (splitters.empty() || splitters.back() < candidate) splitters.push_back(candidate);
+        }
+
+        // Bucket b holds (splitters[b - 1], splitters[b]); class 2b + 1 holds splitters[b] itself.
+        auto classify = [&](uint32_t key) {
+            uint32_t bucket = (uint32_t) (std::lower_bound(splitters.begin(), splitters.end(), key) - splitters.begin());
+            return 2 * bucket + (bucket < splitters.size() && splitters[bucket] == key);
+        };
+
+        uint32_t starts[2 * BUCKETS + 1] = {};
+        for (uint32_t i = top.begin; i < top.begin + top.size; ++i) ++starts[classify(arr[i]) + 1];
+        for (uint32_t c = 0; c < 2 * BUCKETS; ++c) starts[c + 1] += starts[c];
+
+        uint32_t offsets[2 * BUCKETS];
+        std::copy(starts, starts + 2 * BUCKETS, offsets);
+        for (uint32_t i = top.begin; i < top.begin + top.size; ++i) scratch[top.begin + offsets[classify(arr[i])]++] = arr[i];
+
+        // As in radix_sort_visual, a cancelled level still writes the whole range back.
+        for (uint32_t i = top.begin; i < top.begin + top.size; ++i) {
+            if (token.requested()) {
+                std::copy(scratch.begin() + i, scratch.begin() + top.begin + top.size, arr + i);
+                co_return;
+            }
+
+            arr[i] = scratch[i];
+            co_yield {SORT_EVENT::WRITE, i, 0};
+        }
+
+        for (uint32_t c = 2 * BUCKETS; c-- > 0;) {
+            uint32_t length = starts[c + 1] - starts[c];
+            if (c % 2 == 0 && length > 1) stack.push_back({top.begin + starts[c], length});
+        }
+    }
+}
+
+sort_generator introselect_visual(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token) {
+    if (k >= size) co_return;
+
+    uint32_t begin = 0, length = size;
+    while (length > QUICK_SORT_CUTOFF) {
+        uint32_t split = 0;
+        sort_generator partition = partition_visual(arr, begin, length, split, token);
+        while (partition.next()) co_yield partition.value();
+        if (token.requested()) co_return;
+
+        if (k < begin + split) {
+            length = split;
+        } else {
+            begin += split;
+            length -= split;
+        }
+    }
+
+    sort_generator insertion = insertion_sort_visual(arr, begin, length, token);
+    while (insertion.next()) co_yield insertion.value();
+}
+
+// Sampling only starts above FLOYD_RIVEST_SAMPLE_LIMIT keys, like the kernel; smaller
+// arrays show the partitioning scheme alone. Recursion into the sample is kept on a stack
+// of ranges that all select the same k.
+sort_generator floyd_rivest_visual(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token) {
+    struct range {
+        int64_t left, right;
+        bool sampled;
+    };
+
+    std::vector<range> stack;
+    if (k < size) stack.push_back({0, (int64_t) size - 1, false});
+
+    while (!stack.empty()) {
+        int64_t left = stack.back().left, right = stack.back().right;
+        if (right <= left) {
+            stack.pop_back();
+            continue;
+        }
+
+        if (!stack.back().sampled && right - left > FLOYD_RIVEST_SAMPLE_LIMIT) {
+            double n = (double) (right - left + 1);
+            double i = (double) (k - left + 1);
+            double z = std::log(n);
+            double s = 0.5 * std::exp(2 * z / 3);
+            double sd = 0.5 * std::sqrt(z * s * (n - s) / n) * (i < n / 2 ? -1 : 1);
+
+            stack.back().sampled = true;
+            stack.push_back({
+                    std::max(left, (int64_t) ((double) k - i * s / n + sd)),
+                    std::min(right, (int64_t) ((double) k + (n - i) * s / n + sd)),
+                    false
+            });
+            continue;
+        }
+
+        uint32_t pivot = arr[k];
+        int64_t i = left, j = right;
+
+        std::swap(arr[left], arr[k]);
+        co_yield {SORT_EVENT::SWAP, (uint32_t) left, k};
+        if (token.requested()) co_return;
+
+        co_yield {SORT_EVENT::COMPARE, (uint32_t) left, (uint32_t) right};
+        if (token.requested()) co_return;
+        if (pivot < arr[right]) {
+            std::swap(arr[right], arr[left]);
+            co_yield {SORT_EVENT::SWAP, (uint32_t) left, (uint32_t) right};
+            if (token.requested()) co_return;
+        }
+
+        while (i < j) {
+            std::swap(arr[i], arr[j]);
+            co_yield {SORT_EVENT::SWAP, (uint32_t) i, (uint32_t) j};
+            if (token.requested()) co_return;
+            ++i;
+            --j;
+
+            while (true) {
+                co_yield {SORT_EVENT::COMPARE, (uint32_t) i, (uint32_t) j};
+                if (token.requested()) co_return;
+                if (!(arr[i] < pivot)) break;
+                ++i;
+            }
+
+            while (true) {
+                co_yield {SORT_EVENT::COMPARE, (uint32_t) j, (uint32_t) i};
+                if (token.requested()) co_return;
+                if (!(pivot < arr[j])) break;
+                --j;
+            }
+        }
+
+        if (!(arr[left] < pivot)) {
+            std::swap(arr[left], arr[j]);
+            co_yield {SORT_EVENT::SWAP, (uint32_t) left, (uint32_t) j};
+        } else {
+            ++j;
+            std::swap(arr[j], arr[right]);
+            co_yield {SORT_EVENT::SWAP, (uint32_t) j, (uint32_t) right};
+        }
+        if (token.requested()) co_return;
+
+        range &top = stack.back();
+        top.sampled = false;
+        if (j <= k) top.left = j + 1;
+        if (k <= j) top.right = j - 1;
+    }
+}
+
+static sort_generator sift_down_visual(uint32_t *arr, uint32_t root, uint32_t size, const cancel_token &token) {
+    while (2 * root + 1 < size) {
+        uint32_t child = 2 * root + 1;
+
+        if (child + 1 < size) {
+            co_yield {SORT_EVENT::COMPARE, child, child + 1};
+            if (token.requested()) co_return;
+            if (arr[child] < arr[child + 1]) ++child;
+        }
+
+        co_yield {SORT_EVENT::COMPARE, root, child};
+        if (token.requested()) co_return;
+        if (!(arr[root] < arr[child])) co_return;
+
+        std::swap(arr[root], arr[child]);
+        co_yield {SORT_EVENT::SWAP, root, child};
+        if (token.requested()) co_return;
+        root = child;
+    }
+}
+
+// Max-heap of the first k keys, every later key compared against its root, then the
+// heap sorted in place.
+sort_generator heap_top_k_visual(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token) {
+    k = std::min(k, size);
+
+    for (uint32_t i = k / 2; i-- > 0;) {
+        sort_generator sift = sift_down_visual(arr, i, k, token);
+        while (sift.next()) co_yield sift.value();
+        if (token.requested()) co_return;
+    }
+
+    for (uint32_t i = k; i < size && k > 0; ++i) {
+        co_yield {SORT_EVENT::COMPARE, i, 0};
+        if (token.requested()) co_return;
+        if (!(arr[i] < arr[0])) continue;
+
+        std::swap(arr[0], arr[i]);
+        co_yield {SORT_EVENT::SWAP, 0, i};
+        if (token.requested()) co_return;
+
+        sort_generator sift = sift_down_visual(arr, 0, k, token);
+        while (sift.next()) co_yield sift.value();
+        if (token.requested()) co_return;
+    }
+
+    for (uint32_t end = k; end > 1; --end) {
+        std::swap(arr[0], arr[end - 1]);
+        co_yield {SORT_EVENT::SWAP, 0, end - 1};
+        if (token.requested()) co_return;
+
+        sort_generator sift = sift_down_visual(arr, 0, end - 1, token);
+        while (sift.next()) co_yield sift.value();
+        if (token.requested()) co_return;
+    }
+}
+
+// Only the swaps of each digit's three-way partition are shown; counting is silent.
+sort_generator radix_select_visual(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token) {
+    k = std::min(k, size);
+    if (k == 0) co_return;
+
+    uint32_t lo = 0, hi = size;
+
+    for (uint32_t level = RADIX_PASSES; level-- > 0 && k < hi && hi - lo > 1;) {
+        uint32_t shift = level * RADIX_BITS;
+        uint32_t counts[RADIX_BUCKETS] = {};
+        for (uint32_t i = lo; i < hi; ++i) ++counts[(arr[i] >> shift) & (RADIX_BUCKETS - 1)];
+
+        uint32_t bucket = 0, below = lo;
+        while (below + counts[bucket] <= k) below += counts[bucket++];
+
+        uint32_t less = lo, i = lo, greater = hi;
+        while (i < greater) {
+            uint32_t digit = (arr[i] >> shift) & (RADIX_BUCKETS - 1);
+
+            if (digit < bucket) {
+                std::swap(arr[less], arr[i]);
+                co_yield {SORT_EVENT::SWAP, less++, i++};
+            } else if (digit > bucket) {
+                std::swap(arr[i], arr[--greater]);
+                co_yield {SORT_EVENT::SWAP, i, greater};
+            } else {
+                ++i;
+                continue;
+            }
+            if (token.requested()) co_return;
+        }
+
+        lo = less;
+        hi = greater;
+    }
+
+    sort_generator sort = radix_sort_visual(arr, k, token);
+    while (sort.next()) co_yield sort.value();
+}
+
+sort_generator shuffle_visual(uint32_t *arr, uint32_t size, std::mt19937 &rng, const cancel_token &token) {
+    for (uint32_t i = size > 0 ? size - 1 : 0; i > 0; --i) {
+        std::uniform_int_distribution<uint32_t> distribution(0, i);
+        uint32_t j = distribution(rng);
+
+        std::swap(arr[i], arr[j]);
+
+        co_yield {SORT_EVENT::SWAP, i, j};
+        if (token.requested()) co_return;
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SORTING_ALGORITHMS_VISUAL_ALGORITHMS_H
+#define SORTING_ALGORITHMS_VISUAL_ALGORITHMS_H
+
+#include "cancel_token.h"
+#include "generator.h"
+
+#include <cstdint>
+#include <random>
+
+enum SORT_EVENT {
+    COMPARE,
+    SWAP,
+    WRITE
+};
+
+// One visible operation. WRITE only uses a.
+struct sort_event {
+    SORT_EVENT type;
+    uint32_t a, b;
+};
+
+using sort_generator = generator<sort_event>;
+
+// Visual algorithms mutate the array themselves and co_yield an event after every
+// operation; coloring and pacing are left to whoever drives the generator. Once
+// the token is cancelled they stop yielding and return with the array left a
+// permutation of its input, so a cancelled generator is drained, not destroyed.
+sort_generator bubble_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token);
+sort_generator merge_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token);
+sort_generator quick_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token);
+sort_generator radix_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token);
+sort_generator sample_sort_visual(uint32_t *arr, uint32_t size, const cancel_token &token);
+
+// Partial sorts; k means what it means for the matching kernel in selection_algorithms.h.
+sort_generator introselect_visual(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token);
+sort_generator floyd_rivest_visual(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token);
+sort_generator heap_top_k_visual(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token);
+sort_generator radix_select_visual(uint32_t *arr, uint32_t size, uint32_t k, const cancel_token &token);
+
+sort_generator shuffle_visual(uint32_t *arr, uint32_t size, std::mt19937 &rng, const cancel_token &token);
+
+#endif //SORTING_ALGORITHMS_VISUAL_ALGORITHMS_H
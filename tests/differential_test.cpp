@@ -0,0 +1,1177 @@
+#include "algorithm_registry.h"
+#include "array_generators.h"
+#include "benchmark_baseline.h"
+#include "cancel_token.h"
+#include "cpu_dispatch.h"
+#include "dataset_io.h"
+#include "external_sort.h"
+#include "key_value_sort.h"
+#include "numa.h"
+#include "operation_counters.h"
+#include "pacer.h"
+#include "parallel.h"
+#include "sample_sort.h"
+#include "segmented_sort.h"
+#include "selection_algorithms.h"
+#include "sort_verifier.h"
+#include "sorting_algorithms.h"
+#include "triple_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+// Runs every registered engine, full and partial sorts, against std::sort on random
+// sizes and distributions.
+// Usage: differential_test [cases] [seed]
+
+// Visual generators yield once per operation, so they are only replayed on small inputs.
+const uint32_t VISUAL_SIZE_LIMIT = 1024;
+const uint32_t MAX_RANDOM_SIZE = 1024;
+
+// Sizes every engine must handle regardless of the random draw.
+const uint32_t FIXED_SIZES[] = {0, 1, 2, 3, 15, 16, 17, 64, 1000};
+// Large enough for merges to leave the stack buffer; run once, bubble sort is quadratic.
+const uint32_t LARGE_SIZE = 20000;
+// Parallel engines split work across threads from here on; they are run at each of
+// PARALLEL_THREADS whatever the machine has, so the block permutation sees contention.
+const uint32_t PARALLEL_SIZE = 300000;
+const uint32_t PARALLEL_THREADS[] = {1, 2, 3, 8};
+
+static uint32_t failures = 0;
+
+static void report(const sorting_algorithm &algorithm, const char *variant, DISTRIBUTION distribution, uint32_t size,
+                   uint32_t case_seed, const char *problem) {
+    ++failures;
+    fprintf(
+            stderr,
+            "FAIL %s (%s) %s n=%u seed=%u: %s\n",
+            algorithm.id,
+            variant,
+            DISTRIBUTION_IDS[distribution],
+            size,
+            case_seed,
+            problem
+    );
+}
+
+static void check_output(const sorting_algorithm &algorithm, const char *variant, DISTRIBUTION distribution,
+                         uint32_t case_seed, const std::vector<uint32_t> &input, const std::vector<uint32_t> &output,
+                         const std::vector<uint32_t> &expected) {
+    if (output == expected) return;
+
+    uint32_t size = (uint32_t) input.size();
+    verify_result result = verify_sort(input.data(), output.data(), size);
+
+    char problem[96];
+    if (!result.sorted) {
+        snprintf(problem, sizeof(problem), "unsorted at index %u", result.first_unsorted);
+    } else if (!result.permutation) {
+        snprintf(problem, sizeof(problem), "output is not a permutation of the input");
+    } else {
+        snprintf(problem, sizeof(problem), "differs from std::sort");
+    }
+    report(algorithm, variant, distribution, size, case_seed, problem);
+}
+
+static void run_case(const sorting_algorithm &algorithm, DISTRIBUTION distribution, uint32_t size, uint32_t case_seed) {
+    std::mt19937 rng(case_seed);
+    std::vector<uint32_t> input(size);
+    generate_array(input.data(), size, distribution, rng);
+
+    std::vector<uint32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    cancel_token token;
+
+    // Vectorized kernels are checked at every instruction set level the CPU supports; the
+    // checks after the loop run at the level the test started on.
+    std::vector<uint32_t> output;
+    CPU_ISA initial_isa = active_isa();
+    for (int isa = detect_isa(); isa >= CPU_ISA::GENERIC; --isa) {
+        char variant[32];
+        if (algorithm.parallel) {
+            snprintf(variant, sizeof(variant), "sort/%s/%ut", CPU_ISA_IDS[isa], active_threads());
+        } else {
+            snprintf(variant, sizeof(variant), "sort/%s", CPU_ISA_IDS[isa]);
+        }
+
+        set_isa((CPU_ISA) isa);
+        output = input;
+        algorithm.sort(output.data(), size, token);
+        check_output(algorithm, variant, distribution, case_seed, input, output, expected);
+    }
+    set_isa(initial_isa);
+
+    operation_counters counters;
+    output = input;
+    algorithm.sort_counted(output.data(), size, token, counters);
+    check_output(algorithm, "sort_counted", distribution, case_seed, input, output, expected);
+
+    if (algorithm.visual && size <= VISUAL_SIZE_LIMIT) {
+        output = input;
+        sort_generator visual = algorithm.visual(output.data(), size, token);
+        while (visual.next()) {}
+        check_output(algorithm, "visual", distribution, case_seed, input, output, expected);
+    }
+
+    if (algorithm.sort_tagged) {
+        std::vector<tagged_key> tagged(size);
+        tag_keys(input.data(), tagged.data(), size, 64);
+        algorithm.sort_tagged(tagged.data(), size, token);
+
+        bool sorted = std::is_sorted(tagged.begin(), tagged.end());
+        if (!sorted) {
+            report(algorithm, "sort_tagged", distribution, size, case_seed, "tagged keys are not sorted");
+        } else if (algorithm.stable && !is_stable_sorted(tagged.data(), size)) {
+            report(algorithm, "sort_tagged", distribution, size, case_seed, "marked stable but reorders equal keys");
+        }
+    }
+
+    // Key-value modes go through sort_packed, so every engine must match a stable argsort.
+    std::vector<uint32_t> expected_indices(size);
+    std::iota(expected_indices.begin(), expected_indices.end(), 0u);
+    std::stable_sort(expected_indices.begin(), expected_indices.end(), [&](uint32_t a, uint32_t b) {
+        return input[a] < input[b];
+    });
+
+    std::vector<uint32_t> indices(size);
+    argsort(algorithm, input.data(), indices.data(), size, token);
+    if (indices != expected_indices) {
+        report(algorithm, "argsort", distribution, size, case_seed, "differs from a stable argsort");
+    }
+
+    std::vector<uint64_t> wide_indices(size);
+    argsort(algorithm, input.data(), wide_indices.data(), size, token);
+    if (!std::equal(wide_indices.begin(), wide_indices.end(), expected_indices.begin())) {
+        report(algorithm, "argsort/64", distribution, size, case_seed, "differs from a stable argsort");
+    }
+
+    std::vector<uint32_t> values(size), expected_values(size);
+    for (uint32_t i = 0; i < size; ++i) values[i] = input[i] * 2654435761u + i;
+    for (uint32_t i = 0; i < size; ++i) expected_values[i] = values[expected_indices[i]];
+
+    output = input;
+    sort_pairs(algorithm, output.data(), values.data(), size, token);
+    if (output != expected || values != expected_values) {
+        report(algorithm, "sort_pairs", distribution, size, case_seed, "keys or values out of place");
+    }
+}
+
+static void check_selection(const selection_algorithm &algorithm, const char *variant, DISTRIBUTION distribution,
+                            uint32_t case_seed, uint32_t k, const std::vector<uint32_t> &input,
+                            const std::vector<uint32_t> &output, const std::vector<uint32_t> &expected) {
+    uint32_t size = (uint32_t) input.size();
+    verify_result result = verify_selection(multiset_checksum(input.data(), size), output.data(), size, k, algorithm.kind);
+
+    bool matches;
+    if (algorithm.kind == SELECTION::NTH_ELEMENT) {
+        matches = k >= size || output[k] == expected[k];
+    } else {
+        matches = std::equal(output.begin(), output.begin() + std::min(k, size), expected.begin());
+    }
+    if (result.ok() && matches) return;
+
+    char problem[96];
+    if (!result.permutation) {
+        snprintf(problem, sizeof(problem), "k=%u: output is not a permutation of the input", k);
+    } else if (!result.sorted) {
+        snprintf(problem, sizeof(problem), "k=%u: broken at index %u", k, result.first_unsorted);
+    } else {
+        snprintf(problem, sizeof(problem), "k=%u: selected keys differ from std::sort", k);
+    }
+
+    ++failures;
+    fprintf(stderr, "FAIL %s (%s) %s n=%u seed=%u: %s\n", algorithm.id, variant, DISTRIBUTION_IDS[distribution], size,
+            case_seed, problem);
+}
+
+static void run_selection_case(const selection_algorithm &algorithm, DISTRIBUTION distribution, uint32_t size,
+                               uint32_t case_seed) {
+    std::mt19937 rng(case_seed);
+    std::vector<uint32_t> input(size);
+    generate_array(input.data(), size, distribution, rng);
+
+    std::vector<uint32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    // Both ends, the median and one random rank; k == size is only meaningful for top-k.
+    uint32_t ks[] = {0, 1, size / 2, size ? size - 1 : 0, size, std::uniform_int_distribution<uint32_t>(0, size)(rng)};
+
+    cancel_token token;
+    std::vector<uint32_t> output;
+
+    CPU_ISA initial_isa = active_isa();
+    for (uint32_t k: ks) {
+        for (int isa = detect_isa(); isa >= CPU_ISA::GENERIC; --isa) {
+            char variant[32];
+            snprintf(variant, sizeof(variant), "select/%s", CPU_ISA_IDS[isa]);
+
+            set_isa((CPU_ISA) isa);
+            output = input;
+            algorithm.select(output.data(), size, k, token);
+            check_selection(algorithm, variant, distribution, case_seed, k, input, output, expected);
+        }
+        set_isa(initial_isa);
+
+        operation_counters counters;
+        output = input;
+        algorithm.select_counted(output.data(), size, k, token, counters);
+        check_selection(algorithm, "select_counted", distribution, case_seed, k, input, output, expected);
+
+        if (algorithm.visual && size <= VISUAL_SIZE_LIMIT) {
+            output = input;
+            sort_generator visual = algorithm.visual(output.data(), size, k, token);
+            while (visual.next()) {}
+            check_selection(algorithm, "visual", distribution, case_seed, k, input, output, expected);
+        }
+    }
+}
+
+// numa_sort's exchange only runs with several nodes, so it is checked here with the
+// node count given explicitly; on a one-node machine every binding is to that node.
+static void run_numa_case(DISTRIBUTION distribution, uint32_t size, uint32_t nodes, uint32_t threads,
+                          uint32_t case_seed) {
+    std::mt19937 rng(case_seed);
+    std::vector<uint32_t> input(size);
+    generate_array(input.data(), size, distribution, rng);
+
+    std::vector<uint32_t> expected = input, output = input;
+    std::sort(expected.begin(), expected.end());
+
+    cancel_token token;
+    numa_sort(output.data(), size, nodes, threads, token, [](uint32_t *slice, uint32_t length, uint32_t) {
+        std::sort(slice, slice + length);
+    });
+
+    if (output != expected) {
+        ++failures;
+        fprintf(stderr, "FAIL numa_sort %s n=%u nodes=%u threads=%u seed=%u\n", DISTRIBUTION_IDS[distribution], size,
+                nodes, threads, case_seed);
+    }
+}
+
+// Work nested in a node's sort must stay on that node: every task of a batch submitted
+// by the sort callback runs bound to the slice's node, on a subset of its CPUs, whichever
+// pool thread picks it up.
+static void run_numa_binding_case(uint32_t nodes, uint32_t threads) {
+    const uint32_t size = PARALLEL_SIZE, NESTED = 8;
+    std::vector<uint32_t> arr(size);
+    std::iota(arr.begin(), arr.end(), 0u);
+    std::reverse(arr.begin(), arr.end());
+
+    set_active_threads(threads);
+    std::atomic<uint32_t> misplaced(0);
+
+    cancel_token token;
+    numa_sort(arr.data(), size, nodes, threads, token, [&](uint32_t *slice, uint32_t length, uint32_t) {
+        uint32_t node = 0;
+        while (numa_slice_begin(size, node, nodes) != (uint32_t) (slice - arr.data())) ++node;
+        const std::vector<uint32_t> &cpus = numa_nodes()[node % numa_nodes().size()].cpus;
+
+        run_parallel(NESTED, [&](uint32_t part) {
+            if (numa_bound_node() != (int32_t) node) ++misplaced;
+#if defined(__linux__)
+            cpu_set_t mask;
+            if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+                for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &mask) && std::find(cpus.begin(), cpus.end(), cpu) == cpus.end()) {
+                        ++misplaced;
+                        break;
+                    }
+                }
+            }
+#endif
+            std::sort(slice + numa_slice_begin(length, part, NESTED), slice + numa_slice_begin(length, part + 1, NESTED));
+        });
+        std::sort(slice, slice + length);
+    });
+    set_active_threads(0);
+
+    if (misplaced.load() || !std::is_sorted(arr.begin(), arr.end())) {
+        ++failures;
+        fprintf(stderr, "FAIL numa_sort binding nodes=%u threads=%u: %u nested tasks off their node\n", nodes, threads,
+                misplaced.load());
+    }
+}
+
+// The shared pool under load: several threads submitting at once, one of them with
+// batches nested in pool tasks (numa_sort over sample sort), and workers pinned.
+static void run_pool_case(THREAD_AFFINITY affinity, uint32_t threads, uint32_t case_seed) {
+    const uint32_t SUBMITTERS = 3;
+
+    set_thread_affinity(affinity);
+    set_active_threads(threads);
+
+    std::vector<std::vector<uint32_t>> outputs(SUBMITTERS), expected(SUBMITTERS);
+    for (uint32_t s = 0; s < SUBMITTERS; ++s) {
+        std::mt19937 rng(case_seed + s);
+        outputs[s].resize(PARALLEL_SIZE);
+        generate_array(outputs[s].data(), PARALLEL_SIZE, (DISTRIBUTION) (s % DISTRIBUTION_COUNT), rng);
+        expected[s] = outputs[s];
+        std::sort(expected[s].begin(), expected[s].end());
+    }
+
+    std::vector<std::thread> submitters;
+    for (uint32_t s = 0; s < SUBMITTERS; ++s) {
+        submitters.emplace_back([&, s]() {
+            cancel_token token;
+            no_counters counters;
+            if (s == 0) {
+                numa_sort(outputs[s].data(), PARALLEL_SIZE, 2, threads, token,
+                          [&](uint32_t *slice, uint32_t length, uint32_t slice_threads) {
+                              sample_sort_algorithm(slice, length, slice_threads, token, counters);
+                          });
+            } else {
+                sample_sort_algorithm(outputs[s].data(), PARALLEL_SIZE, threads, token, counters);
+            }
+        });
+    }
+    for (std::thread &submitter: submitters) submitter.join();
+
+    for (uint32_t s = 0; s < SUBMITTERS; ++s) {
+        if (outputs[s] == expected[s]) continue;
+        ++failures;
+        fprintf(stderr, "FAIL thread pool affinity=%s threads=%u submitter=%u seed=%u\n",
+                THREAD_AFFINITY_IDS[affinity], threads, s, case_seed);
+    }
+
+    set_active_threads(0);
+    set_thread_affinity(AFFINITY_NONE);
+}
+
+// Every segment must come out sorted and stay within its bounds, at each instruction
+// set level and thread count.
+static void run_segmented_case(SEGMENT_DISTRIBUTION segments, DISTRIBUTION distribution, uint32_t size,
+                               uint32_t case_seed) {
+    std::mt19937 rng(case_seed);
+    std::vector<uint32_t> input(size);
+    generate_array(input.data(), size, distribution, rng);
+    std::vector<uint32_t> offsets = generate_segment_offsets(size, segments, rng);
+
+    std::vector<uint32_t> expected = input;
+    for (uint32_t s = 0; s + 1 < offsets.size(); ++s) {
+        std::sort(expected.begin() + offsets[s], expected.begin() + offsets[s + 1]);
+    }
+
+    cancel_token token;
+    CPU_ISA initial_isa = active_isa();
+    for (int isa = detect_isa(); isa >= CPU_ISA::GENERIC; --isa) {
+        set_isa((CPU_ISA) isa);
+        for (uint32_t threads: PARALLEL_THREADS) {
+            set_active_threads(threads);
+            std::vector<uint32_t> output = input;
+            segmented_sort(output.data(), offsets.data(), (uint32_t) offsets.size() - 1, token);
+            if (output == expected) continue;
+
+            ++failures;
+            fprintf(stderr, "FAIL segmented_sort/%s/%ut %s %s n=%u seed=%u\n", CPU_ISA_IDS[isa], threads,
+                    SEGMENT_DISTRIBUTION_IDS[segments], DISTRIBUTION_IDS[distribution], size, case_seed);
+        }
+    }
+    set_isa(initial_isa);
+    set_active_threads(0);
+}
+
+// The last size is past sort_verifier's PARALLEL_THRESHOLD (1 << 20), so it is split into
+// slices that stop scanning once another thread has found an earlier descent.
+const uint32_t VERIFIER_SIZES[] = {2, 17, 33, 100, 1000, (1 << 21) + 37};
+
+static void check_verifier(const char *problem, uint32_t size, int isa, uint32_t threads, uint32_t position) {
+    ++failures;
+    fprintf(stderr, "FAIL verifier/%s/%ut n=%u at %u: %s\n", CPU_ISA_IDS[isa], threads, size, position, problem);
+}
+
+// Every other case trusts the verifier, so it must also reject broken arrays: a swapped
+// pair at the ends and wherever a vector block, scan block or thread slice starts or ends,
+// several descents at once, and one altered value. Each instruction set level and thread
+// count must also agree with the generic kernels on an unsorted array.
+static void run_verifier_case(uint32_t size, uint32_t case_seed) {
+    std::mt19937 rng(case_seed);
+
+    // Strictly ascending, so every swapped pair is a descent and a value plus one stays sorted.
+    std::vector<uint32_t> sorted(size);
+    uint32_t next = rng() % 4;
+    for (uint32_t &key: sorted) {
+        key = next;
+        next += 1 + rng() % 4;
+    }
+
+    std::vector<uint32_t> shuffled = sorted;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    // The vector loops start at index 1 and take 4, 16 or 32 elements a step.
+    std::vector<uint32_t> positions = {1, 4, 5, 8, 9, 16, 17, 32, 33, 34, size / 2, size - 2, size - 1};
+    for (uint32_t block = 1 << 16; block < size; block += 1 << 16) {
+        positions.push_back(block);
+        positions.push_back(block + 1);
+    }
+    for (uint32_t threads: PARALLEL_THREADS) {
+        for (uint32_t t = 1; t < threads; ++t) {
+            positions.push_back(size / threads * t - 1);
+            positions.push_back(size / threads * t);
+        }
+    }
+    std::sort(positions.begin(), positions.end());
+    positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+    positions.erase(std::remove_if(positions.begin(), positions.end(), [&](uint32_t p) {
+        return p == 0 || p >= size;
+    }), positions.end());
+
+    // Far enough apart that their swaps do not overlap.
+    std::vector<uint32_t> spread;
+    for (uint32_t p: {1u, size / 4, size / 2, size / 4 * 3, size - 1}) {
+        if (p && (spread.empty() || p >= spread.back() + 2)) spread.push_back(p);
+    }
+
+    CPU_ISA initial_isa = active_isa();
+    set_isa(GENERIC);
+    set_active_threads(1);
+    uint64_t checksum = multiset_checksum(sorted.data(), size);
+    uint32_t shuffled_descent = find_unsorted(shuffled.data(), size);
+
+    for (int isa = detect_isa(); isa >= CPU_ISA::GENERIC; --isa) {
+        set_isa((CPU_ISA) isa);
+        for (uint32_t threads: PARALLEL_THREADS) {
+            set_active_threads(threads);
+
+            if (multiset_checksum(shuffled.data(), size) != checksum) {
+                check_verifier("checksum differs from generic", size, isa, threads, 0);
+            }
+            if (find_unsorted(shuffled.data(), size) != shuffled_descent) {
+                check_verifier("descent differs from generic", size, isa, threads, shuffled_descent);
+            }
+
+            verify_result result = verify_sort(checksum, sorted.data(), size);
+            if (!result.ok()) check_verifier("sorted input rejected", size, isa, threads, result.first_unsorted);
+
+            std::vector<uint32_t> broken = sorted;
+            for (uint32_t p: positions) {
+                std::swap(broken[p - 1], broken[p]);
+                result = verify_sort(checksum, broken.data(), size);
+                if (result.sorted || result.first_unsorted != p || !result.permutation) {
+                    check_verifier(result.sorted ? "swapped pair missed" : result.permutation ?
+                                   "wrong first descent" : "swap changed the checksum", size, isa, threads, p);
+                }
+                std::swap(broken[p - 1], broken[p]);
+            }
+
+            // The first descent must win even when a later slice finds its own sooner.
+            for (uint32_t p: spread) std::swap(broken[p - 1], broken[p]);
+            for (uint32_t p: spread) {
+                if (find_unsorted(broken.data(), size) != p) {
+                    check_verifier("wrong first of several descents", size, isa, threads, p);
+                }
+                std::swap(broken[p - 1], broken[p]);
+            }
+
+            for (uint32_t p: {0u, size / 2, size - 1}) {
+                ++broken[p];
+                result = verify_sort(checksum, broken.data(), size);
+                if (!result.sorted || result.permutation) {
+                    check_verifier(result.sorted ? "altered value missed" : "altered value reported unsorted",
+                                   size, isa, threads, p);
+                }
+                --broken[p];
+            }
+        }
+    }
+    set_isa(initial_isa);
+    set_active_threads(0);
+}
+
+static void write_file(const std::filesystem::path &path, const std::string &content) {
+    FILE *file = fopen(path.string().c_str(), "wb");
+    if (!file) return;
+    fwrite(content.data(), 1, content.size(), file);
+    fclose(file);
+}
+
+// With this little memory a run is a single IO_ALIGNMENT block, so the largest file
+// below makes dozens of runs, merged two at a time in several passes.
+const uint64_t EXTERNAL_MEMORY_BYTES = 16 * 1024;
+const uint64_t EXTERNAL_SIZES[] = {0, 1, 700, 20011};
+
+// io_queue picks its backend from SORTING_IO_BACKEND when constructed; nullptr unsets it.
+static void set_io_backend(const char *backend) {
+#if defined(_WIN32)
+    _putenv_s("SORTING_IO_BACKEND", backend ? backend : "");
+#else
+    if (backend) {
+        setenv("SORTING_IO_BACKEND", backend, 1);
+    } else {
+        unsetenv("SORTING_IO_BACKEND");
+    }
+#endif
+}
+
+// external_sort end to end: a random key file in `dir` sorted through run files and a
+// multi-pass merge must come out byte for byte like std::sort of the same keys. With
+// `threads`, the io_queue is forced onto its thread backend instead of io_uring.
+template<typename T>
+static void run_external_case(const std::filesystem::path &dir, uint64_t size, bool direct, bool threads,
+                              uint32_t case_seed) {
+    ELEMENT_TYPE type = sizeof(T) == 8 ? ELEMENT_TYPE::UINT64 : ELEMENT_TYPE::UINT32;
+    const char *type_id = sizeof(T) == 8 ? "u64" : "u32";
+
+    std::mt19937_64 rng(case_seed);
+    std::uniform_int_distribution<T> keys;
+    std::vector<T> expected(size);
+    for (T &key: expected) key = keys(rng);
+
+    std::string input_path = (dir / "input.bin").string(), output_path = (dir / "output.bin").string();
+    FILE *input = fopen(input_path.c_str(), "wb");
+    bool written = input && (size == 0 || fwrite(expected.data(), sizeof(T), size, input) == size);
+    if (input) fclose(input);
+    std::sort(expected.begin(), expected.end());
+
+    external_sort_settings settings;
+    settings.type = type;
+    settings.memory_bytes = EXTERNAL_MEMORY_BYTES;
+    settings.max_fan_in = 2;
+    settings.direct_io = direct;
+
+    external_sort_stats stats;
+    cancel_token token;
+    const char *problem = nullptr;
+    set_io_backend(threads ? "threads" : nullptr);
+    if (!written) {
+        problem = "cannot write the input";
+    } else if (!external_sort(input_path.c_str(), output_path.c_str(), settings, stats, token)) {
+        problem = "external_sort failed";
+    } else if (threads && strcmp(stats.io_backend, "threads") != 0) {
+        problem = "SORTING_IO_BACKEND=threads ignored";
+    } else {
+        std::vector<T> output(size + 1);
+        FILE *file = fopen(output_path.c_str(), "rb");
+        size_t read = file ? fread(output.data(), sizeof(T), size + 1, file) : 0;
+        if (file) fclose(file);
+
+        if (!file) {
+            problem = "no output file";
+        } else if (read != size || (size && memcmp(output.data(), expected.data(), size * sizeof(T)) != 0)) {
+            problem = "output differs from std::sort";
+        } else if (size * sizeof(T) > 4 * EXTERNAL_MEMORY_BYTES && stats.merge_passes < 2) {
+            problem = "merged in a single pass";
+        }
+    }
+
+    std::filesystem::remove(input_path);
+    std::filesystem::remove(output_path);
+
+    if (problem) {
+        ++failures;
+        fprintf(stderr, "FAIL external_sort %s n=%llu direct_io=%d io=%s seed=%u: %s\n", type_id,
+                (unsigned long long) size, direct, stats.io_backend, case_seed, problem);
+    }
+}
+
+// A key file cut off in the middle of its last key must be rejected, not sorted without
+// it, and must leave neither an output nor run files behind.
+template<typename T>
+static void run_truncated_external_case(const std::filesystem::path &dir, uint64_t size, uint32_t extra_bytes,
+                                        bool direct) {
+    std::string input_path = (dir / "input.bin").string(), output_path = (dir / "output.bin").string();
+    write_file(input_path, std::string(size * sizeof(T) + extra_bytes, '\x5a'));
+
+    external_sort_settings settings;
+    settings.type = sizeof(T) == 8 ? ELEMENT_TYPE::UINT64 : ELEMENT_TYPE::UINT32;
+    settings.memory_bytes = EXTERNAL_MEMORY_BYTES;
+    settings.max_fan_in = 2;
+    settings.direct_io = direct;
+
+    external_sort_stats stats;
+    cancel_token token;
+    const char *problem = nullptr;
+    if (external_sort(input_path.c_str(), output_path.c_str(), settings, stats, token)) {
+        problem = "sorted a truncated file";
+    } else if (std::filesystem::exists(output_path)) {
+        problem = "left an output file";
+    } else if (std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator()) != 1) {
+        problem = "left run files";
+    }
+
+    std::filesystem::remove(input_path);
+    std::filesystem::remove(output_path);
+
+    if (problem) {
+        ++failures;
+        fprintf(stderr, "FAIL external_sort %s n=%llu+%u bytes direct_io=%d: %s\n", sizeof(T) == 8 ? "u64" : "u32",
+                (unsigned long long) size, extra_bytes, direct, problem);
+    }
+}
+
+// Past dataset_io's PARSE_BYTES_PER_THREAD (1 MiB) per thread, text is parsed in slices.
+const size_t DATASET_PARALLEL_BYTES = 3 << 20;
+
+// Loads `path`, which must give `expected` or, if `expected_error` is set, fail with it.
+static void check_dataset(const char *name, const std::filesystem::path &path, const std::vector<uint32_t> &expected,
+                          const char *expected_error) {
+    std::vector<uint32_t> values;
+    std::string error;
+    bool loaded = load_dataset(path.string().c_str(), values, error);
+    std::filesystem::remove(path);
+
+    if (expected_error ? !loaded && error == expected_error : loaded && values == expected) return;
+
+    ++failures;
+    fprintf(stderr, "FAIL dataset %s: %s\n", name,
+            loaded ? (expected_error ? "loaded" : "wrong values") : error.c_str());
+}
+
+static void check_dataset_text(const char *name, const std::filesystem::path &dir, const std::string &text,
+                               const std::vector<uint32_t> &expected, const char *expected_error) {
+    write_file(dir / "keys.csv", text);
+    check_dataset(name, dir / "keys.csv", expected, expected_error);
+}
+
+// save_dataset and load_dataset in both formats, the text parser's header, separator
+// and error handling, and a text file large enough to be parsed by several threads.
+// Returns the number of cases.
+static uint32_t run_dataset_cases(const std::filesystem::path &dir, uint32_t case_seed) {
+    std::mt19937 rng(case_seed);
+    std::vector<uint32_t> keys(10000);
+    generate_array(keys.data(), (uint32_t) keys.size(), DISTRIBUTION::UNIFORM, rng);
+    keys[0] = 0;
+    keys[1] = UINT32_MAX;
+
+    for (const char *name: {"keys.bin", "keys.csv"}) {
+        std::string error;
+        if (!save_dataset((dir / name).string().c_str(), keys.data(), (uint32_t) keys.size(), error)) {
+            ++failures;
+            fprintf(stderr, "FAIL dataset save %s: %s\n", name, error.c_str());
+            continue;
+        }
+        check_dataset(name, dir / name, keys, nullptr);
+    }
+
+    check_dataset_text("header", dir, "key,note\n7,1\n3\n", {7, 1, 3}, nullptr);
+    check_dataset_text("separators", dir, " 5,4;3\t2 1\r\n0\n\n9", {5, 4, 3, 2, 1, 0, 9}, nullptr);
+    check_dataset_text("largest", dir, "4294967295\n", {UINT32_MAX}, nullptr);
+    check_dataset_text("empty", dir, "", {}, nullptr);
+    check_dataset_text("header only", dir, "key\n", {}, nullptr);
+    check_dataset_text("bad token", dir, "key\n1\n2,3x\n4\n", {}, "Unexpected character on line 3");
+    check_dataset_text("negative", dir, "1;-2\n", {}, "Unexpected character on line 1");
+    check_dataset_text("2^32", dir, "1\n2\n4294967296\n", {}, "Value does not fit in 32 bits on line 3");
+    write_file(dir / "keys.bin", "");
+    check_dataset("empty binary", dir / "keys.bin", {}, nullptr);
+    write_file(dir / "keys.bin", "abcdef");
+    check_dataset("odd binary", dir / "keys.bin", {}, "Binary file size is not a multiple of 4 bytes");
+
+    // Random separators, so the slice boundaries land inside numbers and separator runs.
+    const char *SEPARATORS[] = {",", ";", "\t", " ", "\n", "\r\n", ", "};
+    std::uniform_int_distribution<uint32_t> separator(0, 6);
+    std::vector<uint32_t> large;
+    std::string text = "value\n";
+    while (text.size() < DATASET_PARALLEL_BYTES) {
+        large.push_back(rng() >> (rng() % 32));
+        text += std::to_string(large.back());
+        text += SEPARATORS[separator(rng)];
+    }
+
+    set_active_threads(4);
+    check_dataset_text("parallel", dir, text, large, nullptr);
+
+    // A bad token in the last slice must still report its line in the whole file.
+    size_t bad = text.find_first_of("0123456789", text.size() - 1000);
+    text[bad] = 'x';
+    std::string line_error = "Unexpected character on line " +
+                             std::to_string(1 + std::count(text.begin(), text.begin() + (long) bad, '\n'));
+    check_dataset_text("parallel bad token", dir, text, {}, line_error.c_str());
+    set_active_threads(0);
+
+    return 14;
+}
+
+static void check_p(const char *name, const std::vector<double> &baseline, const std::vector<double> &current,
+                    double expected) {
+    double p = mann_whitney_p(baseline, current);
+    if (std::fabs(p - expected) <= 1e-9) return;
+
+    ++failures;
+    fprintf(stderr, "FAIL mann_whitney_p %s: %.12f, expected %.12f\n", name, p, expected);
+}
+
+// The regression gate's U test on both of its paths, and a baseline surviving a save and
+// load, including escaped strings and an entry written before modes existed.
+// Returns the number of cases.
+static uint32_t run_baseline_cases(const std::filesystem::path &dir) {
+    // Every U at least as extreme as a complete separation is one of C(10, 5) orderings.
+    check_p("separated", {1, 2, 3, 4, 5}, {6, 7, 8, 9, 10}, 1.0 / 252);
+    check_p("faster", {6, 7, 8, 9, 10}, {1, 2, 3, 4, 5}, 1);
+    // Counted by enumerating all C(11, 5) splits.
+    check_p("interleaved", {1.0, 2.5, 4, 5.5, 7}, {1.5, 3, 6, 8, 9, 10}, 19.0 / 154);
+    check_p("constant", {3, 3, 3, 3, 3}, {3, 3, 3, 3, 3}, 1);
+    // A tie forces the normal approximation: U = 8, tie-corrected variance 4.65.
+    check_p("tied", {1, 2, 2}, {2, 3, 4}, 0.5 * std::erfc((8 - 4.5 - 0.5) / std::sqrt(4.65) / std::sqrt(2.0)));
+
+    std::vector<double> same = {4.1, 3.9, 4.4, 4.0, 4.2, 3.8};
+    double p = mann_whitney_p(same, same);
+    if (p < 0.5 || p > 1) {
+        ++failures;
+        fprintf(stderr, "FAIL mann_whitney_p identical: %f\n", p);
+    }
+
+    benchmark_baseline saved;
+    saved.cpu = "Quoted \"cpu\" at C:\\path";
+    saved.compiler = "tab\tnewline\nbell\a";
+    saved.flags = "-O2";
+    saved.created = "2026-01-01T00:00:00Z";
+    saved.seed = 4242;
+    baseline_entry entry;
+    entry.algorithm = "odd\\name\"";
+    entry.distribution = "uniform";
+    entry.mode = "pairs";
+    entry.k = 100;
+    entry.threads = 4;
+    entry.placement = "interleave";
+    entry.size = 1 << 20;
+    entry.samples_ms = {1.5, 2.25, 1000.125};
+    saved.entries.push_back(entry);
+    saved.entries.push_back(baseline_entry());
+    saved.entries.back().algorithm = "quick";
+    saved.entries.back().samples_ms = {3};
+
+    std::filesystem::path path = dir / "baseline.json";
+    benchmark_baseline loaded;
+    const char *problem = nullptr;
+    if (!save_baseline(path.string().c_str(), saved) || !load_baseline(path.string().c_str(), loaded)) {
+        problem = "cannot save or load";
+    } else if (loaded.cpu != saved.cpu || loaded.compiler != saved.compiler || loaded.flags != saved.flags ||
+               loaded.created != saved.created || loaded.seed != saved.seed) {
+        problem = "header differs";
+    } else if (loaded.entries.size() != 2) {
+        problem = "wrong entry count";
+    } else {
+        for (size_t i = 0; i < 2 && !problem; ++i) {
+            const baseline_entry &a = saved.entries[i], &b = loaded.entries[i];
+            if (a.algorithm != b.algorithm || a.distribution != b.distribution || a.mode != b.mode || a.k != b.k ||
+                a.threads != b.threads || a.placement != b.placement || a.size != b.size ||
+                a.samples_ms != b.samples_ms) {
+                problem = "entry differs";
+            }
+        }
+    }
+    if (problem) {
+        ++failures;
+        fprintf(stderr, "FAIL baseline round trip: %s\n", problem);
+    }
+
+    write_file(path, "{\"version\": 1, \"entries\": [{\"algorithm\": \"merge\", \"distribution\": \"sorted\", "
+                     "\"size\": 1000, \"samples_ms\": [0.5]}]}");
+    loaded = benchmark_baseline();
+    if (!load_baseline(path.string().c_str(), loaded) || loaded.entries.size() != 1 ||
+        loaded.entries[0].mode != "keys" || loaded.entries[0].size != 1000) {
+        ++failures;
+        fprintf(stderr, "FAIL baseline without modes\n");
+    }
+    std::filesystem::remove(path);
+
+    return 8;
+}
+
+// Frames large enough that a torn copy would mix two sequence numbers.
+struct test_frame {
+    uint64_t sequence;
+    uint64_t words[63];
+};
+
+// One producer publishing numbered frames while a consumer keeps picking them up: every
+// frame the consumer sees must be whole and newer than the last, and once the producer
+// is done the consumer must end on its final frame.
+static void run_triple_buffer_case() {
+    const uint64_t FRAMES = 200000;
+    triple_buffer<test_frame> frames;
+    std::atomic<bool> done(false);
+
+    std::thread producer([&]() {
+        for (uint64_t sequence = 1; sequence <= FRAMES; ++sequence) {
+            test_frame &frame = frames.back();
+            frame.sequence = sequence;
+            std::fill(std::begin(frame.words), std::end(frame.words), sequence);
+            frames.publish();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    uint64_t last = 0, torn = 0, stale = 0;
+    auto check = [&]() {
+        if (!frames.update()) return;
+        const test_frame &frame = frames.front();
+        if (std::any_of(std::begin(frame.words), std::end(frame.words), [&](uint64_t word) {
+            return word != frame.sequence;
+        })) {
+            ++torn;
+        }
+        if (frame.sequence <= last) ++stale;
+        last = frame.sequence;
+    };
+    while (!done.load(std::memory_order_acquire)) check();
+    producer.join();
+    check();
+
+    if (torn || stale || last != FRAMES) {
+        ++failures;
+        fprintf(stderr, "FAIL triple_buffer: %llu torn, %llu stale, ended on frame %llu of %llu\n",
+                (unsigned long long) torn, (unsigned long long) stale, (unsigned long long) last,
+                (unsigned long long) FRAMES);
+    }
+}
+
+// A pacer polled every millisecond must hand out operations at its rate, and after a
+// stall it must run at most MAX_LAG_SECONDS (0.1 s) of backlog and drop the rest.
+static void run_pacer_case() {
+    const double RATE = 20000;
+    using clock = std::chrono::steady_clock;
+
+    pacer pace(RATE);
+    pace.due();
+    auto start_time = clock::now();
+    uint64_t operations = 0;
+    while (clock::now() - start_time < std::chrono::milliseconds(250)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        operations += pace.due();
+    }
+    double expected = RATE * std::chrono::duration<double>(clock::now() - start_time).count();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    uint64_t after_stall = pace.due();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    uint64_t after_catch_up = pace.due();
+
+    uint64_t max_lag = (uint64_t) (RATE * 0.1);
+    if (operations < 0.8 * expected || operations > expected + 1 || after_stall != max_lag ||
+        after_catch_up > max_lag / 2) {
+        ++failures;
+        fprintf(stderr, "FAIL pacer: %llu operations where %.0f were due, %llu after a stall (max %llu), "
+                        "%llu just after\n", (unsigned long long) operations, expected,
+                (unsigned long long) after_stall, (unsigned long long) max_lag, (unsigned long long) after_catch_up);
+    }
+}
+
+// Counting policy that requests cancellation once `cancel_at` operations have been
+// counted and then counts how many more the kernel does before it returns.
+struct cancelling_counters {
+    cancel_token &token;
+    uint64_t cancel_at;
+    uint64_t operations = 0;
+    uint64_t after_request = 0;
+
+    void count(uint64_t elements) {
+        if (token.requested()) after_request += elements;
+        operations += elements;
+        if (operations >= cancel_at && !token.requested()) token.request();
+    }
+
+    void compare() { count(1); }
+    void swap() { count(1); }
+    void read(uint64_t elements) { count(elements); }
+    void write(uint64_t elements) { count(elements); }
+    void allocate(uint64_t) {}
+    void release(uint64_t) {}
+    void enter() {}
+    void leave() {}
+};
+
+using cancellable_kernel = void (*)(uint32_t *arr, uint32_t size, const cancel_token &token,
+                                    cancelling_counters &counters);
+
+// Permitted work after a request: CANCEL_POLL_INTERVAL steps of a hot loop, a heap step
+// being a sift of O(log n), plus `cleanup` passes over the array that a kernel makes to
+// stay a permutation (the copy back of merge and radix sort, the level sample sort is
+// partitioning in place).
+struct cancel_case {
+    const char *id;
+    uint32_t size;
+    uint32_t cleanup;
+    cancellable_kernel run;
+};
+
+const cancel_case CANCEL_CASES[] = {
+        {"bubble", 1 << 13, 0, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            bubble_sort_algorithm(arr, size, token, c);
+        }},
+        {"merge", 1 << 20, 2, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            merge_sort_algorithm(arr, 0, size - 1, token, c);
+        }},
+        {"quick", 1 << 20, 0, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            quick_sort_algorithm(arr, size, quick_sort_depth_limit(size), token, c);
+        }},
+        {"heap", 1 << 20, 0, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            heap_sort_algorithm(arr, size, token, c);
+        }},
+        {"radix", 1 << 20, 2, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            radix_sort_algorithm(arr, size, token, c);
+        }},
+        {"sample", 1 << 20, 16, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            sample_sort_algorithm(arr, size, 1, token, c);
+        }},
+        {"introselect", 1 << 20, 0, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            introselect_algorithm(arr, size, size / 3, token, c);
+        }},
+        {"floyd-rivest", 1 << 20, 0, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            floyd_rivest_algorithm(arr, size, size / 3, token, c);
+        }},
+        {"heap-top-k", 1 << 20, 0, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            heap_top_k_algorithm(arr, size, size / 3, token, c);
+        }},
+        {"radix-top-k", 1 << 20, 2, [](uint32_t *arr, uint32_t size, const cancel_token &token, cancelling_counters &c) {
+            radix_select_algorithm(arr, size, size / 3, token, c);
+        }},
+};
+
+// Cancels each counted kernel at several points of a run. It must return within the
+// work cancel_case permits and leave the array a permutation of its input.
+static void run_cancel_case(const cancel_case &kernel, uint32_t case_seed) {
+    std::mt19937 rng(case_seed);
+    std::vector<uint32_t> input(kernel.size);
+    for (uint32_t &key: input) key = rng();
+    uint64_t checksum = multiset_checksum(input.data(), kernel.size);
+
+    cancel_token uncancelled;
+    cancelling_counters full{uncancelled, UINT64_MAX};
+    std::vector<uint32_t> arr = input;
+    kernel.run(arr.data(), kernel.size, uncancelled, full);
+
+    uint64_t allowed = 8ull * std::bit_width(kernel.size) * cancel_token::CANCEL_POLL_INTERVAL +
+                       (uint64_t) kernel.cleanup * kernel.size;
+    for (double fraction: {0.02, 0.3, 0.6, 0.9}) {
+        cancel_token token;
+        cancelling_counters counters{token, (uint64_t) ((double) full.operations * fraction)};
+        arr = input;
+        kernel.run(arr.data(), kernel.size, token, counters);
+
+        const char *problem = nullptr;
+        if (multiset_checksum(arr.data(), kernel.size) != checksum) {
+            problem = "no longer a permutation";
+        } else if (counters.after_request > allowed) {
+            problem = "slow to return";
+        }
+        if (!problem) continue;
+
+        ++failures;
+        fprintf(stderr, "FAIL cancel %s n=%u at %.0f%% of %llu operations seed=%u: %s (%llu operations after "
+                        "the request, %llu allowed)\n", kernel.id, kernel.size, fraction * 100,
+                (unsigned long long) full.operations, case_seed, problem,
+                (unsigned long long) counters.after_request, (unsigned long long) allowed);
+    }
+}
+
+// The uncounted engines, vectorized and parallel ones included, cancelled from another
+// thread at whatever point they have reached: each must still return a permutation.
+template<typename RUN>
+static void run_engine_cancel_case(const char *id, const RUN &run, uint32_t case_seed) {
+    const uint32_t size = 1 << 20;
+    std::mt19937 rng(case_seed);
+    std::vector<uint32_t> arr(size);
+    for (uint32_t &key: arr) key = rng();
+    uint64_t checksum = multiset_checksum(arr.data(), size);
+
+    cancel_token token;
+    std::thread canceller([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        token.request();
+    });
+    run(arr.data(), size, token);
+    canceller.join();
+
+    if (multiset_checksum(arr.data(), size) != checksum) {
+        ++failures;
+        fprintf(stderr, "FAIL cancel %s n=%u seed=%u: no longer a permutation\n", id, size, case_seed);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t cases = argc > 1 ? (uint32_t) strtoul(argv[1], nullptr, 10) : 2000;
+    uint32_t seed = argc > 2 ? (uint32_t) strtoul(argv[2], nullptr, 10) : 1;
+
+    std::mt19937 rng(seed);
+    // Log-uniform sizes: most cases are small, which is where off-by-one bugs live.
+    std::uniform_real_distribution<double> log_size(0, std::log2((double) MAX_RANDOM_SIZE));
+    std::uniform_int_distribution<uint32_t> distributions(0, DISTRIBUTION_COUNT - 1);
+
+    // Cases that walk the instruction set levels must hand this one back.
+    CPU_ISA isa = active_isa();
+
+    uint32_t runs = 0;
+    for (uint32_t a = 0; a < SORTING_ALGORITHMS_COUNT; ++a) {
+        const sorting_algorithm &algorithm = SORTING_ALGORITHMS[a];
+
+        for (uint32_t size: FIXED_SIZES) {
+            for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) {
+                run_case(algorithm, (DISTRIBUTION) d, size, seed + size);
+                ++runs;
+            }
+        }
+
+        run_case(algorithm, DISTRIBUTION::UNIFORM, LARGE_SIZE, seed);
+        ++runs;
+
+        if (algorithm.parallel) {
+            for (uint32_t threads: PARALLEL_THREADS) {
+                set_active_threads(threads);
+                for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) {
+                    run_case(algorithm, (DISTRIBUTION) d, LARGE_SIZE, seed + d);
+                    run_case(algorithm, (DISTRIBUTION) d, PARALLEL_SIZE, seed + d);
+                    runs += 2;
+                }
+            }
+            set_active_threads(0);
+
+            set_numa_aware(true);
+            run_case(algorithm, DISTRIBUTION::UNIFORM, PARALLEL_SIZE, seed);
+            set_numa_aware(false);
+            ++runs;
+        }
+
+        for (uint32_t c = 0; c < cases; ++c) {
+            uint32_t size = (uint32_t) std::exp2(log_size(rng));
+            uint32_t case_seed = rng();
+            run_case(algorithm, (DISTRIBUTION) distributions(rng), size, case_seed);
+            ++runs;
+        }
+    }
+
+    for (uint32_t size: VERIFIER_SIZES) {
+        run_verifier_case(size, seed + size);
+        ++runs;
+    }
+
+    for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) {
+        for (uint32_t nodes: {2u, 3u, 4u}) {
+            run_numa_case((DISTRIBUTION) d, PARALLEL_SIZE, nodes, 2 * nodes + 1, seed + d);
+            ++runs;
+        }
+    }
+
+    for (uint32_t nodes: {2u, 4u}) {
+        run_numa_binding_case(nodes, 2 * nodes + 1);
+        ++runs;
+    }
+
+    for (uint32_t a = 0; a < THREAD_AFFINITY_COUNT; ++a) {
+        for (uint32_t threads: PARALLEL_THREADS) {
+            run_pool_case((THREAD_AFFINITY) a, threads, seed + threads);
+            ++runs;
+        }
+    }
+
+    for (uint32_t g = 0; g < SEGMENT_DISTRIBUTION_COUNT; ++g) {
+        for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) {
+            run_segmented_case((SEGMENT_DISTRIBUTION) g, (DISTRIBUTION) d, LARGE_SIZE, seed + d);
+            ++runs;
+        }
+        run_segmented_case((SEGMENT_DISTRIBUTION) g, DISTRIBUTION::UNIFORM, PARALLEL_SIZE, seed + g);
+        ++runs;
+        for (uint32_t c = 0; c < cases / 20; ++c) {
+            uint32_t size = (uint32_t) std::exp2(log_size(rng));
+            uint32_t case_seed = rng();
+            run_segmented_case((SEGMENT_DISTRIBUTION) g, (DISTRIBUTION) distributions(rng), size, case_seed);
+            ++runs;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::path file_dir = std::filesystem::temp_directory_path(error) /
+                                     ("differential_test_" + std::to_string(std::random_device()()));
+    if (std::filesystem::create_directory(file_dir, error)) {
+        const char *backend = getenv("SORTING_IO_BACKEND");
+        std::string saved_backend = backend ? backend : "";
+        for (uint64_t size: EXTERNAL_SIZES) {
+            for (bool direct: {false, true}) {
+                for (bool threads: {false, true}) {
+                    run_external_case<uint32_t>(file_dir, size, direct, threads, seed + (uint32_t) size);
+                    run_external_case<uint64_t>(file_dir, size, direct, threads, seed + (uint32_t) size);
+                    runs += 2;
+                }
+            }
+        }
+        set_io_backend(backend ? saved_backend.c_str() : nullptr);
+
+        for (bool direct: {false, true}) {
+            for (uint64_t size: EXTERNAL_SIZES) {
+                run_truncated_external_case<uint32_t>(file_dir, size, 3, direct);
+                run_truncated_external_case<uint64_t>(file_dir, size, 4, direct);
+                runs += 2;
+            }
+        }
+
+        runs += run_dataset_cases(file_dir, seed);
+        runs += run_baseline_cases(file_dir);
+        // Run files left behind by a failure go too.
+        std::filesystem::remove_all(file_dir, error);
+    } else {
+        ++failures;
+        fprintf(stderr, "FAIL cannot create %s\n", file_dir.string().c_str());
+    }
+
+    // Selection engines also see sizes well past the Floyd-Rivest sample limit and the
+    // SIMD top-k buffer, where their fast paths start.
+    for (uint32_t a = 0; a < SELECTION_ALGORITHMS_COUNT; ++a) {
+        const selection_algorithm &algorithm = SELECTION_ALGORITHMS[a];
+
+        for (uint32_t size: FIXED_SIZES) {
+            for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) {
+                run_selection_case(algorithm, (DISTRIBUTION) d, size, seed + size);
+                ++runs;
+            }
+        }
+
+        for (uint32_t d = 0; d < DISTRIBUTION_COUNT; ++d) {
+            run_selection_case(algorithm, (DISTRIBUTION) d, LARGE_SIZE, seed + d);
+            ++runs;
+        }
+
+        for (uint32_t c = 0; c < cases / 4; ++c) {
+            uint32_t size = (uint32_t) std::exp2(log_size(rng));
+            uint32_t case_seed = rng();
+            run_selection_case(algorithm, (DISTRIBUTION) distributions(rng), size, case_seed);
+            ++runs;
+        }
+    }
+
+    for (const cancel_case &kernel: CANCEL_CASES) {
+        run_cancel_case(kernel, seed);
+        ++runs;
+    }
+    set_active_threads(4);
+    for (uint32_t a = 0; a < SORTING_ALGORITHMS_COUNT; ++a) {
+        run_engine_cancel_case(SORTING_ALGORITHMS[a].id, SORTING_ALGORITHMS[a].sort, seed + a);
+        ++runs;
+    }
+    for (uint32_t a = 0; a < SELECTION_ALGORITHMS_COUNT; ++a) {
+        const selection_algorithm &algorithm = SELECTION_ALGORITHMS[a];
+        run_engine_cancel_case(algorithm.id, [&](uint32_t *arr, uint32_t size, const cancel_token &token) {
+            algorithm.select(arr, size, size / 3, token);
+        }, seed + a);
+        ++runs;
+    }
+    set_active_threads(0);
+
+    run_triple_buffer_case();
+    run_pacer_case();
+    runs += 2;
+
+    if (active_isa() != isa) {
+        ++failures;
+        fprintf(stderr, "FAIL ended on isa %s instead of %s\n", CPU_ISA_IDS[active_isa()], CPU_ISA_IDS[isa]);
+    }
+
+    printf("%u cases, %u failures\n", runs, failures);
+    return failures ? 1 : 0;
+}